@@ -0,0 +1,132 @@
+/**
+ * @file alloc.c
+ * @brief Allocation tracking per subsystem.
+ *
+ * Every allocation of the assembler goes through these wrappers. Each block is
+ * prefixed with a small header that records its size and subsystem, so frees can
+ * be accounted for without a lookup table.
+ */
+#define _XOPEN_SOURCE 500
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include "alloc.h"
+
+const char *MEM_TAG_NAMES[] = {
+    "symbols", "macros", "code", "data", "strings", "temporaries", "reports"
+};
+
+/* Header stored before every block, padded to the strictest alignment */
+typedef union Block_Header {
+    struct {
+        size_t size;
+        Mem_Tag tag;
+    } info;
+    double align_double;
+    long align_long;
+    void *align_pointer;
+} Block_Header;
+
+static Mem_Usage usage[MEM_TAGS_COUNT];
+static long live_bytes = 0; /* Bytes live over all subsystems */
+static long peak_bytes = 0; /* Peak of live_bytes in the current file */
+static int report = 0;
+
+/* Accounts for a new block and returns the user pointer */
+static void *account(Block_Header *header, size_t size, Mem_Tag tag) {
+    header->info.size = size;
+    header->info.tag = tag;
+    usage[tag].allocations++;
+    usage[tag].bytes += (long) size;
+    usage[tag].live_bytes += (long) size;
+    if (usage[tag].live_bytes > usage[tag].peak_bytes)
+        usage[tag].peak_bytes = usage[tag].live_bytes;
+    live_bytes += (long) size;
+    if (live_bytes > peak_bytes)
+        peak_bytes = live_bytes;
+    return header + 1;
+}
+
+/* Accounts for a block that is released */
+static void release(const Block_Header *header) {
+    usage[header->info.tag].live_bytes -= (long) header->info.size;
+    live_bytes -= (long) header->info.size;
+}
+
+void *tracked_malloc(size_t size, Mem_Tag tag) {
+    Block_Header *header = malloc(sizeof(Block_Header) + size);
+    if (header == NULL)
+        return NULL; /* Indicates allocation failed */
+    return account(header, size, tag);
+}
+
+void *tracked_realloc(void *ptr, size_t size, Mem_Tag tag) {
+    Block_Header *header, *new_header;
+
+    if (ptr == NULL)
+        return tracked_malloc(size, tag);
+    header = (Block_Header *) ptr - 1;
+    new_header = realloc(header, sizeof(Block_Header) + size);
+    if (new_header == NULL)
+        return NULL; /* Indicates allocation failed, the old block is still valid */
+    release(new_header); /* Releasing the old size that is still recorded in the header */
+    usage[tag].reallocations++;
+    return account(new_header, size, tag);
+}
+
+void tracked_free(void *ptr) {
+    Block_Header *header;
+
+    if (ptr == NULL)
+        return;
+    header = (Block_Header *) ptr - 1;
+    release(header);
+    free(header);
+}
+
+void set_mem_report(int enabled) {
+    report = enabled;
+}
+
+void mem_start_file() {
+    int i;
+
+    for (i = 0; i < MEM_TAGS_COUNT; i++) {
+        usage[i].allocations = 0;
+        usage[i].reallocations = 0;
+        usage[i].bytes = 0;
+        usage[i].peak_bytes = usage[i].live_bytes;
+    }
+    peak_bytes = live_bytes;
+}
+
+void mem_end_file(const char *name) {
+    int i;
+
+    if (!report)
+        return;
+    fprintf(stderr, "Memory for %s:\n", name);
+    fprintf(stderr, "  %-12s %12s %12s %12s %12s\n", "subsystem", "allocations", "bytes", "peak bytes", "live bytes");
+    for (i = 0; i < MEM_TAGS_COUNT; i++)
+        fprintf(stderr, "  %-12s %12ld %12ld %12ld %12ld\n", MEM_TAG_NAMES[i], usage[i].allocations, usage[i].bytes,
+                usage[i].peak_bytes, usage[i].live_bytes);
+    fprintf(stderr, "  peak live bytes %ld in this file, process peak RSS so far %ld KB\n", peak_bytes,
+            get_peak_rss()); /* ru_maxrss is a high-water mark of the whole run, not of the file */
+}
+
+const Mem_Usage *get_mem_usage(Mem_Tag tag) {
+    return &usage[tag];
+}
+
+long get_mem_peak() {
+    return peak_bytes;
+}
+
+long get_peak_rss() {
+    struct rusage self;
+
+    if (getrusage(RUSAGE_SELF, &self) != 0)
+        return -1;
+    return self.ru_maxrss; /* Kilobytes on Linux */
+}
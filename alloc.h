@@ -0,0 +1,96 @@
+#ifndef ALLOC_H
+#define ALLOC_H
+#include <stddef.h>
+
+/* Subsystems that memory is allocated for */
+typedef enum Mem_Tag {
+    MEM_SYMBOLS,
+    MEM_MACROS,
+    MEM_CODE,
+    MEM_DATA,
+    MEM_STRINGS,
+    MEM_TEMP,
+    MEM_REPORTS,
+    MEM_TAGS_COUNT
+} Mem_Tag;
+
+/* Allocation counters of a single subsystem */
+typedef struct Mem_Usage {
+    long allocations; /* Number of allocations (a realloc counts as one) */
+    long reallocations; /* Number of the allocations that resized an existing block */
+    long bytes; /* Total bytes requested */
+    long live_bytes; /* Bytes currently allocated */
+    long peak_bytes; /* Highest value of live_bytes */
+} Mem_Usage;
+
+extern const char *MEM_TAG_NAMES[];
+
+/**
+ * Allocates memory on behalf of a subsystem.
+ * @param size The number of bytes to allocate.
+ * @param tag The subsystem the memory is allocated for.
+ * @return Pointer to the allocated memory, or NULL if allocation failed.
+ */
+void *tracked_malloc(size_t size, Mem_Tag tag);
+
+
+/**
+ * Resizes memory allocated by tracked_malloc (or allocates it if ptr is NULL).
+ * @param ptr Pointer to the memory to resize, or NULL.
+ * @param size The new size in bytes.
+ * @param tag The subsystem the memory is allocated for.
+ * @return Pointer to the resized memory, or NULL if allocation failed (ptr is left untouched).
+ */
+void *tracked_realloc(void *ptr, size_t size, Mem_Tag tag);
+
+
+/**
+ * Frees memory allocated by tracked_malloc or tracked_realloc.
+ * @param ptr Pointer to the memory to free, or NULL.
+ */
+void tracked_free(void *ptr);
+
+
+/**
+ * Enables printing of the memory report after every file.
+ * @param enabled 1 to enable the report, 0 to disable it.
+ */
+void set_mem_report(int enabled);
+
+
+/**
+ * Resets the per-file allocation counters before a new file is processed.
+ * Memory that is still live keeps being accounted for.
+ */
+void mem_start_file();
+
+
+/**
+ * Prints the memory report of the current file if enabled.
+ * @param name The name of the file that was processed.
+ */
+void mem_end_file(const char *name);
+
+
+/**
+ * Gets the allocation counters of a subsystem for the current file.
+ * @param tag The subsystem.
+ * @return Pointer to the counters of the subsystem.
+ */
+const Mem_Usage *get_mem_usage(Mem_Tag tag);
+
+
+/**
+ * Gets the highest number of bytes that were live at once during the current file.
+ * @return The peak live bytes over all subsystems.
+ */
+long get_mem_peak();
+
+
+/**
+ * Gets the peak resident set size of the process.
+ * @return The peak resident set size in kilobytes, or -1 if unavailable.
+ */
+long get_peak_rss();
+
+#endif
@@ -0,0 +1,110 @@
+/**
+ * @file assemble.c
+ * @brief Assembling of a single source file.
+ * @details Runs the pre-processing, first pass and second pass of one file and keeps
+ *          the per-file statistics, so that the assembler and the tools that drive
+ *          it share the same pipeline. With "--check" the same stages run in memory
+ *          and only report the errors.
+ */
+#include <stdio.h>
+#include "assemble.h"
+#include "pre_proc.h"
+#include "first_pass.h"
+#include "second_pass.h"
+#include "symbols_list.h"
+#include "code_list.h"
+#include "data_list.h"
+#include "const.h"
+#include "stats.h"
+#include "alloc.h"
+#include "trace.h"
+#include "report.h"
+#include "cost.h"
+#include "peephole.h"
+#include "strip.h"
+#include "dedup.h"
+#include "machine_code.h"
+#include "source_map.h"
+
+/* Lists of the file being assembled, kept until the next file starts */
+static Data *data_head = NULL;
+static Code *code_head = NULL;
+static int check_only = 0; /* Whether the files are only checked */
+
+void set_check_only(int enabled) {
+    check_only = enabled;
+    set_expansion_in_memory(enabled);
+    set_code_images(!enabled);
+}
+
+/* Ends the statistics of the current file */
+static int end_file(char *name, int status) {
+    if (status != 0)
+        printf("Process terminated\n");
+    stats_end_file(status);
+    report_end_file(name);
+    mem_end_file(name);
+    trace_end(name);
+    return status;
+}
+
+int assemble_file(char *name) {
+    int IC = IC_INITIAL; /* Instruction Counter */
+    int DC = DC_INITIAL; /* Data Counter */
+    int status; /* Result of the current stage */
+
+    trace_begin(name);
+    stats_start_file(name);
+    /* Freeing the state left by the previous file */
+    free_code_list(&code_head);
+    free_data_list(&data_head);
+    free_labels();
+    free_source_map();
+    free_expanded_source();
+    report_start_file();
+    mem_start_file();
+
+    stage_begin(STAGE_PRE_PROC);
+    trace_begin("pre_proc");
+    status = pre_proc(name);
+    trace_end("pre_proc");
+    stage_end(STAGE_PRE_PROC);
+    if (status != 0)
+        return end_file(name, 1);
+    printf("Pre-Process was successful\n");
+
+    stage_begin(STAGE_FIRST_PASS);
+    trace_begin("first_pass");
+    status = first_pass(name, &data_head, &code_head, &IC, &DC);
+    trace_end("first_pass");
+    stage_end(STAGE_FIRST_PASS);
+    if (status != 0)
+        return end_file(name, 1);
+    printf("First pass pass was successful\n");
+    if (check_only) {
+        /* Without the code and data lists only the labels are left to check */
+        if (check_labels(name) != 0)
+            return end_file(name, 1);
+        printf("Check was successful\n");
+        free_labels();
+        free_source_map();
+        free_expanded_source();
+        return end_file(name, 0);
+    }
+    if (peephole(&code_head, &IC) != 0 || strip(name, &code_head, &data_head, &IC, &DC) != 0 ||
+        dedup(name, &code_head, &data_head, &IC, &DC) != 0)
+        return end_file(name, 1);
+    report_final_code(code_head);
+
+    if (second_pass(name, data_head, code_head, &IC, &DC) != 0)
+        return end_file(name, 1);
+    printf("Second pass was successful\n");
+    printf("Process ended\n");
+    report_cost(name, code_head, IC);
+
+    free_code_list(&code_head);
+    free_data_list(&data_head);
+    free_labels();
+    free_source_map();
+    return end_file(name, 0);
+}
@@ -0,0 +1,20 @@
+#ifndef ASSEMBLE_H
+#define ASSEMBLE_H
+
+/**
+ * Assembles a single source file: pre-processing, first pass and second pass.
+ * Resets the state left by a previous file, and records statistics and memory usage.
+ * @param name Source file name without extension
+ * @return 0 on success, 1 on failure
+ */
+int assemble_file(char *name);
+
+
+/**
+ * Only checks the files: the expanded source stays in memory, no code or data list is
+ * built, the labels are checked without the second pass and no file is written.
+ * @param enabled 1 to only check the files, 0 to assemble them.
+ */
+void set_check_only(int enabled);
+
+#endif
@@ -8,11 +8,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "code_list.h"
+#include "alloc.h"
 
 int add_code(unsigned int DC, unsigned int value, Code **head) {
     Code *last_code;
 
-    Code *new_Code = malloc(sizeof(Code));
+    Code *new_Code = tracked_malloc(sizeof(Code), MEM_CODE);
     if (new_Code == NULL) {
         printf("Error: Memory allocation failed\n");
         return 1;
@@ -49,7 +50,7 @@ void free_code_list(Code **head) {
     while (current != NULL) {
         temp = current;
         current = current->next;
-        free(temp);
+        tracked_free(temp);
     }
 
     *head = NULL;
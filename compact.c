@@ -0,0 +1,113 @@
+/**
+ * @file compact.c
+ * @brief Removal of words from the code and data between the first and second pass.
+ *
+ * The passes that drop words (the peephole optimization and the dead-code elimination)
+ * only decide which words go and where the kept ones move. This file applies that
+ * decision to the lists, the symbols and the unresolved operands, so that the second
+ * pass resolves the operands as if the dropped words had never been written, and the
+ * source map still finds the line of every kept instruction.
+ */
+#include <stdio.h>
+#include "compact.h"
+#include "symbols_list.h"
+#include "source_map.h"
+#include "const.h"
+#include "stats.h"
+#include "alloc.h"
+
+#define MASK_ARE 7
+
+/* Drops the code words that were removed and moves the kept ones, returns the number of dropped words */
+static int compact_code(Code **code_head, const int *code_address) {
+    Code *current = *code_head, *previous = NULL, *next;
+    int index, dropped = 0;
+
+    while (current != NULL) {
+        next = current->next;
+        index = (int) current->IC - IC_INITIAL;
+        if (code_address[index] == code_address[index + 1]) {
+            /* Indicates the word was dropped */
+            if (previous == NULL)
+                *code_head = next;
+            else
+                previous->next = next;
+            tracked_free(current);
+            dropped++;
+        } else {
+            current->IC = (unsigned int) code_address[index];
+            /* An unresolved relative operand holds its own address */
+            if ((current->value & MASK_ARE) == BIT_MASK_RELATIVE)
+                current->value = (current->IC << VALUE_POS) | BIT_MASK_RELATIVE;
+            previous = current;
+        }
+        current = next;
+    }
+    return dropped;
+}
+
+/* Drops the data words that were removed and moves the kept ones, returns the number of dropped words */
+static int compact_data(Data **data_head, const int *data_address) {
+    Data *current = *data_head, *previous = NULL, *next;
+    int dropped = 0;
+
+    while (current != NULL) {
+        next = current->next;
+        if (data_address[current->DC] == data_address[current->DC + 1]) {
+            if (previous == NULL)
+                *data_head = next;
+            else
+                previous->next = next;
+            tracked_free(current);
+            dropped++;
+        } else {
+            current->DC = (unsigned int) data_address[current->DC];
+            previous = current;
+        }
+        current = next;
+    }
+    return dropped;
+}
+
+/* Moves the labels and fixups, returns the number of removed fixups */
+static int move_symbols(const int *code_address, const int *data_address, int code_words, int data_words,
+                        int new_ICF) {
+    Symbol_Table *table = get_symbol_table();
+    int symbol, index, removed_fixups = 0;
+
+    for (symbol = 0; symbol < table->count; symbol++) {
+        index = table->addresses[symbol] - IC_INITIAL;
+        if (table->types[symbol] == DATA) {
+            index -= code_words;
+            table->addresses[symbol] = new_ICF + (data_address != NULL && index >= 0 && index <= data_words
+                                                      ? data_address[index]
+                                                      : index);
+        } else if ((table->types[symbol] == CODE || table->types[symbol] == OPERAND) &&
+                   index >= 0 && index <= code_words) {
+            if (table->types[symbol] == OPERAND && index < code_words &&
+                code_address[index] == code_address[index + 1]) {
+                /* The operand of a dropped instruction */
+                remove_label(symbol);
+                removed_fixups++;
+            } else {
+                table->addresses[symbol] = code_address[index];
+            }
+        }
+    }
+    return removed_fixups;
+}
+
+void compact_image(Code **code_head, Data **data_head, const int *code_address, const int *data_address,
+                   int *IC, int *DC) {
+    int code_words = *IC - IC_INITIAL, data_words = data_address != NULL ? *DC : 0;
+
+    stats_add(COUNT_CODE_WORDS, -compact_code(code_head, code_address));
+    stats_add(COUNT_FIXUPS, -move_symbols(code_address, data_address, code_words, data_words,
+                                          code_address[code_words]));
+    move_source_addresses(code_address, code_words);
+    *IC = code_address[code_words];
+    if (data_address != NULL) {
+        stats_add(COUNT_DATA_WORDS, -compact_data(data_head, data_address));
+        *DC = data_address[data_words];
+    }
+}
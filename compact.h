@@ -0,0 +1,25 @@
+#ifndef COMPACT_H
+#define COMPACT_H
+
+#include "code_list.h"
+#include "data_list.h"
+
+/**
+ * Drops words from the code and data of the current file and moves the kept words, the
+ * code and data labels, the operand fixups, the unresolved relative operands and the
+ * source map to their new addresses. A word is dropped when its new address equals the one of the word after
+ * it, and a label of a dropped word moves to the next kept word. The operand fixups of
+ * dropped words are removed. Must be called between the first and second pass.
+ * @param code_head Pointer to the head of the code list.
+ * @param data_head Pointer to the head of the data list, unused if data_address is NULL.
+ * @param code_address New address of every code word followed by the new end of the code
+ *                     (IC - IC_INITIAL + 1 entries).
+ * @param data_address New data counter of every data word followed by the new end of the
+ *                     data (DC + 1 entries), or NULL if no data word is dropped.
+ * @param IC Pointer to the instruction counter, set to the new end of the code.
+ * @param DC Pointer to the data counter, set to the new end of the data (unused if data_address is NULL).
+ */
+void compact_image(Code **code_head, Data **data_head, const int *code_address, const int *data_address,
+                   int *IC, int *DC);
+
+#endif
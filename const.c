@@ -4,32 +4,60 @@
  *
  * The constants include instruction definitions, register names, directive prompts,
  * and type names. These are used throughout the assembler for various purposes.
+ * The instruction table and the encoding tables are all expanded from INSTRUCTION_LIST,
+ * so the first word of an instruction is a table load and its legality check a bit test.
  */
 #include "const.h"
 
 /* Instruction Definitions */
+#define INSTRUCTION_ENTRY(name, opcode, funct, operands_num, source, destination) \
+    {name, opcode, funct, operands_num, source, destination},
+
 const instruction INSTRUCTIONS[] = {
-    {"mov", 0, 0, 2, METHODS_0_1_3, METHODS_1_3},
-    {"cmp", 1, 0, 2, METHODS_0_1_3, METHODS_0_1_3},
-    {"add", 2, 1, 2, METHODS_0_1_3, METHODS_1_3},
-    {"sub", 2, 2, 2, METHODS_0_1_3, METHODS_1_3},
-    {"lea", 4, 0, 2, METHOD_1, METHODS_1_3},
-    {"clr", 5, 1, 1, NONE, METHODS_1_3},
-    {"not", 5, 2, 1, NONE, METHODS_1_3},
-    {"inc", 5, 3, 1, NONE, METHODS_1_3},
-    {"dec", 5, 4, 1, NONE, METHODS_1_3},
-    {"jmp", 9, 1, 1, NONE, METHODS_1_2},
-    {"bne", 9, 2, 1, NONE, METHODS_1_2},
-    {"jsr", 9, 3, 1, NONE, METHODS_1_2},
-    {"red", 12, 0, 1, NONE, METHODS_1_3},
-    {"prn", 13, 0, 1, NONE, METHODS_0_1_3},
-    {"rts", 14, 0, NO_OPERANDS, NONE},
-    {"stop", 15, 0, NO_OPERANDS, NONE}
+    INSTRUCTION_LIST(INSTRUCTION_ENTRY)
+};
+
+/* Encoding Tables, built from the same list by the compiler */
+#define FIRST_WORD(opcode, funct, source, destination) \
+    ((unsigned int) (opcode) << OPCODE_POS | (unsigned int) (funct) << FUNCS_POS | \
+     (unsigned int) (source) << SRC_OPERAND_POS | (unsigned int) (destination) << DST_OPERAND_POS | BIT_ABSOLUTE_FLAG)
+#define FIRST_WORDS_FROM(opcode, funct, source) \
+    {FIRST_WORD(opcode, funct, source, IMMEDIATE), FIRST_WORD(opcode, funct, source, DIRECT), \
+     FIRST_WORD(opcode, funct, source, RELATIVE), FIRST_WORD(opcode, funct, source, DIRECT_REGISTER)}
+#define FIRST_WORDS_ENTRY(name, opcode, funct, operands_num, source, destination) \
+    {FIRST_WORDS_FROM(opcode, funct, IMMEDIATE), FIRST_WORDS_FROM(opcode, funct, DIRECT), \
+     FIRST_WORDS_FROM(opcode, funct, RELATIVE), FIRST_WORDS_FROM(opcode, funct, DIRECT_REGISTER)},
+
+const unsigned int FIRST_WORDS[][METHODS_COUNT][METHODS_COUNT] = {
+    INSTRUCTION_LIST(FIRST_WORDS_ENTRY)
+};
+
+#define LEGAL_METHODS_ENTRY(name, opcode, funct, operands_num, source, destination) \
+    (source) << SOURCE_METHODS_POS | (destination),
+
+const unsigned char LEGAL_METHODS[] = {
+    INSTRUCTION_LIST(LEGAL_METHODS_ENTRY)
 };
 
+#define SRC_REGISTER_FIELD(name, number) (unsigned int) (number) << SRC_REGISTER_POS,
+#define DST_REGISTER_FIELD(name, number) (unsigned int) (number) << DST_REGISTER_POS,
+
+const unsigned int SRC_REGISTER_FIELDS[] = {
+    REGISTER_LIST(SRC_REGISTER_FIELD)
+};
+const unsigned int DST_REGISTER_FIELDS[] = {
+    REGISTER_LIST(DST_REGISTER_FIELD)
+};
+
+/* Name Lookup Tables */
+const signed char INSTRUCTION_SLOTS[] = INSTRUCTION_SLOTS_INIT;
+const signed char REGISTER_SLOTS[] = REGISTER_SLOTS_INIT;
+
 /* Register Names */
+#define REGISTER_ENTRY(name, number) name,
+
 const char *REGISTERS[] = {
-    "r0", "r1", "r2", "r3", "r4", "r5", "r6", "r7"
+    REGISTER_LIST(REGISTER_ENTRY)
 };
 
 /* Directive Prompts */
@@ -1,6 +1,8 @@
 #ifndef CONST_H
 #define CONST_H
 
+#include "isa.h" /* Generated by isagen from the instruction-set spec */
+
 /* Enums */
 typedef enum Addressing_Method {
     IMMEDIATE,
@@ -9,12 +11,16 @@ typedef enum Addressing_Method {
     DIRECT_REGISTER
 } Addressing_Method;
 
+#define METHODS_COUNT 4
+#define SOURCE_METHODS_POS 4 /* Position of the source methods in LEGAL_METHODS */
+
+/* Legal addressing methods of an operand, a bit per Addressing_Method */
 typedef enum valid_methods {
-    NONE,
-    METHOD_1,
-    METHODS_1_3,
-    METHODS_1_2,
-    METHODS_0_1_3
+    NONE = 0,
+    METHOD_1 = 1 << DIRECT,
+    METHODS_1_3 = 1 << DIRECT | 1 << DIRECT_REGISTER,
+    METHODS_1_2 = 1 << DIRECT | 1 << RELATIVE,
+    METHODS_0_1_3 = 1 << IMMEDIATE | 1 << DIRECT | 1 << DIRECT_REGISTER
 } valid_methods;
 
 /* Instruction Struct */
@@ -32,15 +38,24 @@ extern const instruction INSTRUCTIONS[];
 extern const char *REGISTERS[];
 extern const char *PROMPTS[];
 extern const char *TYPES[];
+/* First word of every (instruction, source method, destination method), without the registers */
+extern const unsigned int FIRST_WORDS[][METHODS_COUNT][METHODS_COUNT];
+/* Legal methods of every instruction, a bit per method (destination, then source at SOURCE_METHODS_POS) */
+extern const unsigned char LEGAL_METHODS[];
+/* Register fields of the first word, by register number */
+extern const unsigned int SRC_REGISTER_FIELDS[];
+extern const unsigned int DST_REGISTER_FIELDS[];
+/* Index of the instruction and register names in the slot of their hash, -1 for an empty slot */
+extern const signed char INSTRUCTION_SLOTS[];
+extern const signed char REGISTER_SLOTS[];
 
 /* Useful Constants */
 #define NO_OPERANDS 0
 #define EXTENSION_LEN 3
 #define MAX_LINE_LENGTH 82
 #define MAX_DECLARATION_LENGTH 31
-#define REGISTERS_COUNT 8
-#define INSTRUCTIONS_COUNT 16
 #define PROMPTS_COUNT 4
+#define ENTRY_PROMPT_INDEX 2 /* Index of ".entry" in PROMPTS */
 #define MACRO_START "mcro"
 #define MACRO_END "mcroend"
 #define CAPACITY 2097152
@@ -49,14 +64,6 @@ extern const char *TYPES[];
 #define DECIMAL_BASE 10
 #define TWO 2
 
-/* A bit Encoding Positions */
-#define OPCODE_POS 18
-#define SRC_OPERAND_POS 16
-#define DST_OPERAND_POS 11
-#define SRC_REGISTER_POS 13
-#define DST_REGISTER_POS 8
-#define FUNCS_POS 3
-
 /* Bit Masks */
 #define BIT_MASK_EXTERNAL 1
 #define BIT_MASK_RELOCATABLE 2
@@ -64,16 +71,6 @@ extern const char *TYPES[];
 #define BIT_MASK_RELATIVE 6
 #define BIT_ABSOLUTE_FLAG 4
 
-/* Data Limits */
-#define MASK_24BIT 0xffffff
-#define MASK_21BIT 0x1fffff
-#define MAX_24BIT 8388607
-#define MIN_24BIT (-8388608)
-#define MAX_21BIT 1048575
-#define MIN_21BIT (-1048576)
-#define BUFFER_SIZE 20
-#define MAX_DATA_NUM 38
-
 /* Characters */
 #define DOT '.'
 #define HASH '#'
@@ -81,6 +78,7 @@ extern const char *TYPES[];
 #define MINUS '-'
 #define COLON ':'
 #define COMMA ','
+#define SPACE ' '
 #define COMMENT ';'
 #define AMPERSAND '&'
 #define DOUBLE_QUOTE '\"'
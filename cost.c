@@ -0,0 +1,341 @@
+/**
+ * @file cost.c
+ * @brief Static cycle-cost estimate of the assembled code.
+ *
+ * The code image is decoded into instructions and split into basic blocks. A block
+ * starts at the first instruction, at every label and jump target, and after every
+ * jmp, bne, jsr, rts and stop. The cost of an instruction is the cost of its opcode
+ * plus the cost of the addressing method of each operand, both from the cost table.
+ *
+ * Besides the cost of every block and label, the longest acyclic path from the first
+ * instruction is reported. Loops are cut at their back edges, and rts and stop end a
+ * path. A jsr runs the called code up to its rts and then the next instruction, so the
+ * path of a jsr block adds the path of the called code to the path after the jsr.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "cost.h"
+#include "symbols_list.h"
+#include "decode.h"
+#include "alloc.h"
+#include "const.h"
+
+#define NO_BLOCK (-1)
+#define SUCCESSORS_COUNT 2
+
+/* How an instruction ends a basic block */
+typedef enum Flow {
+    FLOW_NEXT, /* Continues to the next instruction */
+    FLOW_JUMP,
+    FLOW_BRANCH,
+    FLOW_CALL,
+    FLOW_RETURN,
+    FLOW_STOP
+} Flow;
+
+/* A basic block of the code */
+typedef struct Block {
+    int start; /* Address of the first instruction */
+    int instructions;
+    long cycles;
+    int successors[SUCCESSORS_COUNT]; /* Block indexes, NO_BLOCK if unused */
+    const char *label;
+    int call; /* 1 if the block ends with a jsr, successors[1] is then the called code */
+    long path; /* Cycles of the longest acyclic path that starts at the block */
+    int path_next; /* Next block on that path */
+    int state; /* Depth-first search state: 0 new, 1 on the stack, 2 done */
+} Block;
+
+static const char *METHOD_NAMES[] = {"immediate", "direct", "relative", "register"};
+
+/* Default cycles of every instruction, in the order of INSTRUCTIONS */
+#if INSTRUCTIONS_COUNT != 16
+#error "DEFAULT_INSTRUCTION_CYCLES lists the 16 instructions of default.isa only"
+#endif
+static const long DEFAULT_INSTRUCTION_CYCLES[INSTRUCTIONS_COUNT] = {
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 3, 5, 5, 3, 1
+};
+
+/* Default extra cycles of an operand by addressing method (an extra word, a memory access) */
+static const long DEFAULT_METHOD_CYCLES[METHODS_COUNT] = {1, 2, 1, 0};
+
+static int enabled = 0;
+static long instruction_cycles[INSTRUCTIONS_COUNT];
+static long method_cycles[METHODS_COUNT];
+static Flow flows[INSTRUCTIONS_COUNT];
+
+/* Finds how every instruction ends a block */
+static void init_flows() {
+    static const char *FLOW_NAMES[] = {"", "jmp", "bne", "jsr", "rts", "stop"};
+    int i, j;
+
+    for (i = 0; i < INSTRUCTIONS_COUNT; i++) {
+        flows[i] = FLOW_NEXT;
+        for (j = FLOW_JUMP; j <= FLOW_STOP; j++)
+            if (strcmp(INSTRUCTIONS[i].instruction, FLOW_NAMES[j]) == 0)
+                flows[i] = (Flow) j;
+    }
+}
+
+/* Sets the cost of an instruction or an addressing method by name, returns 1 if the name is unknown */
+static int set_cycles(const char *name, long cycles) {
+    int i;
+
+    for (i = 0; i < INSTRUCTIONS_COUNT; i++)
+        if (strcmp(INSTRUCTIONS[i].instruction, name) == 0) {
+            instruction_cycles[i] = cycles;
+            return 0;
+        }
+    for (i = 0; i < METHODS_COUNT; i++)
+        if (strcmp(METHOD_NAMES[i], name) == 0) {
+            method_cycles[i] = cycles;
+            return 0;
+        }
+    return 1;
+}
+
+/* Loads "name cycles" lines over the default table, lines starting with ';' are comments */
+static int load_table(const char *table_name) {
+    char line[MAX_LINE_LENGTH], name[MAX_LINE_LENGTH];
+    long cycles;
+    int line_num = 0, fields;
+    FILE *file = fopen(table_name, "r");
+
+    if (file == NULL) {
+        printf("Error: can't open %s\n", table_name);
+        return 1;
+    }
+    while (fgets(line, MAX_LINE_LENGTH, file)) {
+        line_num++;
+        fields = sscanf(line, "%81s %ld", name, &cycles);
+        if (fields <= 0 || name[0] == COMMENT)
+            continue;
+        if (fields != 2 || cycles < 0 || set_cycles(name, cycles)) {
+            printf("Error in %s line %d: expected an instruction or addressing method and its cycles\n", table_name,
+                   line_num);
+            fclose(file);
+            return 1;
+        }
+    }
+    fclose(file);
+    return 0;
+}
+
+int set_cost_report(const char *table_name) {
+    memcpy(instruction_cycles, DEFAULT_INSTRUCTION_CYCLES, sizeof(instruction_cycles));
+    memcpy(method_cycles, DEFAULT_METHOD_CYCLES, sizeof(method_cycles));
+    init_flows();
+    enabled = 1;
+    return table_name != NULL && load_table(table_name);
+}
+
+/* Gets the cycles of a decoded instruction */
+static long cycles_of(const Decoded_Instruction *decoded) {
+    long cycles = instruction_cycles[decoded->id];
+
+    if (decoded->source.present)
+        cycles += method_cycles[decoded->source.method];
+    if (decoded->destination.present)
+        cycles += method_cycles[decoded->destination.method];
+    return cycles;
+}
+
+/* Gets the address a jump goes to inside the code, or -1 for an extern or an address outside the code */
+static int jump_target(const Decoded_Instruction *decoded, int ICF) {
+    const Decoded_Operand *operand = &decoded->destination;
+
+    if (operand->method == DIRECT && operand->are != BIT_MASK_RELOCATABLE)
+        return -1;
+    return operand->value >= IC_INITIAL && operand->value < ICF ? operand->value : -1;
+}
+
+/* Finds the longest acyclic path from a block with an iterative depth-first search */
+static void longest_path(Block *blocks, int *stack, int first) {
+    Block *block, *successor;
+    int top = 0, i;
+
+    stack[top++] = first;
+    blocks[first].state = 1;
+    while (top > 0) {
+        block = &blocks[stack[top - 1]];
+        for (i = 0; i < SUCCESSORS_COUNT; i++) {
+            if (block->successors[i] != NO_BLOCK && blocks[block->successors[i]].state == 0) {
+                stack[top++] = block->successors[i];
+                blocks[block->successors[i]].state = 1;
+                break;
+            }
+        }
+        if (i < SUCCESSORS_COUNT)
+            continue; /* A successor was pushed */
+        /* All successors are done, edges to blocks still on the stack close loops and are skipped */
+        block->path = block->cycles;
+        block->path_next = NO_BLOCK;
+        for (i = 0; i < SUCCESSORS_COUNT; i++) {
+            if (block->successors[i] == NO_BLOCK)
+                continue;
+            successor = &blocks[block->successors[i]];
+            if (successor->state != 2)
+                continue;
+            if (block->call) {
+                /* The called code and the code after the jsr both run, the path goes on after the jsr */
+                block->path += successor->path;
+                if (i == 0)
+                    block->path_next = block->successors[0];
+            } else if (block->cycles + successor->path > block->path) {
+                block->path = block->cycles + successor->path;
+                block->path_next = block->successors[i];
+            }
+        }
+        block->state = 2;
+        top--;
+    }
+}
+
+/* Prints the code called by a jsr block of the longest path */
+static void print_call(const Block *callee) {
+    if (callee->label)
+        fprintf(stderr, " (calls %s)", callee->label);
+    else
+        fprintf(stderr, " (calls %07d)", callee->start);
+}
+
+/* Prints the blocks, the labels and the longest path */
+static void print_cost(const char *name, const Block *blocks, int count) {
+    long label_cycles = 0, total = 0;
+    const char *label = NULL;
+    int i, j;
+
+    fprintf(stderr, "Cost estimate for %s:\n  %-8s %-16s %12s %8s  %s\n", name, "block", "label", "instructions",
+            "cycles", "successors");
+    for (i = 0; i < count; i++) {
+        fprintf(stderr, "  %07d  %-16s %12d %8ld ", blocks[i].start, blocks[i].label ? blocks[i].label : "",
+                blocks[i].instructions, blocks[i].cycles);
+        for (j = 0; j < SUCCESSORS_COUNT; j++)
+            if (blocks[i].successors[j] != NO_BLOCK)
+                fprintf(stderr, " %07d", blocks[blocks[i].successors[j]].start);
+        fprintf(stderr, "\n");
+        total += blocks[i].cycles;
+    }
+    fprintf(stderr, "  labels:");
+    for (i = 0; i <= count; i++) {
+        if (i == count || blocks[i].label != NULL) {
+            if (label != NULL)
+                fprintf(stderr, " %s %ld", label, label_cycles);
+            label = i < count ? blocks[i].label : NULL;
+            label_cycles = 0;
+        }
+        if (i < count)
+            label_cycles += blocks[i].cycles;
+    }
+    fprintf(stderr, "\n  all blocks %ld cycles, longest acyclic path %ld cycles:", total, count ? blocks[0].path : 0);
+    for (i = 0; count && i != NO_BLOCK; i = blocks[i].path_next) {
+        if (blocks[i].label)
+            fprintf(stderr, " %s", blocks[i].label);
+        else
+            fprintf(stderr, " %07d", blocks[i].start);
+        if (blocks[i].call && blocks[i].successors[1] != NO_BLOCK)
+            print_call(&blocks[blocks[i].successors[1]]);
+    }
+    fprintf(stderr, "\n");
+}
+
+void report_cost(const char *name, const Code *code_head, int ICF) {
+    Decoded_Instruction decoded;
+    const Symbol_Table *table = get_symbol_table();
+    unsigned int *words;
+    const char **labels;
+    int *block_of, *stack;
+    Block *blocks, *block;
+    int i, count = 0, length = ICF - IC_INITIAL, target, symbol;
+
+    if (!enabled || length <= 0)
+        return;
+    words = tracked_malloc(length * sizeof(unsigned int), MEM_REPORTS);
+    labels = tracked_malloc((length + 1) * sizeof(char *), MEM_REPORTS);
+    block_of = tracked_malloc((length + 1) * sizeof(int), MEM_REPORTS);
+    stack = tracked_malloc(length * sizeof(int), MEM_REPORTS);
+    blocks = tracked_malloc(length * sizeof(Block), MEM_REPORTS);
+    if (words == NULL || labels == NULL || block_of == NULL || stack == NULL || blocks == NULL) {
+        printf("Error: Memory allocation failed\n");
+        length = 0;
+    }
+    for (; length > 0 && code_head != NULL; code_head = code_head->next)
+        words[code_head->IC - IC_INITIAL] = code_head->value;
+    /* Marking the first instruction of every block: labels, jump targets and instructions after a flow change */
+    for (i = 0; i < length; i++) {
+        labels[i] = NULL;
+        block_of[i] = NO_BLOCK;
+    }
+    if (length > 0)
+        block_of[length] = NO_BLOCK;
+    for (symbol = 0; length > 0 && symbol < table->count; symbol++)
+        if ((table->types[symbol] == CODE || table->types[symbol] == ENTRY) &&
+            table->addresses[symbol] >= IC_INITIAL && table->addresses[symbol] < ICF)
+            labels[table->addresses[symbol] - IC_INITIAL] = symbol_name(symbol);
+    for (i = 0; i < length; i += decoded.length) {
+        if (decode_instruction(words + i, length - i, IC_INITIAL + i, &decoded)) {
+            printf("Error: cost estimate stopped at an undecodable word at address %07d\n", IC_INITIAL + i);
+            length = 0;
+            break;
+        }
+        if (i == 0 || labels[i] != NULL)
+            block_of[i] = 0;
+        if (flows[decoded.id] != FLOW_NEXT)
+            block_of[i + decoded.length] = 0;
+        if (flows[decoded.id] >= FLOW_JUMP && flows[decoded.id] <= FLOW_CALL &&
+            (target = jump_target(&decoded, ICF)) >= 0)
+            block_of[target - IC_INITIAL] = 0;
+    }
+    /* Numbering the blocks in address order */
+    for (i = 0; i < length; i++) {
+        if (block_of[i] == NO_BLOCK)
+            continue;
+        block = &blocks[count];
+        block->start = IC_INITIAL + i;
+        block->instructions = 0;
+        block->cycles = 0;
+        block->label = labels[i];
+        block->call = 0;
+        block->successors[0] = NO_BLOCK;
+        block->successors[1] = NO_BLOCK;
+        block->state = 0;
+        block_of[i] = count++;
+    }
+    /* Summing the blocks and linking them to their successors */
+    block = NULL;
+    for (i = 0; i < length; i += decoded.length) {
+        decode_instruction(words + i, length - i, IC_INITIAL + i, &decoded);
+        if (block_of[i] != NO_BLOCK)
+            block = &blocks[block_of[i]];
+        block->instructions++;
+        block->cycles += cycles_of(&decoded);
+        target = jump_target(&decoded, ICF);
+        block->successors[0] = NO_BLOCK;
+        block->successors[1] = NO_BLOCK;
+        block->call = flows[decoded.id] == FLOW_CALL;
+        switch (flows[decoded.id]) {
+            case FLOW_BRANCH:
+            case FLOW_CALL:
+                block->successors[1] = target >= 0 ? block_of[target - IC_INITIAL] : NO_BLOCK;
+                /* Falls through to the next instruction as well */
+            case FLOW_NEXT:
+                if (i + decoded.length < length)
+                    block->successors[0] = block_of[i + decoded.length];
+                break;
+            case FLOW_JUMP:
+                block->successors[0] = target >= 0 ? block_of[target - IC_INITIAL] : NO_BLOCK;
+                break;
+            default:
+                break;
+        }
+    }
+    if (length > 0) {
+        longest_path(blocks, stack, 0);
+        print_cost(name, blocks, count);
+    }
+    tracked_free(words);
+    tracked_free(labels);
+    tracked_free(block_of);
+    tracked_free(stack);
+    tracked_free(blocks);
+}
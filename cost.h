@@ -0,0 +1,24 @@
+#ifndef COST_H
+#define COST_H
+
+#include "code_list.h"
+
+/**
+ * Enables the cycle-cost estimate and loads its cost table.
+ * @param table_name Name of a cost-table file with "name cycles" lines, or NULL for the default table.
+ * @return 0 on success, 1 if the table could not be loaded (an error is printed).
+ */
+int set_cost_report(const char *table_name);
+
+
+/**
+ * Splits the code of the current file into basic blocks and prints the estimated cycles
+ * per block, per label and along the longest acyclic path, if the estimate is enabled.
+ * Must be called after the second pass, while the symbols are still defined.
+ * @param name The name of the file.
+ * @param code_head The head of the code list.
+ * @param ICF The final instruction counter.
+ */
+void report_cost(const char *name, const Code *code_head, int ICF);
+
+#endif
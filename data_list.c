@@ -7,12 +7,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "data_list.h"
+#include "alloc.h"
 
 
 int add_data(unsigned int DC, unsigned int value, Data **head) {
     Data *last_Data;
 
-    Data *new_Data = malloc(sizeof(Data));
+    Data *new_Data = tracked_malloc(sizeof(Data), MEM_DATA);
     if (new_Data == NULL) {
         printf("Error: Memory allocation failed\n");
         return 1;
@@ -50,7 +51,7 @@ void free_data_list(Data **head) {
     while (current != NULL) {
         temp = current;
         current = current->next;
-        free(temp);
+        tracked_free(temp);
     }
 
     *head = NULL;
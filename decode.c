@@ -0,0 +1,105 @@
+/**
+ * @file decode.c
+ * @brief Decoding of machine words back into instructions.
+ *
+ * This is the inverse of the encoding in machine_code.c: the opcode, funct,
+ * addressing methods and registers are read from the fields of the first word,
+ * and the operand values from the extra words that follow it. The instruction is
+ * found through a reverse (opcode, funct) table built once from INSTRUCTIONS.
+ */
+#include "decode.h"
+
+#define OPCODES_COUNT (MASK_OPCODE + 1)
+#define FUNCTS_COUNT (MASK_FUNCT + 1)
+#define ARE_MASK 7
+
+static signed char lookup[OPCODES_COUNT][FUNCTS_COUNT];
+static int lookup_ready = 0;
+
+/* Builds the reverse (opcode, funct) table of INSTRUCTIONS */
+static void init_lookup() {
+    int i, j;
+
+    for (i = 0; i < OPCODES_COUNT; i++)
+        for (j = 0; j < FUNCTS_COUNT; j++)
+            lookup[i][j] = -1;
+    for (i = 0; i < INSTRUCTIONS_COUNT; i++)
+        lookup[INSTRUCTIONS[i].opcode][INSTRUCTIONS[i].funct] = (signed char) i;
+    lookup_ready = 1;
+}
+
+/* Checks if a method is one of the legal methods of an operand */
+static int is_method_allowed(valid_methods methods, int method) {
+    return methods >> method & 1;
+}
+
+/* Decodes one operand from its fields and, if needed, the next extra word */
+static int decode_operand(const unsigned int *words, int available, int address, int method, int reg,
+                          Decoded_Instruction *result, Decoded_Operand *operand) {
+    unsigned int word;
+
+    operand->present = 1;
+    operand->method = (Addressing_Method) method;
+    operand->reg = reg;
+    operand->value = 0;
+    operand->are = 0;
+    if (method == DIRECT_REGISTER)
+        return 0;
+    if (reg != 0 || result->length >= available)
+        return 1; /* Indicates a register field on a memory operand, or a missing extra word */
+    word = words[result->length++];
+    operand->are = (int) (word & ARE_MASK);
+    operand->value = word_value(word);
+    switch (method) {
+        case IMMEDIATE:
+            return operand->are != BIT_ABSOLUTE_FLAG;
+        case RELATIVE:
+            operand->value += address;
+            return operand->are != BIT_ABSOLUTE_FLAG;
+        default:
+            operand->value = (int) ((word >> VALUE_POS) & MASK_VALUE); /* Addresses are unsigned */
+            return operand->are != BIT_MASK_RELOCATABLE && operand->are != BIT_MASK_EXTERNAL;
+    }
+}
+
+int word_value(unsigned int word) {
+    int value = (int) ((word >> VALUE_POS) & MASK_VALUE);
+    return value > MAX_VALUE ? value - (MAX_VALUE + 1) * TWO : value;
+}
+
+int decode_instruction(const unsigned int *words, int available, int address, Decoded_Instruction *result) {
+    unsigned int word;
+    int id, source_method, source_reg, destination_method, destination_reg;
+
+    if (!lookup_ready)
+        init_lookup();
+    if (available < 1)
+        return 1;
+    word = words[0];
+    if ((word & ARE_MASK) != BIT_ABSOLUTE_FLAG || word > MASK_WORD)
+        return 1;
+    id = lookup[(word >> OPCODE_POS) & MASK_OPCODE][(word >> FUNCS_POS) & MASK_FUNCT];
+    if (id < 0)
+        return 1;
+    source_method = (int) (word >> SRC_OPERAND_POS) & METHOD_MASK;
+    source_reg = (int) (word >> SRC_REGISTER_POS) & REGISTER_MASK;
+    destination_method = (int) (word >> DST_OPERAND_POS) & METHOD_MASK;
+    destination_reg = (int) (word >> DST_REGISTER_POS) & REGISTER_MASK;
+
+    result->id = id;
+    result->length = 1;
+    result->source.present = 0;
+    result->destination.present = 0;
+    if (INSTRUCTIONS[id].operands_num == 2) {
+        if (!is_method_allowed(INSTRUCTIONS[id].source_methods, source_method) ||
+            decode_operand(words, available, address, source_method, source_reg, result, &result->source))
+            return 1;
+    } else if (source_method != 0 || source_reg != 0) {
+        return 1; /* Indicates the unused source fields are not empty */
+    }
+    if (INSTRUCTIONS[id].operands_num >= 1)
+        return !is_method_allowed(INSTRUCTIONS[id].destination_methods, destination_method) ||
+               decode_operand(words, available, address, destination_method, destination_reg, result,
+                              &result->destination);
+    return destination_method != 0 || destination_reg != 0;
+}
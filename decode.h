@@ -0,0 +1,41 @@
+#ifndef DECODE_H
+#define DECODE_H
+
+#include "const.h"
+
+/* An operand of a decoded instruction */
+typedef struct Decoded_Operand {
+    int present; /* 0 if the instruction has no such operand */
+    Addressing_Method method;
+    int reg; /* Register number of a DIRECT_REGISTER operand */
+    int value; /* IMMEDIATE: the number, DIRECT: the address, RELATIVE: the target address */
+    int are; /* A.R.E bits of the extra word (0 for registers) */
+} Decoded_Operand;
+
+/* An instruction decoded from its first word and extra words */
+typedef struct Decoded_Instruction {
+    int id; /* Index of the instruction in INSTRUCTIONS */
+    int length; /* Number of words, including the extra words */
+    Decoded_Operand source;
+    Decoded_Operand destination;
+} Decoded_Instruction;
+
+/**
+ * Gets the sign-extended value of the 21 bits above the A.R.E bits of a word.
+ * @param word The word
+ * @return The signed value
+ */
+int word_value(unsigned int word);
+
+
+/**
+ * Decodes the instruction that starts at a word, using the bit layout of machine_code.c.
+ * @param words The words starting at the first word of the instruction
+ * @param available The number of words that can be read
+ * @param address The address of the first word
+ * @param result The decoded instruction
+ * @return 0 on success, 1 if the words are not a legal instruction
+ */
+int decode_instruction(const unsigned int *words, int available, int address, Decoded_Instruction *result);
+
+#endif
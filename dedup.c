@@ -0,0 +1,215 @@
+/**
+ * @file dedup.c
+ * @brief Merging of identical labeled data blocks.
+ *
+ * A data label owns the data words up to the next data label, like in strip.c. Every
+ * block is turned into a key of WORD_DIGITS hex digits per word and inserted in a hash table, so
+ * a block that repeats an earlier one is found in one lookup. The label of a repeated
+ * block is moved onto the earlier copy before compact.c drops its words, so the label
+ * ends up as an alias of the copy.
+ *
+ * Merged blocks share their words, so a block is only merged when nothing can tell the
+ * copies apart: a block whose label is the direct destination of an instruction that
+ * writes it (mov, add, sub, lea, clr, not, inc, dec or red), or is named by ".entry" for
+ * other modules, keeps its own words.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "dedup.h"
+#include "compact.h"
+#include "hash_table.h"
+#include "machine_code.h"
+#include "symbols_list.h"
+#include "validations.h"
+#include "const.h"
+#include "alloc.h"
+#include "trace.h"
+
+/* Instructions that write their destination operand */
+static const char *WRITERS[] = {"mov", "add", "sub", "lea", "clr", "not", "inc", "dec", "red"};
+#define WRITERS_COUNT (sizeof(WRITERS) / sizeof(WRITERS[0]))
+
+static int enabled = 0;
+
+void set_dedup(int value) {
+    enabled = value;
+}
+
+/* Finds the label that starts at every data word, returns the number of labels */
+static int find_data_labels(int *label_at, int ICF, int DC) {
+    const Symbol_Table *table = get_symbol_table();
+    int symbol, index, count = 0;
+
+    for (index = 0; index < DC; index++)
+        label_at[index] = NO_SYMBOL;
+    for (symbol = 0; symbol < table->count; symbol++) {
+        index = table->addresses[symbol] - ICF;
+        if (table->types[symbol] == DATA && index >= 0 && index < DC) {
+            label_at[index] = symbol;
+            count++;
+        }
+    }
+    return count;
+}
+
+/* Checks if an instruction writes its destination operand */
+static int is_writer(int id) {
+    int i;
+
+    for (i = 0; id >= 0 && i < (int) WRITERS_COUNT; i++)
+        if (strcmp(INSTRUCTIONS[id].instruction, WRITERS[i]) == 0)
+            return 1;
+    return 0;
+}
+
+/* Marks the data block of a label as one that keeps its own words */
+static void fix_block(char *fixed, int label, int ICF, int DC) {
+    const Symbol_Table *table = get_symbol_table();
+    int index;
+
+    if (label == NO_SYMBOL || table->types[label] != DATA)
+        return;
+    index = table->addresses[label] - ICF;
+    if (index >= 0 && index < DC)
+        fixed[index] = 1;
+}
+
+/* Marks the blocks that instructions write to or ".entry" names, returns 0 on success */
+static int find_fixed_blocks(char *file_name, const Code *code_head, char *destination, char *fixed, int ICF,
+                             int DC) {
+    const Symbol_Table *table = get_symbol_table();
+    char name[MAX_LINE_LENGTH];
+    FILE *file;
+    int symbol, extra, index;
+
+    memset(destination, 0, ICF - IC_INITIAL + 1);
+    memset(fixed, 0, DC + 1);
+    /* The direct destination of a writer is the last word of the instruction */
+    while (code_head != NULL) {
+        extra = extra_words_of(code_head->value);
+        if (is_writer(instruction_of(code_head->value)) &&
+            ((code_head->value >> DST_OPERAND_POS) & METHOD_MASK) == DIRECT)
+            destination[code_head->IC + extra - IC_INITIAL] = 1;
+        for (; code_head != NULL && extra >= 0; extra--)
+            code_head = code_head->next;
+    }
+    /* Every fixup holds the address of its operand word */
+    for (symbol = 0; symbol < table->count; symbol++) {
+        index = table->addresses[symbol] - IC_INITIAL;
+        if (table->types[symbol] == OPERAND && index >= 0 && index < ICF - IC_INITIAL && destination[index])
+            fix_block(fixed, is_label_defined(symbol_name(symbol)), ICF, DC);
+    }
+    file = open_entry_lines(file_name);
+    if (file == NULL)
+        return 1;
+    while (next_entry_name(file, name))
+        fix_block(fixed, is_label_defined(name), ICF, DC);
+    fclose(file);
+    return 0;
+}
+
+/* Marks the words of repeated blocks as dropped and aliases their labels, returns the number of dropped words */
+static int merge_blocks(int *label_at, const unsigned int *values, const char *fixed, char *keys, char *dropped,
+                        int DC, Hash_Table *blocks, int *merged) {
+    Symbol_Table *table = get_symbol_table();
+    Hash_Slot *slot;
+    char *key;
+    int start = 0, end, word, status, words = 0;
+
+    *merged = 0;
+    while (start < DC) {
+        if (label_at[start] == NO_SYMBOL) {
+            start++; /* Unlabeled data before the first label */
+            continue;
+        }
+        for (end = start + 1; end < DC && label_at[end] == NO_SYMBOL; end++) {
+        }
+        if (fixed[start]) {
+            start = end; /* Indicates the block keeps its own words */
+            continue;
+        }
+        key = keys;
+        for (word = start; word < end; word++) {
+            sprintf(keys, "%0*x", WORD_DIGITS, values[word]);
+            keys += WORD_DIGITS;
+        }
+        *keys++ = NULL_TERMINATOR;
+        status = hash_insert(blocks, key, start);
+        if (status < 0) {
+            printf("Error: Memory allocation failed\n");
+            return -1;
+        }
+        if (status == 1) {
+            /* Indicates the block repeats an earlier one */
+            slot = hash_find(blocks, key);
+            printf("Dedup: \"%s\" aliases \"%s\" (%d words)\n", symbol_name(label_at[start]),
+                   symbol_name(label_at[slot->value]), end - start);
+            table->addresses[label_at[start]] = table->addresses[label_at[slot->value]];
+            for (word = start; word < end; word++)
+                dropped[word] = 1;
+            words += end - start;
+            (*merged)++;
+        }
+        start = end;
+    }
+    return words;
+}
+
+int dedup(char *file_name, Code **code_head, Data **data_head, int *IC, int *DC) {
+    int *label_at;
+    unsigned int *values;
+    char *keys, *dropped, *destination, *fixed;
+    int *code_address, *data_address;
+    int code_words = *IC - IC_INITIAL, word, address, labels, words = 0, merged = 0;
+    Hash_Table blocks;
+    const Data *current;
+
+    if (!enabled)
+        return 0;
+    trace_begin("dedup");
+    label_at = tracked_malloc(*DC * sizeof(int) + 1, MEM_TEMP);
+    values = tracked_malloc(*DC * sizeof(unsigned int) + 1, MEM_TEMP);
+    keys = tracked_malloc(*DC * (WORD_DIGITS + 1) + 1, MEM_TEMP);
+    dropped = tracked_malloc(*DC + 1, MEM_TEMP);
+    destination = tracked_malloc(code_words + 1, MEM_TEMP);
+    fixed = tracked_malloc(*DC + 1, MEM_TEMP);
+    code_address = tracked_malloc((code_words + 1) * sizeof(int), MEM_TEMP);
+    data_address = tracked_malloc((*DC + 1) * sizeof(int), MEM_TEMP);
+    labels = label_at != NULL ? find_data_labels(label_at, *IC, *DC) : 0;
+    if (label_at == NULL || values == NULL || keys == NULL || dropped == NULL || destination == NULL ||
+        fixed == NULL || code_address == NULL || data_address == NULL || init_hash_table(&blocks, labels) != 0) {
+        printf("Error: Memory allocation failed\n");
+        words = -1;
+    } else if (find_fixed_blocks(file_name, *code_head, destination, fixed, *IC, *DC) != 0) {
+        free_hash_table(&blocks);
+        words = -1;
+    } else {
+        for (current = *data_head, word = 0; current != NULL && word < *DC; current = current->next)
+            values[word++] = current->value;
+        memset(dropped, 0, *DC + 1);
+        words = merge_blocks(label_at, values, fixed, keys, dropped, *DC, &blocks, &merged);
+        free_hash_table(&blocks);
+    }
+
+    if (words > 0) {
+        for (word = 0; word <= code_words; word++)
+            code_address[word] = IC_INITIAL + word;
+        for (word = 0, address = DC_INITIAL; word < *DC; word++)
+            data_address[word] = dropped[word] ? address : address++;
+        data_address[*DC] = address;
+        compact_image(code_head, data_head, code_address, data_address, IC, DC);
+    }
+    if (words >= 0)
+        printf("Dedup merged %d data blocks (%d words)\n", merged, words);
+
+    tracked_free(label_at);
+    tracked_free(values);
+    tracked_free(keys);
+    tracked_free(dropped);
+    tracked_free(destination);
+    tracked_free(fixed);
+    tracked_free(code_address);
+    tracked_free(data_address);
+    trace_end("dedup");
+    return words < 0;
+}
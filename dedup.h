@@ -0,0 +1,30 @@
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include "code_list.h"
+#include "data_list.h"
+
+/**
+ * Enables the merging of identical labeled data blocks between the first and second pass.
+ * @param enabled 1 to enable the merging, 0 to disable it.
+ */
+void set_dedup(int enabled);
+
+
+/**
+ * Merges every labeled ".data"/".string" block of the current file that repeats an earlier
+ * one into that copy, if the merging is enabled. The label of a merged block becomes an
+ * alias of the copy, and the following data moves down. A block that an instruction writes
+ * to, or whose label is named by ".entry", keeps its own words. Prints every merged label
+ * and the number of saved words. Must be called after the first pass, before the operands
+ * are resolved.
+ * @param file_name The name of the file, whose ".am" file holds the ".entry" lines.
+ * @param code_head Pointer to the head of the code list.
+ * @param data_head Pointer to the head of the data list.
+ * @param IC Pointer to the final instruction counter.
+ * @param DC Pointer to the final data counter, lowered by the merged words.
+ * @return 0 on success, 1 if the ".am" file could not be read or memory allocation failed.
+ */
+int dedup(char *file_name, Code **code_head, Data **data_head, int *IC, int *DC);
+
+#endif
@@ -0,0 +1,314 @@
+/**
+ * @file disassembler.c
+ * @brief Disassembler of .ob images.
+ * @details Prints an .ob image as source-like assembly. Code words are decoded with
+ *          the reverse (opcode, funct) table of decode.c and operands are printed with
+ *          the names of REGISTERS. Labels come from the .ent file, extern operands take
+ *          their name from the .ext file, and other referenced addresses are printed as
+ *          "L<address>" with a "L<address>:" label on their line, so the output can be
+ *          assembled again. Every line ends with the address of its first word, and data
+ *          words are printed as ".data" or, for runs of characters, as ".string". When
+ *          the module has a .dbg file, an instruction also shows its line in the .as file.
+ *
+ *          The words are streamed through a window of one instruction, twice: the first
+ *          pass collects the referenced addresses and the second prints. Only the symbols
+ *          of the .ent/.ext files and the referenced addresses are kept in memory.
+ *
+ *          Usage: disassembler module
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "object_file.h"
+#include "decode.h"
+#include "const.h"
+
+#define MAX_INSTRUCTION_LENGTH 3
+#define TEXT_LENGTH 128 /* Room for an instruction with two label operands */
+#define COMMENT_COLUMN 40
+#define MAX_STRING_LENGTH 72 /* Longer character runs are printed as .data */
+#define INITIAL_TARGETS 64
+#define LABEL_LENGTH 16 /* Room for "L" and an address */
+
+static Object_Module symbols; /* The entries and extern uses of the module, sorted by address */
+static Debug_File debug; /* The source lines of the instructions, empty without a .dbg file */
+static const char *module_name;
+static char string[MAX_STRING_LENGTH + 1]; /* Pending characters of a .string */
+static int string_length = 0;
+static int string_address = 0;
+static int *targets = NULL; /* Referenced addresses without a label in the .ent file, sorted */
+static int targets_count = 0;
+static int targets_capacity = 0;
+
+/* Orders symbols by name */
+static int compare_names(const void *first, const void *second) {
+    return strcmp(((const Object_Symbol *) first)->name, ((const Object_Symbol *) second)->name);
+}
+
+/* Orders symbols by address */
+static int compare_symbols(const void *first, const void *second) {
+    return ((const Object_Symbol *) first)->address - ((const Object_Symbol *) second)->address;
+}
+
+/* Finds the symbol of an address, returns NULL if there is none */
+static const Object_Symbol *find_symbol(const Object_Symbol *sorted, int count, int address) {
+    Object_Symbol key;
+    key.name = NULL;
+    key.address = address;
+    return count ? bsearch(&key, sorted, count, sizeof(Object_Symbol), compare_symbols) : NULL;
+}
+
+/* Orders addresses */
+static int compare_addresses(const void *first, const void *second) {
+    return *(const int *) first - *(const int *) second;
+}
+
+/* Gets the label of an address, NULL if it has none */
+static const char *label_of(int address) {
+    static char generated[LABEL_LENGTH];
+    const Object_Symbol *entry = find_symbol(symbols.entries, symbols.entries_count, address);
+
+    if (entry != NULL)
+        return entry->name;
+    if (targets_count == 0 || bsearch(&address, targets, targets_count, sizeof(int), compare_addresses) == NULL)
+        return NULL;
+    sprintf(generated, "L%d", address);
+    return generated;
+}
+
+/* Adds the address an operand refers to if it needs a generated label, returns 0 on success */
+static int add_target(const Decoded_Operand *operand) {
+    int *grown;
+
+    if (!operand->present || operand->method == IMMEDIATE || operand->method == DIRECT_REGISTER)
+        return 0;
+    if (operand->method != RELATIVE && operand->are == BIT_MASK_EXTERNAL)
+        return 0; /* Extern operands are named from the .ext file */
+    if (find_symbol(symbols.entries, symbols.entries_count, operand->value) != NULL)
+        return 0;
+    if (targets_count == targets_capacity) {
+        grown = realloc(targets, (targets_capacity ? targets_capacity * 2 : INITIAL_TARGETS) * sizeof(int));
+        if (grown == NULL) {
+            printf("Error: Memory allocation failed\n");
+            return 1;
+        }
+        targets = grown;
+        targets_capacity = targets_capacity ? targets_capacity * 2 : INITIAL_TARGETS;
+    }
+    targets[targets_count++] = operand->value;
+    return 0;
+}
+
+/* Sorts the referenced addresses and removes the duplicates */
+static void sort_targets() {
+    int i, kept = 0;
+
+    qsort(targets, targets_count, sizeof(int), compare_addresses);
+    for (i = 0; i < targets_count; i++)
+        if (kept == 0 || targets[kept - 1] != targets[i])
+            targets[kept++] = targets[i];
+    targets_count = kept;
+}
+
+/* Prints a line with its optional label and the address comment, with the source line if it is known */
+static void print_line(int address, const char *text) {
+    const char *label = label_of(address);
+    Debug_Line line;
+    int length;
+
+    length = label ? printf("%s: %s", label, text) : printf("    %s", text);
+    printf("%*s; %07d", length < COMMENT_COLUMN ? COMMENT_COLUMN - length : 1, "", address);
+    if (find_debug_line(&debug, address, &line)) {
+        printf(" %s.as line %d", module_name, line.line);
+        if (line.macro != NULL)
+            printf(" (macro \"%s\" line %d)", line.macro, line.macro_line);
+    }
+    printf("\n");
+}
+
+/* Writes the text of an operand */
+static void operand_text(const Decoded_Operand *operand, int word_address, char *text) {
+    const Object_Symbol *symbol;
+
+    switch (operand->method) {
+        case IMMEDIATE:
+            sprintf(text, "#%d", operand->value);
+            return;
+        case DIRECT_REGISTER:
+            strcpy(text, REGISTERS[operand->reg]);
+            return;
+        case RELATIVE:
+            *text++ = AMPERSAND;
+            break;
+        default:
+            if (operand->are == BIT_MASK_EXTERNAL) {
+                symbol = find_symbol(symbols.externs, symbols.externs_count, word_address);
+                strcpy(text, symbol ? symbol->name : "?");
+                return;
+            }
+    }
+    symbol = find_symbol(symbols.entries, symbols.entries_count, operand->value);
+    if (symbol != NULL)
+        strcpy(text, symbol->name);
+    else
+        sprintf(text, "L%d", operand->value);
+}
+
+/* Prints a decoded instruction */
+static void print_instruction(int address, const Decoded_Instruction *decoded) {
+    char text[TEXT_LENGTH];
+    char *end = text + sprintf(text, "%s", INSTRUCTIONS[decoded->id].instruction);
+    int word_address = address + 1;
+
+    if (decoded->source.present) {
+        *end++ = ' ';
+        operand_text(&decoded->source, word_address, end);
+        end += strlen(end);
+        word_address += decoded->source.method != DIRECT_REGISTER;
+    }
+    if (decoded->destination.present) {
+        end += sprintf(end, decoded->source.present ? ", " : " ");
+        operand_text(&decoded->destination, word_address, end);
+    }
+    print_line(address, text);
+}
+
+/* Prints the pending characters as a .string */
+static void flush_string() {
+    char text[TEXT_LENGTH];
+
+    if (string_length == 0)
+        return;
+    string[string_length] = NULL_TERMINATOR;
+    sprintf(text, ".string \"%s\"", string);
+    print_line(string_address, text);
+    string_length = 0;
+}
+
+/* Prints the pending characters as .data */
+static void flush_data() {
+    char text[TEXT_LENGTH];
+    int i;
+
+    for (i = 0; i < string_length; i++) {
+        sprintf(text, ".data %d", string[i]);
+        print_line(string_address + i, text);
+    }
+    string_length = 0;
+}
+
+/* Prints a data word, collecting printable characters that end with a zero into a .string */
+static void print_data(int address, unsigned int word) {
+    char text[TEXT_LENGTH];
+
+    if (string_length > 0 && label_of(address) != NULL)
+        flush_data(); /* A label in the middle ends the run */
+    if (word == 0 && string_length > 0) {
+        flush_string();
+        return;
+    }
+    if (word < 128 && isprint((int) word) && word != DOUBLE_QUOTE && string_length < MAX_STRING_LENGTH) {
+        if (string_length == 0)
+            string_address = address;
+        string[string_length++] = (char) word;
+        return;
+    }
+    flush_data();
+    sprintf(text, ".data %d", (int) (word ^ SIGN_WORD) - SIGN_WORD);
+    print_line(address, text);
+}
+
+/* Prints the entry and extern declarations of the module, then sorts the symbols by address */
+static void print_declarations() {
+    int i;
+
+    for (i = 0; i < symbols.entries_count; i++)
+        printf(".entry %s\n", symbols.entries[i].name);
+    qsort(symbols.externs, symbols.externs_count, sizeof(Object_Symbol), compare_names);
+    for (i = 0; i < symbols.externs_count; i++)
+        if (i == 0 || strcmp(symbols.externs[i - 1].name, symbols.externs[i].name) != 0)
+            printf(".extern %s\n", symbols.externs[i].name);
+    qsort(symbols.entries, symbols.entries_count, sizeof(Object_Symbol), compare_symbols);
+    qsort(symbols.externs, symbols.externs_count, sizeof(Object_Symbol), compare_symbols);
+}
+
+/* Streams the words of an image, collecting the referenced addresses or printing the words */
+static int disassemble(Object_Reader *reader, int collect) {
+    unsigned int window[MAX_INSTRUCTION_LENGTH];
+    Decoded_Instruction decoded;
+    int count = 0, status = 1, code_end = IC_INITIAL + reader->code_length, address = IC_INITIAL, i;
+
+    while (count > 0 || status == 1) {
+        while (count < MAX_INSTRUCTION_LENGTH && status == 1 &&
+               (status = read_object_word(reader, &window[count])) == 1)
+            count++;
+        if (status == -1)
+            return 1;
+        if (count == 0)
+            break;
+        if (address >= code_end) {
+            if (!collect)
+                print_data(address, window[0]);
+            decoded.length = 1;
+        } else if (decode_instruction(window, code_end - address < count ? code_end - address : count, address,
+                                      &decoded) == 0) {
+            if (!collect)
+                print_instruction(address, &decoded);
+            else if (add_target(&decoded.source) || add_target(&decoded.destination))
+                return 1;
+        } else {
+            if (!collect) {
+                print_data(address, window[0]);
+                flush_data();
+            }
+            decoded.length = 1;
+        }
+        for (i = decoded.length; i < count; i++)
+            window[i - decoded.length] = window[i];
+        count -= decoded.length;
+        address += decoded.length;
+    }
+    if (!collect)
+        flush_data();
+    return 0;
+}
+
+/**
+ * @brief Disassembles the module given on the command line.
+ * @param argc The number of command-line arguments.
+ * @param argv An array of command-line arguments.
+ * @return 0 on success, 1 on failure.
+ */
+int main(int argc, char *argv[]) {
+    Object_Reader reader;
+    int error;
+
+    if (argc != 2) {
+        printf("Usage: disassembler module\n");
+        return 1;
+    }
+    memset(&symbols, 0, sizeof(symbols));
+    module_name = argv[1];
+    if (load_object_symbols(argv[1], &symbols) || open_debug_file(argv[1], &debug) > 0 ||
+        open_object_reader(argv[1], &reader)) {
+        free_object_module(&symbols);
+        close_debug_file(&debug);
+        return 1;
+    }
+    printf("; %s: %d code words, %d data words\n", reader.file_name, reader.code_length, reader.data_length);
+    print_declarations();
+    error = disassemble(&reader, 1);
+    close_object_reader(&reader);
+    if (!error && open_object_reader(argv[1], &reader) == 0) { /* Rewinding for the printing pass */
+        sort_targets();
+        error = disassemble(&reader, 0);
+        close_object_reader(&reader);
+    } else {
+        error = 1;
+    }
+    free(targets);
+    close_debug_file(&debug);
+    free_object_module(&symbols);
+    return error;
+}
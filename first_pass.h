@@ -32,6 +32,19 @@ int first_pass(char *file_name, Data **data_head, Code **code_head, int *IC, int
  */
 int scan_am_file(char *file_name, Data **data_head, Code **code_head, int *IC, int *DC);
 
+/**
+ * Scans the expanded source kept in memory like scan_am_file scans the .am file.
+ *
+ * @param file_name The name the .am file would have, used in the error messages.
+ * @param text The expanded source.
+ * @param data_head Pointer to the pointer to the data list head.
+ * @param code_head Pointer to the pointer to the code list head.
+ * @param IC Pointer to the Instruction Counter.
+ * @param DC Pointer to the Data Counter.
+ * @return 0 if no errors were detected, 1 otherwise.
+ */
+int scan_am_text(char *file_name, const char *text, Data **data_head, Code **code_head, int *IC, int *DC);
+
 /**
  * Processes a single line of the file to identify and handle instructions,
  * data declarations, and labels.
@@ -45,34 +58,9 @@ int scan_am_file(char *file_name, Data **data_head, Code **code_head, int *IC, i
  * @param file_name The name of the file being processed.
  * @param line The line of text being processed.
  * @param error Pointer to the error flag.
- * @param file File pointer for reading additional content if needed.
+ * @param file File pointer for reading additional content if needed, NULL for a source in memory.
  */
 void process_each_line(Code **code_head, Data **data_head, int *usage, int *IC, int *DC,
                        int line_num, char *file_name, char *line, int *error, FILE *file);
 
-/**
- * Checks whether the current word is a valid symbol (label) and processes it.
- *
- * @param current_word The current word being processed.
- * @param line_num The current line number.
- * @param file_name The name of the file.
- * @param file File pointer to the current file.
- * @param line The full line being parsed.
- * @param label Buffer to store the detected label name.
- * @return 1 if it's a valid symbol, 0 otherwise.
- */
-int is_symbol(char *current_word, int line_num, char *file_name, FILE *file, char *line, char *label);
-
-
-/**
- * Cleans up all allocated resources and exits the program.
- *
- * @param file File pointer to close.
- * @param file_name Name of the file being processed.
- * @param data_head Pointer to the pointer to the head of the data list.
- * @param code_head Pointer to the pointer to the head of the code list.
- * @param current_word Pointer to the current word being processed.
- */
-void cleanup_and_exit(FILE *file, char *file_name, Data **data_head, Code **code_head, char *current_word);
-
 #endif
@@ -0,0 +1,146 @@
+/**
+ * @file harness.c
+ * @brief Helpers shared by the performance harness and the correctness checks.
+ * @details Both programs assemble files in-process with the standard output discarded
+ *          and compare the outputs with the golden "<name>.v.<ext>" files of the corpus.
+ */
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "harness.h"
+#include "assemble.h"
+#include "util.h"
+#include "alloc.h"
+#include "const.h"
+
+const char *OUTPUT_EXTENSIONS[] = {".ob", ".ent", ".ext"};
+
+int silence_stdout() {
+    int saved, null_fd;
+
+    fflush(stdout);
+    saved = dup(STDOUT_FILENO);
+    null_fd = open("/dev/null", O_WRONLY);
+    if (saved < 0 || null_fd < 0) {
+        if (saved >= 0)
+            close(saved);
+        if (null_fd >= 0)
+            close(null_fd);
+        return -1; /* Cannot redirect, the output stays visible */
+    }
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+    return saved;
+}
+
+void restore_stdout(int saved) {
+    if (saved < 0)
+        return;
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+}
+
+int assemble_quietly(char *name) {
+    int saved = silence_stdout();
+    int status = assemble_file(name);
+
+    restore_stdout(saved);
+    return status;
+}
+
+/* Reads the next whitespace separated token in lower case, returns 0 at end of file */
+static int next_token(FILE *file, char *token, int size) {
+    int ch, length = 0;
+
+    while ((ch = fgetc(file)) != EOF && isspace(ch)) {
+    }
+    while (ch != EOF && !isspace(ch)) {
+        if (length < size - 1)
+            token[length++] = (char) tolower(ch);
+        ch = fgetc(file);
+    }
+    token[length] = NULL_TERMINATOR;
+    return length > 0;
+}
+
+/* Compares two output files ignoring whitespace layout and hexadecimal letter case */
+static int same_output(const char *output_name, const char *golden_name) {
+    char output_token[MAX_LINE_LENGTH], golden_token[MAX_LINE_LENGTH];
+    int output_more, golden_more, same = 1;
+    FILE *output = fopen(output_name, "r");
+    FILE *golden = fopen(golden_name, "r");
+
+    if (output == NULL || golden == NULL) {
+        same = output == golden; /* Both missing is a match */
+    } else {
+        do {
+            output_more = next_token(output, output_token, MAX_LINE_LENGTH);
+            golden_more = next_token(golden, golden_token, MAX_LINE_LENGTH);
+            if (output_more != golden_more || strcmp(output_token, golden_token) != 0)
+                same = 0;
+        } while (same && output_more);
+    }
+    if (output)
+        fclose(output);
+    if (golden)
+        fclose(golden);
+    return same;
+}
+
+int same_bytes(const char *first_name, const char *second_name) {
+    int first_char, second_char, same = 1;
+    FILE *first = fopen(first_name, "r");
+    FILE *second = fopen(second_name, "r");
+
+    if (first == NULL || second == NULL) {
+        same = first == second; /* Both missing is a match */
+    } else {
+        do {
+            first_char = getc(first);
+            second_char = getc(second);
+        } while (first_char == second_char && first_char != EOF);
+        same = first_char == second_char;
+    }
+    if (first)
+        fclose(first);
+    if (second)
+        fclose(second);
+    return same;
+}
+
+int check_golden(char *name) {
+    char *output_name, *golden_name, *golden_base;
+    FILE *file;
+    int i, mismatches = 0;
+
+    golden_base = add_extension(name, ".v");
+    golden_name = add_extension(golden_base, ".ob");
+    file = fopen(golden_name, "r");
+    tracked_free(golden_name);
+    if (file == NULL) {
+        /* Without a golden .ob the outputs can't be checked */
+        printf("%s: no golden files, outputs not checked\n", name);
+        tracked_free(golden_base);
+        return 0;
+    }
+    fclose(file);
+    /* A missing golden .ent/.ext means the output must not exist either */
+    for (i = 0; i < OUTPUT_EXTENSIONS_COUNT; i++) {
+        output_name = add_extension(name, (char *) OUTPUT_EXTENSIONS[i]);
+        golden_name = add_extension(golden_base, (char *) OUTPUT_EXTENSIONS[i]);
+        if (!same_output(output_name, golden_name)) {
+            printf("MISMATCH: %s differs from %s\n", output_name, golden_name);
+            mismatches++;
+        }
+        tracked_free(output_name);
+        tracked_free(golden_name);
+    }
+    if (mismatches == 0)
+        printf("%s: outputs match golden files\n", name);
+    tracked_free(golden_base);
+    return mismatches;
+}
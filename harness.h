@@ -0,0 +1,49 @@
+#ifndef HARNESS_H
+#define HARNESS_H
+
+#define OUTPUT_EXTENSIONS_COUNT 3
+
+/* Extensions of the files that the assembler writes for a module */
+extern const char *OUTPUT_EXTENSIONS[];
+
+
+/**
+ * Redirects the standard output to /dev/null.
+ * @return The descriptor of the saved standard output, -1 if it could not be redirected.
+ */
+int silence_stdout();
+
+
+/**
+ * Restores the standard output saved by silence_stdout.
+ * @param saved The descriptor returned by silence_stdout.
+ */
+void restore_stdout(int saved);
+
+
+/**
+ * Assembles a file in-process with the standard output discarded.
+ * @param name The file name without extension.
+ * @return The result of the assembler, 0 on success.
+ */
+int assemble_quietly(char *name);
+
+
+/**
+ * Compares two files byte by byte.
+ * @param first_name The first file.
+ * @param second_name The second file.
+ * @return 1 if the files are equal or both missing, 0 otherwise.
+ */
+int same_bytes(const char *first_name, const char *second_name);
+
+
+/**
+ * Checks the outputs of a file against the golden "<name>.v.<ext>" files, ignoring
+ * whitespace layout and hexadecimal letter case. A file without a golden .ob is not checked.
+ * @param name The file name without extension.
+ * @return The number of mismatches.
+ */
+int check_golden(char *name);
+
+#endif
@@ -0,0 +1,91 @@
+/**
+ * @file hash_table.c
+ * @brief Open-addressing hash table from strings to integers.
+ *
+ * Used by the tools that handle many symbols at once (such as the linker), where
+ * the linear label lists of the assembler would make the work quadratic.
+ */
+#include <string.h>
+#include "hash_table.h"
+#include "alloc.h"
+
+#define FNV_OFFSET 2166136261UL
+#define FNV_PRIME 16777619UL
+#define MASK_32BIT 0xffffffffUL
+#define MIN_CAPACITY 16
+
+unsigned long hash_string(const char *str) {
+    unsigned long hash = FNV_OFFSET;
+    while (*str) {
+        hash ^= (unsigned char) *str++;
+        hash = (hash * FNV_PRIME) & MASK_32BIT;
+    }
+    return hash;
+}
+
+int init_hash_table(Hash_Table *table, unsigned long expected) {
+    unsigned long capacity = MIN_CAPACITY;
+
+    while (capacity < expected * 2)
+        capacity *= 2;
+    table->slots = tracked_malloc(capacity * sizeof(Hash_Slot), MEM_TEMP);
+    table->capacity = capacity;
+    table->count = 0;
+    if (table->slots == NULL)
+        return 1;
+    memset(table->slots, 0, capacity * sizeof(Hash_Slot)); /* Marks every slot as empty */
+    return 0;
+}
+
+/* Returns the slot of a key, or the empty slot where it would be inserted */
+static Hash_Slot *probe(const Hash_Table *table, const char *key) {
+    unsigned long i = hash_string(key) & (table->capacity - 1);
+
+    while (table->slots[i].key != NULL && strcmp(table->slots[i].key, key) != 0)
+        i = (i + 1) & (table->capacity - 1); /* Linear probing */
+    return &table->slots[i];
+}
+
+/* Doubles the capacity of the table */
+static int grow(Hash_Table *table) {
+    Hash_Table bigger;
+    unsigned long i;
+
+    bigger.capacity = table->capacity * 2;
+    bigger.count = table->count;
+    bigger.slots = tracked_malloc(bigger.capacity * sizeof(Hash_Slot), MEM_TEMP);
+    if (bigger.slots == NULL)
+        return 1;
+    memset(bigger.slots, 0, bigger.capacity * sizeof(Hash_Slot));
+    for (i = 0; i < table->capacity; i++)
+        if (table->slots[i].key != NULL)
+            *probe(&bigger, table->slots[i].key) = table->slots[i];
+    tracked_free(table->slots);
+    *table = bigger;
+    return 0;
+}
+
+int hash_insert(Hash_Table *table, const char *key, int value) {
+    Hash_Slot *slot;
+
+    if ((table->count + 1) * 2 > table->capacity && grow(table))
+        return -1; /* Indicates memory allocation failed */
+    slot = probe(table, key);
+    if (slot->key != NULL)
+        return 1; /* Indicates key already exists */
+    slot->key = key;
+    slot->value = value;
+    table->count++;
+    return 0;
+}
+
+Hash_Slot *hash_find(const Hash_Table *table, const char *key) {
+    Hash_Slot *slot = probe(table, key);
+    return slot->key != NULL ? slot : NULL;
+}
+
+void free_hash_table(Hash_Table *table) {
+    tracked_free(table->slots);
+    table->slots = NULL;
+    table->capacity = table->count = 0;
+}
@@ -0,0 +1,59 @@
+#ifndef HASH_TABLE_H
+#define HASH_TABLE_H
+
+/* A slot of the table, an empty slot has a NULL key */
+typedef struct Hash_Slot {
+    const char *key;
+    int value;
+} Hash_Slot;
+
+/* Open-addressing table from strings to integers, the keys are not copied */
+typedef struct Hash_Table {
+    Hash_Slot *slots;
+    unsigned long capacity; /* A power of two */
+    unsigned long count;
+} Hash_Table;
+
+/**
+ * Hashes a string (32-bit FNV-1a).
+ * @param str The string to hash.
+ * @return The hash of the string.
+ */
+unsigned long hash_string(const char *str);
+
+
+/**
+ * Initializes an empty table sized for an expected number of keys.
+ * @param table The table to initialize.
+ * @param expected The expected number of keys.
+ * @return 0 on success, 1 if memory allocation failed.
+ */
+int init_hash_table(Hash_Table *table, unsigned long expected);
+
+
+/**
+ * Inserts a key, growing the table when it is more than half full.
+ * @param table The table.
+ * @param key The key; must stay valid while the table is used.
+ * @param value The value of the key.
+ * @return 0 on success, 1 if the key already exists, -1 if memory allocation failed.
+ */
+int hash_insert(Hash_Table *table, const char *key, int value);
+
+
+/**
+ * Looks up a key.
+ * @param table The table.
+ * @param key The key to look up.
+ * @return Pointer to the slot of the key, or NULL if it is not in the table.
+ */
+Hash_Slot *hash_find(const Hash_Table *table, const char *key);
+
+
+/**
+ * Frees the memory of a table (the keys are not freed).
+ * @param table The table to free.
+ */
+void free_hash_table(Hash_Table *table);
+
+#endif
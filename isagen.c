@@ -0,0 +1,415 @@
+/**
+ * @file isagen.c
+ * @brief Compiler of an instruction-set description into the isa.h header.
+ * @details Reads a spec file (such as default.isa) that gives the word width, the
+ *          position and width of every field of the first word, the registers and
+ *          the instructions, checks it, and writes a header with the bit-field
+ *          constants, the INSTRUCTION_LIST and REGISTER_LIST X-macros that const.c
+ *          expands into the instruction and encoding tables, and collision-free slot
+ *          tables for looking up the instruction and register names by their hash.
+ *          Everything is a compile-time constant, so a variant of the machine is
+ *          selected by the build and the assembler keeps no runtime description.
+ *
+ *          Spec lines ('#' starts a comment):
+ *            word <bits>
+ *            <field> <position> <width>   for opcode, funct, source_method,
+ *                                         source_register, destination_method
+ *                                         and destination_register
+ *            registers <name> ...
+ *            instruction <name> <opcode> <funct> <source methods> <destination methods>
+ *          where the methods are the digits of the legal addressing methods, or '-'.
+ *
+ *          Usage: isagen spec_file header_file
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "hash_table.h"
+
+#define MAX_LINE 256
+#define MAX_NAME 31
+#define MAX_INSTRUCTIONS 127 /* Slots are stored as signed char */
+#define MAX_REGISTERS 127
+#define MAX_WORD_BITS 32
+#define MAX_LOOKUP_BITS 8 /* Width limit of the opcode and funct, which index the decoder table */
+#define ARE_BITS 3
+#define METHOD_BITS 2
+#define METHODS_COUNT 4
+#define MAX_SLOTS_FACTOR 16
+#define SEPARATORS " \t\r\n"
+
+/* Fields of the first word, in the order of FIELD_NAMES */
+enum {
+    OPCODE,
+    FUNCT,
+    SOURCE_METHOD,
+    SOURCE_REGISTER,
+    DESTINATION_METHOD,
+    DESTINATION_REGISTER,
+    FIELDS_COUNT
+};
+
+static const char *FIELD_NAMES[] = {
+    "opcode", "funct", "source_method", "source_register", "destination_method", "destination_register"
+};
+
+/* Names of the method sets that const.h declares, by bit mask (a bit per addressing method) */
+static const char *METHOD_SET_NAMES[] = {
+    "NONE", NULL, "METHOD_1", NULL, NULL, NULL, "METHODS_1_2", NULL,
+    NULL, NULL, "METHODS_1_3", "METHODS_0_1_3", NULL, NULL, NULL, NULL
+};
+
+typedef struct Field {
+    int position;
+    int width; /* 0 while the field is not defined */
+} Field;
+
+typedef struct Isa_Instruction {
+    char name[MAX_NAME + 1];
+    int opcode;
+    int funct;
+    int source_methods; /* Bit mask */
+    int destination_methods; /* Bit mask */
+} Isa_Instruction;
+
+typedef struct Isa {
+    int word_bits;
+    Field fields[FIELDS_COUNT];
+    char registers[MAX_REGISTERS][MAX_NAME + 1];
+    int registers_count;
+    Isa_Instruction instructions[MAX_INSTRUCTIONS];
+    int instructions_count;
+} Isa;
+
+static const char *spec_name;
+static int line_num;
+
+/* Prints an error of the current spec line, returns 1 */
+static int spec_error(const char *message) {
+    printf("Error in %s line %d: %s\n", spec_name, line_num, message);
+    return 1;
+}
+
+/* Prints an error of the spec as a whole, returns 1 */
+static int isa_error(const char *message) {
+    printf("Error in %s: %s\n", spec_name, message);
+    return 1;
+}
+
+/* Parses a non-negative decimal number, returns 0 on success */
+static int parse_count(const char *token, int *value) {
+    char *end;
+    long number;
+
+    if (token == NULL || !isdigit((unsigned char) *token))
+        return 1;
+    number = strtol(token, &end, 10);
+    if (*end != '\0' || number > MAX_LINE)
+        return 1;
+    *value = (int) number;
+    return 0;
+}
+
+/* Parses a set of addressing methods ("013" or "-") into a bit mask, returns 0 on success */
+static int parse_methods(const char *token, int *mask) {
+    *mask = 0;
+    if (token == NULL)
+        return 1;
+    if (strcmp(token, "-") == 0)
+        return 0;
+    for (; *token; token++) {
+        if (*token < '0' || *token >= '0' + METHODS_COUNT || (*mask >> (*token - '0') & 1))
+            return 1;
+        *mask |= 1 << (*token - '0');
+    }
+    return 0;
+}
+
+/* Checks that a name is made of letters and digits and starts with a letter */
+static int is_valid_name(const char *name) {
+    if (name == NULL || strlen(name) > MAX_NAME || !isalpha((unsigned char) *name))
+        return 0;
+    for (; *name; name++)
+        if (!isalnum((unsigned char) *name))
+            return 0;
+    return 1;
+}
+
+/* Checks if a name is already an instruction or a register */
+static int is_used_name(const Isa *isa, const char *name) {
+    int i;
+
+    for (i = 0; i < isa->instructions_count; i++)
+        if (strcmp(isa->instructions[i].name, name) == 0)
+            return 1;
+    for (i = 0; i < isa->registers_count; i++)
+        if (strcmp(isa->registers[i], name) == 0)
+            return 1;
+    return 0;
+}
+
+/* Parses an "instruction" line, returns 0 on success */
+static int parse_instruction(Isa *isa) {
+    Isa_Instruction *instruction = &isa->instructions[isa->instructions_count];
+    char *name = strtok(NULL, SEPARATORS);
+
+    if (isa->instructions_count == MAX_INSTRUCTIONS)
+        return spec_error("Too many instructions");
+    if (!is_valid_name(name) || is_used_name(isa, name))
+        return spec_error("Invalid or repeated instruction name");
+    strcpy(instruction->name, name);
+    if (parse_count(strtok(NULL, SEPARATORS), &instruction->opcode) ||
+        parse_count(strtok(NULL, SEPARATORS), &instruction->funct))
+        return spec_error("Invalid opcode or funct");
+    if (parse_methods(strtok(NULL, SEPARATORS), &instruction->source_methods) ||
+        parse_methods(strtok(NULL, SEPARATORS), &instruction->destination_methods) ||
+        strtok(NULL, SEPARATORS) != NULL)
+        return spec_error("Invalid addressing methods");
+    if (instruction->source_methods != 0 && instruction->destination_methods == 0)
+        return spec_error("An instruction with a source operand needs a destination operand");
+    isa->instructions_count++;
+    return 0;
+}
+
+/* Parses a "registers" line, returns 0 on success */
+static int parse_registers(Isa *isa) {
+    char *name;
+
+    for (name = strtok(NULL, SEPARATORS); name != NULL; name = strtok(NULL, SEPARATORS)) {
+        if (isa->registers_count == MAX_REGISTERS)
+            return spec_error("Too many registers");
+        if (!is_valid_name(name) || is_used_name(isa, name))
+            return spec_error("Invalid or repeated register name");
+        strcpy(isa->registers[isa->registers_count++], name);
+    }
+    return 0;
+}
+
+/* Parses one spec line, returns 0 on success */
+static int parse_line(Isa *isa, char *line) {
+    char *comment = strchr(line, '#'), *keyword;
+    int field;
+
+    if (comment != NULL)
+        *comment = '\0';
+    keyword = strtok(line, SEPARATORS);
+    if (keyword == NULL)
+        return 0; /* Empty line */
+    if (strcmp(keyword, "instruction") == 0)
+        return parse_instruction(isa);
+    if (strcmp(keyword, "registers") == 0)
+        return parse_registers(isa);
+    if (strcmp(keyword, "word") == 0) {
+        if (parse_count(strtok(NULL, SEPARATORS), &isa->word_bits) || strtok(NULL, SEPARATORS) != NULL)
+            return spec_error("Invalid word width");
+        return 0;
+    }
+    for (field = 0; field < FIELDS_COUNT; field++) {
+        if (strcmp(keyword, FIELD_NAMES[field]) == 0) {
+            if (parse_count(strtok(NULL, SEPARATORS), &isa->fields[field].position) ||
+                parse_count(strtok(NULL, SEPARATORS), &isa->fields[field].width) ||
+                isa->fields[field].width == 0 || strtok(NULL, SEPARATORS) != NULL)
+                return spec_error("Invalid field, expected a position and a width");
+            return 0;
+        }
+    }
+    return spec_error("Unknown keyword");
+}
+
+/* Checks the spec as a whole, returns 0 if it describes an encodable machine */
+static int check_isa(const Isa *isa) {
+    int i, j;
+    unsigned long used = (1UL << ARE_BITS) - 1, field_mask;
+    const Field *fields = isa->fields;
+
+    if (isa->word_bits <= ARE_BITS || isa->word_bits > MAX_WORD_BITS)
+        return isa_error("The word width must be between 4 and 32 bits");
+    for (i = 0; i < FIELDS_COUNT; i++) {
+        if (fields[i].width == 0) {
+            printf("Error in %s: the field \"%s\" is not defined\n", spec_name, FIELD_NAMES[i]);
+            return 1;
+        }
+        if (fields[i].position + fields[i].width > isa->word_bits) {
+            printf("Error in %s: the field \"%s\" does not fit in the word\n", spec_name, FIELD_NAMES[i]);
+            return 1;
+        }
+        /* The A.R.E bits and the fields may not overlap */
+        field_mask = ((1UL << fields[i].width) - 1) << fields[i].position;
+        if (used & field_mask) {
+            printf("Error in %s: the field \"%s\" overlaps another field\n", spec_name, FIELD_NAMES[i]);
+            return 1;
+        }
+        used |= field_mask;
+    }
+    if (fields[SOURCE_METHOD].width != METHOD_BITS || fields[DESTINATION_METHOD].width != METHOD_BITS)
+        return isa_error("The method fields must be 2 bits wide");
+    if (fields[SOURCE_REGISTER].width != fields[DESTINATION_REGISTER].width)
+        return isa_error("The register fields must have the same width");
+    if (fields[OPCODE].width > MAX_LOOKUP_BITS || fields[FUNCT].width > MAX_LOOKUP_BITS)
+        return isa_error("The opcode and funct fields may be at most 8 bits wide");
+    if (isa->registers_count == 0 || isa->registers_count > 1 << fields[SOURCE_REGISTER].width)
+        return isa_error("The registers do not fit in the register fields");
+    if (isa->instructions_count == 0)
+        return isa_error("No instructions are defined");
+    for (i = 0; i < isa->instructions_count; i++) {
+        if (isa->instructions[i].opcode >= 1 << fields[OPCODE].width ||
+            isa->instructions[i].funct >= 1 << fields[FUNCT].width) {
+            printf("Error in %s: the opcode or funct of \"%s\" does not fit\n", spec_name,
+                   isa->instructions[i].name);
+            return 1;
+        }
+        for (j = 0; j < i; j++)
+            if (isa->instructions[i].opcode == isa->instructions[j].opcode &&
+                isa->instructions[i].funct == isa->instructions[j].funct) {
+                printf("Error in %s: \"%s\" and \"%s\" have the same encoding\n", spec_name,
+                       isa->instructions[j].name, isa->instructions[i].name);
+                return 1;
+            }
+    }
+    return 0;
+}
+
+/* Finds the smallest slot count at which the hashes of the names do not collide, 0 if none */
+static int find_slots_count(const char **names, int count) {
+    char used[MAX_SLOTS_FACTOR * MAX_INSTRUCTIONS];
+    int slots, i, collision;
+
+    for (slots = count; slots <= MAX_SLOTS_FACTOR * count; slots++) {
+        memset(used, 0, slots);
+        for (i = 0, collision = 0; i < count && !collision; i++)
+            collision = used[hash_string(names[i]) % slots]++;
+        if (!collision)
+            return slots;
+    }
+    return 0;
+}
+
+/* Writes the slot table of a list of names, -1 marks an empty slot */
+static void write_slots(FILE *file, const char *prefix, const char **names, int count, int slots) {
+    int i, slot;
+
+    fprintf(file, "#define %s_SLOTS_COUNT %d\n#define %s_SLOTS_INIT {", prefix, slots, prefix);
+    for (slot = 0; slot < slots; slot++) {
+        for (i = 0; i < count && hash_string(names[i]) % slots != (unsigned long) slot; i++) {
+        }
+        fprintf(file, "%s%d", slot > 0 ? ", " : "", i < count ? i : -1);
+    }
+    fprintf(file, "}\n");
+}
+
+/* Writes the name of a method set, or its bit mask if const.h has no name for it */
+static void write_methods(FILE *file, int mask) {
+    if (METHOD_SET_NAMES[mask] != NULL)
+        fprintf(file, "%s", METHOD_SET_NAMES[mask]);
+    else
+        fprintf(file, "%d", mask);
+}
+
+/* Writes a field as its position and width */
+static void write_field(FILE *file, const char *name, const Field *field) {
+    fprintf(file, "#define %s_POS %d\n#define %s_BITS %d\n", name, field->position, name, field->width);
+}
+
+/* Writes the header, returns 0 on success */
+static int write_header(const Isa *isa, const char *header_name) {
+    const Isa_Instruction *instruction;
+    const char *instruction_names[MAX_INSTRUCTIONS], *register_names[MAX_REGISTERS];
+    unsigned long word_mask, value_mask;
+    int i, operands_num, instruction_slots, register_slots;
+    FILE *file;
+
+    for (i = 0; i < isa->instructions_count; i++)
+        instruction_names[i] = isa->instructions[i].name;
+    for (i = 0; i < isa->registers_count; i++)
+        register_names[i] = isa->registers[i];
+    instruction_slots = find_slots_count(instruction_names, isa->instructions_count);
+    register_slots = find_slots_count(register_names, isa->registers_count);
+    if (instruction_slots == 0 || register_slots == 0) {
+        printf("Error in %s: no collision-free name table was found\n", spec_name);
+        return 1;
+    }
+    file = fopen(header_name, "w");
+    if (file == NULL) {
+        printf("Error: can't create %s\n", header_name);
+        return 1;
+    }
+    word_mask = isa->word_bits == MAX_WORD_BITS ? 0xffffffffUL : (1UL << isa->word_bits) - 1;
+    value_mask = word_mask >> ARE_BITS;
+
+    fprintf(file, "/* Generated by isagen from %s, do not edit */\n#ifndef ISA_H\n#define ISA_H\n\n", spec_name);
+    fprintf(file, "/* Word Layout */\n#define WORD_BITS %d\n#define WORD_DIGITS %d\n", isa->word_bits,
+            (isa->word_bits + 3) / 4);
+    fprintf(file, "#define ARE_BITS %d\n#define VALUE_POS ARE_BITS /* Operand values follow the A.R.E bits */\n",
+            ARE_BITS);
+    write_field(file, "OPCODE", &isa->fields[OPCODE]);
+    write_field(file, "FUNCS", &isa->fields[FUNCT]);
+    fprintf(file, "#define SRC_OPERAND_POS %d\n#define SRC_REGISTER_POS %d\n#define DST_OPERAND_POS %d\n"
+                  "#define DST_REGISTER_POS %d\n#define REGISTER_BITS %d\n",
+            isa->fields[SOURCE_METHOD].position, isa->fields[SOURCE_REGISTER].position,
+            isa->fields[DESTINATION_METHOD].position, isa->fields[DESTINATION_REGISTER].position,
+            isa->fields[SOURCE_REGISTER].width);
+
+    fprintf(file, "\n/* Masks and Limits */\n#define MASK_WORD 0x%lx\n#define MASK_VALUE 0x%lx\n", word_mask,
+            value_mask);
+    fprintf(file, "#define MASK_OPCODE 0x%x\n#define MASK_FUNCT 0x%x\n#define METHOD_MASK 0x%x\n"
+                  "#define REGISTER_MASK 0x%x\n",
+            (1 << isa->fields[OPCODE].width) - 1, (1 << isa->fields[FUNCT].width) - 1, (1 << METHOD_BITS) - 1,
+            (1 << isa->fields[SOURCE_REGISTER].width) - 1);
+    fprintf(file, "#define SIGN_WORD 0x%lx\n#define MAX_WORD %ld\n#define MIN_WORD (%ld - 1)\n",
+            (word_mask >> 1) + 1, (long) (word_mask >> 1), -(long) (word_mask >> 1));
+    fprintf(file, "#define MAX_VALUE %ld\n#define MIN_VALUE (%ld - 1)\n", (long) (value_mask >> 1),
+            -(long) (value_mask >> 1));
+
+    fprintf(file, "\n/* Instruction Set, X(name, opcode, funct, operands_num, source_methods, "
+                  "destination_methods) */\n#define INSTRUCTIONS_COUNT %d\n#define INSTRUCTION_LIST(X)",
+            isa->instructions_count);
+    for (i = 0; i < isa->instructions_count; i++) {
+        instruction = &isa->instructions[i];
+        operands_num = instruction->source_methods ? 2 : instruction->destination_methods ? 1 : 0;
+        fprintf(file, " \\\n    X(\"%s\", %d, %d, %d, ", instruction->name, instruction->opcode, instruction->funct,
+                operands_num);
+        write_methods(file, instruction->source_methods);
+        fprintf(file, ", ");
+        write_methods(file, instruction->destination_methods);
+        fprintf(file, ")");
+    }
+    fprintf(file, "\n\n/* Registers, X(name, number) */\n#define REGISTERS_COUNT %d\n#define REGISTER_LIST(X)",
+            isa->registers_count);
+    for (i = 0; i < isa->registers_count; i++)
+        fprintf(file, " \\\n    X(\"%s\", %d)", isa->registers[i], i);
+
+    fprintf(file, "\n\n/* Name Lookup, the index of a name is in slot hash_string(name) %% SLOTS_COUNT */\n");
+    write_slots(file, "INSTRUCTION", instruction_names, isa->instructions_count, instruction_slots);
+    write_slots(file, "REGISTER", register_names, isa->registers_count, register_slots);
+    fprintf(file, "\n#endif /* ISA_H */\n");
+    if (fclose(file) != 0) {
+        printf("Error: can't write %s\n", header_name);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    static Isa isa;
+    char line[MAX_LINE];
+    FILE *file;
+    int error = 0;
+
+    if (argc != 3) {
+        printf("Usage: isagen spec_file header_file\n");
+        return 1;
+    }
+    spec_name = argv[1];
+    file = fopen(spec_name, "r");
+    if (file == NULL) {
+        printf("Error: can't open %s\n", spec_name);
+        return 1;
+    }
+    for (line_num = 1; fgets(line, MAX_LINE, file); line_num++)
+        error |= parse_line(&isa, line);
+    fclose(file);
+    if (error || check_isa(&isa))
+        return 1;
+    return write_header(&isa, argv[2]);
+}
@@ -0,0 +1,206 @@
+/**
+ * @file linker.c
+ * @brief Static linker that combines assembled modules into one loadable image.
+ * @details Loads the .ob/.ent/.ext files of every module, places the code of all
+ *          modules first and their data after it (both starting from IC_INITIAL),
+ *          relocates the relocatable words and entries of every module to its new
+ *          base, and patches every extern use listed in the .ext files with the
+ *          address of the matching entry of another module. The result is written as
+ *          "<output>.ob" and "<output>.ent". Every module and word is handled once and
+ *          the global symbol table is hashed, so linking scales linearly.
+ *
+ *          Usage: linker [--output=NAME] module_1 ... module_N
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "object_file.h"
+#include "hash_table.h"
+#include "const.h"
+
+#define DEFAULT_OUTPUT "a"
+
+/* Placement of a module inside the image */
+typedef struct Placement {
+    int code_base; /* Image address of the first code word */
+    int data_base; /* Image address of the first data word */
+} Placement;
+
+/* Translates a module address to an image address, returns -1 if it is outside the module */
+static int relocate(const Object_Module *module, const Placement *placement, int address) {
+    int offset = address - IC_INITIAL;
+
+    if (offset < 0 || offset >= module->code_length + module->data_length)
+        return -1;
+    if (offset < module->code_length)
+        return placement->code_base + offset;
+    return placement->data_base + offset - module->code_length;
+}
+
+/* Adds the entries of every module to the image and to the global symbol table */
+static int link_entries(Object_Module *modules, const Placement *placements, int count, Object_Module *image,
+                        Hash_Table *globals) {
+    const Object_Module *module;
+    int i, j, total = 0, error = 0;
+
+    for (i = 0; i < count; i++)
+        total += modules[i].entries_count;
+    image->entries = malloc((total + 1) * sizeof(Object_Symbol));
+    if (image->entries == NULL || init_hash_table(globals, total)) {
+        printf("Error: Memory allocation failed\n");
+        return 1;
+    }
+    for (i = 0; i < count; i++) {
+        module = &modules[i];
+        for (j = 0; j < module->entries_count; j++) {
+            image->entries[image->entries_count].name = module->entries[j].name;
+            image->entries[image->entries_count].address = relocate(module, &placements[i],
+                                                                    module->entries[j].address);
+            if (image->entries[image->entries_count].address == -1) {
+                printf("Error in %s: entry \"%s\" is outside the module\n", module->name, module->entries[j].name);
+                error = 1;
+                continue;
+            }
+            switch (hash_insert(globals, module->entries[j].name, image->entries_count)) {
+                case 1:
+                    printf("Error in %s: entry \"%s\" is already defined in another module\n", module->name,
+                           module->entries[j].name);
+                    error = 1;
+                    continue;
+                case -1:
+                    printf("Error: Memory allocation failed\n");
+                    return 1;
+                default:
+                    image->entries_count++;
+            }
+        }
+    }
+    return error;
+}
+
+/* Copies the words of every module into the image, relocating and patching the code words */
+static int link_words(const Object_Module *modules, const Placement *placements, int count, Object_Module *image,
+                      const Hash_Table *globals) {
+    const Object_Module *module;
+    const Hash_Slot *slot;
+    unsigned int word;
+    int i, j, target, offset, error = 0;
+
+    for (i = 0; i < count; i++) {
+        module = &modules[i];
+        for (j = 0; j < module->code_length; j++) {
+            word = module->words[j];
+            if ((word & ARE_MASK) == ARE_RELOCATABLE) {
+                target = relocate(module, &placements[i], (int) (word >> VALUE_POS));
+                if (target == -1) {
+                    printf("Error in %s: word %07d refers outside the module\n", module->name, IC_INITIAL + j);
+                    error = 1;
+                    continue;
+                }
+                word = ((unsigned int) target << VALUE_POS) | ARE_RELOCATABLE;
+            }
+            image->words[placements[i].code_base - IC_INITIAL + j] = word;
+        }
+        memcpy(image->words + placements[i].data_base - IC_INITIAL, module->words + module->code_length,
+               module->data_length * sizeof(unsigned int));
+        /* Patching the uses of extern labels */
+        for (j = 0; j < module->externs_count; j++) {
+            offset = module->externs[j].address - IC_INITIAL;
+            if (offset < 0 || offset >= module->code_length ||
+                (module->words[offset] & ARE_MASK) != ARE_EXTERNAL) {
+                printf("Error in %s: extern use of \"%s\" at %07d is not an external word\n", module->name,
+                       module->externs[j].name, module->externs[j].address);
+                error = 1;
+                continue;
+            }
+            slot = hash_find(globals, module->externs[j].name);
+            if (slot == NULL) {
+                printf("Error in %s: unresolved extern \"%s\"\n", module->name, module->externs[j].name);
+                error = 1;
+                continue;
+            }
+            image->words[placements[i].code_base - IC_INITIAL + offset] =
+                    ((unsigned int) image->entries[slot->value].address << VALUE_POS) | ARE_RELOCATABLE;
+        }
+    }
+    return error;
+}
+
+/**
+ * @brief Links the modules given on the command line.
+ * @param argc The number of command-line arguments.
+ * @param argv An array of command-line arguments.
+ * @return 0 on success, 1 on failure.
+ */
+int main(int argc, char *argv[]) {
+    Object_Module *modules;
+    Placement *placements;
+    Object_Module image;
+    Hash_Table globals = {NULL, 0, 0};
+    char *output = DEFAULT_OUTPUT;
+    int i, count = 0, code_length = 0, data_length = 0, error = 0;
+
+    modules = malloc(argc * sizeof(Object_Module));
+    placements = malloc(argc * sizeof(Placement));
+    memset(&image, 0, sizeof(image));
+    if (modules == NULL || placements == NULL) {
+        printf("Error: Memory allocation failed\n");
+        return 1;
+    }
+    for (i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--output=", 9) == 0 && argv[i][9] != NULL_TERMINATOR) {
+            output = argv[i] + 9;
+            continue;
+        }
+        if (load_object_module(argv[i], &modules[count]) != 0) {
+            error = 1;
+            continue;
+        }
+        code_length += modules[count].code_length;
+        data_length += modules[count].data_length;
+        count++;
+    }
+    if (count == 0 && !error)
+        printf("Error: No modules entered\n");
+    if (count == 0 || error || code_length + data_length > CAPACITY) {
+        if (code_length + data_length > CAPACITY)
+            printf("Error: the linked image exceeds the memory capacity\n");
+        for (i = 0; i < count; i++)
+            free_object_module(&modules[i]);
+        free(modules);
+        free(placements);
+        return 1;
+    }
+
+    /* Placing the code of all modules first and the data after it */
+    for (i = 0; i < count; i++) {
+        placements[i].code_base = i ? placements[i - 1].code_base + modules[i - 1].code_length : IC_INITIAL;
+        placements[i].data_base = i ? placements[i - 1].data_base + modules[i - 1].data_length
+                                    : IC_INITIAL + code_length;
+    }
+    image.code_length = code_length;
+    image.data_length = data_length;
+    image.words = malloc((code_length + data_length + 1) * sizeof(unsigned int));
+    if (image.words == NULL) {
+        printf("Error: Memory allocation failed\n");
+        error = 1;
+    }
+    if (!error)
+        error = link_entries(modules, placements, count, &image, &globals);
+    if (!error)
+        error = link_words(modules, placements, count, &image, &globals);
+    if (!error)
+        error = write_object_module(output, &image);
+    if (!error)
+        printf("Linked %d modules into %s.ob (%d code words, %d data words, %d entries)\n", count, output,
+               code_length, data_length, image.entries_count);
+
+    free(image.words);
+    free(image.entries); /* The entry names belong to the modules */
+    free_hash_table(&globals);
+    for (i = 0; i < count; i++)
+        free_object_module(&modules[i]);
+    free(modules);
+    free(placements);
+    return error;
+}
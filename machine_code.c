@@ -9,14 +9,22 @@
 #include "machine_code.h"
 #include "validations.h"
 #include "symbols_list.h"
+#include "util.h"
 #include "const.h"
+#include "report.h"
 
+static int images = 1; /* Whether the words are added to the code and data lists */
+
+void set_code_images(int enabled) {
+    images = enabled;
+}
 
 void add_data_code(Data **data_head, int *DC, int number) {
-    /* Getting the 24-bit 2's complement binary representation of the number */
-    unsigned int word = number & MASK_24BIT;
+    /* Getting the word-sized 2's complement binary representation of the number */
+    unsigned int word = number & MASK_WORD;
     /* Adding the code to the data array */
-    add_data(*DC, word, data_head);
+    if (images)
+        add_data(*DC, word, data_head);
     (*DC)++; /* Incrementing data count */
 }
 
@@ -34,7 +42,8 @@ void add_instruction_code(Code **code_head, int *usage, int *IC, unsigned int wo
         return; /* Scanning line finished */
     }
     /* Adding the code to the code array */
-    add_code(*IC, word, code_head);
+    if (images)
+        add_code(*IC, word, code_head);
     (*IC)++; /* Incrementing data count */
     *usage += 1; /* Incrementing usage count */
 }
@@ -42,18 +51,22 @@ void add_instruction_code(Code **code_head, int *usage, int *IC, unsigned int wo
 void process_instruction_code(Code **code_head, int *usage, int *IC, FILE *file, int method, char *operand,
                               int operands_num, int *error) {
     unsigned int word = 0, temp = 0;
+    const char *end;
+    long value = 0;
     /* Handling the word */
     switch (method) {
         case IMMEDIATE:
             operand++; /* Skipping the 'HASH' sign */
             word |= BIT_ABSOLUTE_FLAG; /* Setting bit 2 for "Absolute" */
-            temp |= (unsigned int) (atoi(operand) & MASK_21BIT);
-            word |= temp << FUNCS_POS; /* Setting bits 3-23 */
+            parse_integer(operand, &end, MIN_VALUE, MAX_VALUE, &value); /* Validated by get_addressing_method */
+            temp |= (unsigned int) value & MASK_VALUE;
+            word |= temp << VALUE_POS; /* Setting the value bits */
             break; /* Scanning line finished */
         case DIRECT:
-            if (add_symbol(operand, *IC, OPERAND) == NULL) {
+            if (add_symbol(operand, *IC, OPERAND) == NO_SYMBOL) {
                 /* Indicates memory allocation failed */
-                fclose(file);
+                if (file != NULL)
+                    fclose(file);
                 free_labels();
                 exit(1); /* Exiting program */
             }
@@ -62,15 +75,16 @@ void process_instruction_code(Code **code_head, int *usage, int *IC, FILE *file,
             break; /* Scanning line finished */
         case RELATIVE:
             operand++; /* Skipping the 'AMPERSAND' sign */
-            if (add_symbol(operand, *IC, OPERAND) == NULL) {
+            if (add_symbol(operand, *IC, OPERAND) == NO_SYMBOL) {
                 /* Indicates memory allocation failed */
-                fclose(file);
+                if (file != NULL)
+                    fclose(file);
                 free_labels();
                 exit(1); /* Exiting program */
             }
             word |= BIT_MASK_RELATIVE;
         /* Setting bits 1 and 2 to signal to the "second pass" to update this label address */
-            word |= (*IC) << FUNCS_POS;
+            word |= (*IC) << VALUE_POS;
             break;
         default:
             return;
@@ -80,14 +94,13 @@ void process_instruction_code(Code **code_head, int *usage, int *IC, FILE *file,
 
 void handle_one_operand(Code **code_head, int *usage, int *IC, FILE *file, int method, char *operand, int instruct_id,
                         int *error) {
-    unsigned int word = 0;
-    word |= (INSTRUCTIONS[instruct_id].opcode << OPCODE_POS) | (INSTRUCTIONS[instruct_id].funct << FUNCS_POS) |
-            BIT_ABSOLUTE_FLAG;
+    unsigned int word = FIRST_WORDS[instruct_id][IMMEDIATE][method];
 
-    word |= (method << (DST_OPERAND_POS));
+    report_instruction(instruct_id);
+    report_method(DESTINATION_SLOT, method);
     /* Handling the word */
     if (method == DIRECT_REGISTER) {
-        word |= (get_regis(operand) << DST_REGISTER_POS);
+        word |= DST_REGISTER_FIELDS[get_regis(operand)];
     }
     add_instruction_code(code_head, usage, IC, word, error); /* Adding machine code (first word) */
     /* Handling the second word */
@@ -97,17 +110,17 @@ void handle_one_operand(Code **code_head, int *usage, int *IC, FILE *file, int m
 
 void handle_two_operands(Code **code_head, int *usage, int *IC, FILE *file, char *src_operand, char *dest_operand,
                          int instruct_id, int *error, int src_method, int dest_method) {
-    unsigned int word = 0;
-    word |= (INSTRUCTIONS[instruct_id].opcode << OPCODE_POS) | (INSTRUCTIONS[instruct_id].funct << FUNCS_POS) |
-            BIT_ABSOLUTE_FLAG;
-    word |= (src_method << SRC_OPERAND_POS);
-    word |= (dest_method << DST_OPERAND_POS);
+    unsigned int word = FIRST_WORDS[instruct_id][src_method][dest_method];
+
+    report_instruction(instruct_id);
+    report_method(SOURCE_SLOT, src_method);
+    report_method(DESTINATION_SLOT, dest_method);
     /* Handling the word */
     if (src_method == DIRECT_REGISTER)
-        word |= get_regis(src_operand) << SRC_REGISTER_POS;
+        word |= SRC_REGISTER_FIELDS[get_regis(src_operand)];
     /* Handling the word */
     if (dest_method == DIRECT_REGISTER)
-        word |= get_regis(dest_operand) << DST_REGISTER_POS;
+        word |= DST_REGISTER_FIELDS[get_regis(dest_operand)];
 
     add_instruction_code(code_head, usage, IC, word, error); /* Adding machine code (first word) */
     /* Handling the second word */
@@ -118,3 +131,26 @@ void handle_two_operands(Code **code_head, int *usage, int *IC, FILE *file, char
                              INSTRUCTIONS[instruct_id].operands_num - 1,
                              error); /* operands_num-1 to signal that operand is of type "destination" */
 }
+
+int instruction_of(unsigned int first_word) {
+    int i;
+
+    for (i = 0; i < INSTRUCTIONS_COUNT; i++)
+        if (INSTRUCTIONS[i].opcode == (int) ((first_word >> OPCODE_POS) & MASK_OPCODE) &&
+            INSTRUCTIONS[i].funct == (int) ((first_word >> FUNCS_POS) & MASK_FUNCT))
+            return i;
+    return -1;
+}
+
+int extra_words_of(unsigned int first_word) {
+    int id = instruction_of(first_word), count = 0;
+
+    if (id < 0)
+        return 0;
+    if (INSTRUCTIONS[id].operands_num == TWO &&
+        ((first_word >> SRC_OPERAND_POS) & BIT_MASK_DIRECT) != DIRECT_REGISTER)
+        count++;
+    if (INSTRUCTIONS[id].operands_num >= 1 && ((first_word >> DST_OPERAND_POS) & BIT_MASK_DIRECT) != DIRECT_REGISTER)
+        count++;
+    return count;
+}
@@ -4,9 +4,17 @@
 #include "data_list.h"
 #include "util.h"
 
+/**
+ * Enables building the code and data lists. Without them the counters still advance,
+ * so the addresses and the diagnostics do not change.
+ * @param enabled 1 to build the lists, 0 to only count the words.
+ */
+void set_code_images(int enabled);
+
+
 /**
  * Adds a data code to the data array.
- * Converts the given number to its 24-bit complement binary representation and adds it to the array.
+ * Converts the given number to its word-sized two's complement binary representation and adds it to the array.
  * @param data_head Pointer to the data array.
  * @param DC Pointer to the data counter.
  * @param number The number to be added as data code.
@@ -73,4 +81,20 @@ void handle_two_operands(Code **code_head, int *usage, int *IC, FILE *file, char
 void handle_one_operand(Code **code_head, int *usage, int *IC, FILE *file, int method, char *operand, int instruct_id,
                         int *error);
 
+/**
+ * Finds the instruction that a first word encodes.
+ * @param first_word The first word of an instruction.
+ * @return Index of the instruction in the opcode table, -1 if there is none.
+ */
+int instruction_of(unsigned int first_word);
+
+
+/**
+ * Gets the number of extra words that follow a first word.
+ * Register operands are encoded in the first word and need no extra word.
+ * @param first_word The first word of an instruction.
+ * @return The number of extra words, 0 if the word encodes no instruction.
+ */
+int extra_words_of(unsigned int first_word);
+
 #endif
@@ -10,25 +10,28 @@
 #include <string.h>
 #include "macro_list.h"
 #include "const.h"
+#include "stats.h"
+#include "alloc.h"
 
 
 int add_macro(char *name, Macro **head) {
     Macro *last_macro;
 
-    Macro *new_macro = malloc(sizeof(Macro));
+    Macro *new_macro = tracked_malloc(sizeof(Macro), MEM_MACROS);
     if (new_macro == NULL) {
         printf("Error: Memory allocation failed");
         return 1;
     }
 
-    new_macro->name = malloc(strlen(name) + 1);
+    new_macro->name = tracked_malloc(strlen(name) + 1, MEM_MACROS);
     if (new_macro->name == NULL) {
         printf("Error: Memory allocation failed");
-        free(new_macro);
+        tracked_free(new_macro);
         return 1;
     }
     strcpy(new_macro->name, name);
     new_macro->content = NULL;
+    new_macro->source = -1;
     new_macro->next = NULL;
 
     if (*head == NULL) {
@@ -37,6 +40,7 @@ int add_macro(char *name, Macro **head) {
         last_macro = get_last_macro(*head);
         last_macro->next = new_macro;
     }
+    stats_add(COUNT_MACROS, 1);
 
     return 0;
 }
@@ -71,7 +75,7 @@ int append_macro_content(char *new_content, Macro *head) {
     total_length = current_length + new_content_length + 1; /* +1 to accommodate '\0' */
     if (new_content == NULL) return 1;
 
-    new_memory = realloc(current->content, total_length); /* Reallocating or allocating memory for the new content */
+    new_memory = tracked_realloc(current->content, total_length, MEM_MACROS); /* Reallocating or allocating memory for the new content */
     if (new_memory == NULL) {
         printf("Error: Memory allocation failed");
         return 1; /* Indicates failure */
@@ -85,6 +89,7 @@ int append_macro_content(char *new_content, Macro *head) {
     }
 
     strcat(current->content, new_content); /* Appending the new content to the existing content */
+    stats_add(COUNT_PEAK_MACRO_BYTES, (long) new_content_length); /* Macro table is freed only after the file */
 
     return 0; /* Indicates success */
 }
@@ -109,9 +114,9 @@ void free_macros(Macro **head) {
     while (current != NULL) {
         next = current->next; /* Updating the next pointer */
 
-        free(current->name); /* Freeing the dynamically allocated name */
-        free(current->content); /* Freeing the dynamically allocated content */
-        free(current); /* Freeing the macro node itself */
+        tracked_free(current->name); /* Freeing the dynamically allocated name */
+        tracked_free(current->content); /* Freeing the dynamically allocated content */
+        tracked_free(current); /* Freeing the macro node itself */
 
         current = next; /* Moving to the next node */
     }
@@ -5,6 +5,7 @@
 typedef struct Macro {
     char *name;
     char *content;
+    int source; /* Index of the macro in the source map, -1 until it is added */
     struct Macro *next;
 } Macro;
 
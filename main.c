@@ -5,14 +5,11 @@
  *          pre-processing, first pass and second pass instructions.
  */
 #include <stdio.h>
-#include "util.h"
-#include "pre_proc.h"
-#include "first_pass.h"
-#include "const.h"
-#include "data_list.h"
-#include "code_list.h"
-#include "second_pass.h"
-#include "symbols_list.h"
+#include "assemble.h"
+#include "options.h"
+#include "stats.h"
+#include "trace.h"
+#include "report.h"
 
 /**
  * @brief The main function of the assembler program.
@@ -22,37 +19,32 @@
  */
 int main(int argc, char *argv[]) {
     int i = 1;
-    int IC = IC_INITIAL; /* Instruction Counter */
-    int DC = DC_INITIAL; /* Data Counter */
-    Data *data_head = NULL; /* Defining the head of the data linked list */
-    Code *code_head = NULL; /* Defining the head of the data linked list */
+    int files = 0; /* Number of file names entered */
+    /* Parsing the options first so they apply to all files */
+    for (; i < argc; i++) {
+        switch (parse_option(argv[i])) {
+            case 0:
+                files++;
+                break;
+            case -1:
+                return 1;
+            default:
+                break;
+        }
+    }
     /* Checking if the user entered at least one file label */
-    if (argc < TWO) {
+    if (files == 0) {
         printf("Error: No files entered\n");
         return 1;
     }
     /* Looping through all the command-line arguments */
-    for (; i < argc; i++) {
+    for (i = 1; i < argc; i++) {
+        if (parse_option(argv[i]) != 0)
+            continue; /* Skipping options */
         printf("\nProcessing file: \"%s\"\n", argv[i]);
-        if (pre_proc(argv[i]) != 0) {
-            printf("Process terminated\n");
-            continue;
-        }
-        printf("Pre-Process was successful\n");
-        if (first_pass(argv[i], &data_head, &code_head, &IC, &DC) != 0) {
-            printf("Process terminated\n");
-            continue;
-        }
-        printf("First pass pass was successful\n");
-        if (second_pass(argv[i], data_head, code_head, &IC, &DC) != 0) {
-            printf("Process terminated\n");
-            continue;
-        }
-        printf("Second pass was successful\n");
-        printf("Process ended\n");
-        free_code_list(&code_head);
-        free_data_list(&data_head);
-        free_labels();
+        assemble_file(argv[i]);
     }
-    return 0;
+    print_total_stats();
+    print_total_report();
+    return write_trace();
 }
@@ -0,0 +1,349 @@
+/**
+ * @file objdiff.c
+ * @brief Word-level comparison of two assembled images.
+ * @details Compares two .ob images (and their .ent/.ext files) by meaning instead of
+ *          by text. Every word is first normalized: a relocatable word becomes the
+ *          entry it points into plus an offset, an external word becomes the name of
+ *          its extern, and absolute and data words are kept as they are. The code and
+ *          data sections are then split into regions that start at the entries, and
+ *          regions with the same entry name are compared with each other, so words
+ *          that only moved because of a change elsewhere are not reported.
+ *
+ *          Within a pair of regions the common prefix and suffix are skipped with
+ *          block comparisons of the normalized words, and only the words between them
+ *          are reported: one by one if both sides have the same length, and as a block
+ *          of removed and added words otherwise.
+ *
+ *          Usage: objdiff old_module new_module
+ *          Returns 0 if the images are equivalent, 1 if they differ and 2 on error.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "object_file.h"
+#include "hash_table.h"
+#include "const.h"
+
+#define BLOCK_WORDS 64 /* Words compared at once with memcmp */
+#define EXIT_DIFFERENT 1
+#define EXIT_ERROR 2
+
+/* Symbol ids, the names of the entries and externs follow these */
+enum {
+    NO_SYMBOL,
+    CODE_START,
+    DATA_START,
+    UNKNOWN_EXTERN
+};
+
+/* A word reduced to its meaning, two words are equivalent if their bytes are equal */
+typedef struct Normal_Word {
+    int symbol; /* Id of the entry or extern the word refers to, NO_SYMBOL for a plain value */
+    int value; /* The plain value, or the offset from the entry */
+} Normal_Word;
+
+/* The words from an entry (or a section start) up to the next one */
+typedef struct Region {
+    const char *name;
+    int start; /* Index of the first word */
+    int end; /* Index after the last word */
+} Region;
+
+/* An image with its normalized words and regions */
+typedef struct Image {
+    Object_Module module;
+    Normal_Word *words;
+    Region *regions;
+    int regions_count;
+} Image;
+
+static Hash_Table symbol_ids = {NULL, 0, 0};
+static const char **symbol_names = NULL; /* Names by symbol id */
+static int symbols_count = 0;
+static long identical_words = 0;
+static long changed_words = 0;
+static long removed_words = 0;
+static long added_words = 0;
+
+/* Gets the id of a symbol name, adding it if it is new, returns -1 if memory allocation failed */
+static int symbol_id(const char *name) {
+    const char **new_names;
+    Hash_Slot *slot = hash_find(&symbol_ids, name);
+
+    if (slot != NULL)
+        return slot->value;
+    if ((symbols_count & (symbols_count - 1)) == 0) {
+        /* Growing the array whenever the count reaches a power of two */
+        new_names = realloc(symbol_names, (symbols_count ? symbols_count * 2 : 1) * sizeof(char *));
+        if (new_names == NULL)
+            return -1;
+        symbol_names = new_names;
+    }
+    if (hash_insert(&symbol_ids, name, symbols_count) != 0)
+        return -1;
+    symbol_names[symbols_count] = name;
+    return symbols_count++;
+}
+
+/* Orders symbols by address */
+static int compare_symbols(const void *first, const void *second) {
+    return ((const Object_Symbol *) first)->address - ((const Object_Symbol *) second)->address;
+}
+
+/* Finds the last entry at or before an address within a section, returns -1 if there is none */
+static int find_anchor(const Object_Module *module, int address, int section_start) {
+    int low = 0, high = module->entries_count - 1, middle, found = -1;
+
+    while (low <= high) {
+        middle = (low + high) / 2;
+        if (module->entries[middle].address <= address) {
+            found = middle;
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return found >= 0 && module->entries[found].address >= section_start ? found : -1;
+}
+
+/* Finds the name of the extern used at an address */
+static const char *find_extern(const Object_Module *module, int address) {
+    Object_Symbol key, *symbol;
+
+    key.name = NULL;
+    key.address = address;
+    symbol = module->externs_count ? bsearch(&key, module->externs, module->externs_count, sizeof(Object_Symbol),
+                                             compare_symbols) : NULL;
+    return symbol ? symbol->name : NULL;
+}
+
+/* Normalizes the words of an image, returns 1 if memory allocation failed */
+static int normalize(Image *image) {
+    const Object_Module *module = &image->module;
+    const char *name;
+    int i, target, anchor, section_start, data_start = IC_INITIAL + module->code_length;
+    unsigned int word;
+
+    image->words = malloc((module->code_length + module->data_length + 1) * sizeof(Normal_Word));
+    if (image->words == NULL)
+        return 1;
+    memset(image->words, 0, (module->code_length + module->data_length + 1) * sizeof(Normal_Word));
+    for (i = 0; i < module->code_length + module->data_length; i++) {
+        word = module->words[i];
+        image->words[i].value = (int) word;
+        if (i >= module->code_length)
+            continue; /* Data words are plain values */
+        if ((word & ARE_MASK) == ARE_EXTERNAL) {
+            name = find_extern(module, IC_INITIAL + i);
+            image->words[i].symbol = name ? symbol_id(name) : UNKNOWN_EXTERN;
+            image->words[i].value = 0;
+        } else if ((word & ARE_MASK) == ARE_RELOCATABLE) {
+            target = (int) (word >> VALUE_POS);
+            section_start = target < data_start ? IC_INITIAL : data_start;
+            anchor = find_anchor(module, target, section_start);
+            image->words[i].symbol = anchor >= 0 ? symbol_id(module->entries[anchor].name)
+                                                 : section_start == IC_INITIAL ? CODE_START : DATA_START;
+            image->words[i].value = target - (anchor >= 0 ? module->entries[anchor].address : section_start);
+        }
+        if (image->words[i].symbol < 0)
+            return 1;
+    }
+    return 0;
+}
+
+/* Splits a section of an image into regions, returns the number of regions added */
+static int split_section(Image *image, const char *start_name, int start, int end) {
+    const Object_Module *module = &image->module;
+    Region *region = &image->regions[image->regions_count];
+    int i, count = 1;
+
+    region->name = start_name;
+    region->start = start;
+    for (i = 0; i < module->entries_count; i++) {
+        if (module->entries[i].address - IC_INITIAL < start || module->entries[i].address - IC_INITIAL >= end)
+            continue;
+        region[count - 1].end = module->entries[i].address - IC_INITIAL;
+        region[count].name = module->entries[i].name;
+        region[count].start = module->entries[i].address - IC_INITIAL;
+        count++;
+    }
+    region[count - 1].end = end;
+    image->regions_count += count;
+    return count;
+}
+
+/* Loads, normalizes and splits an image, returns 1 on failure */
+static int load_image(const char *name, Image *image) {
+    memset(image, 0, sizeof(Image));
+    if (load_object_module(name, &image->module) != 0)
+        return 1;
+    qsort(image->module.entries, image->module.entries_count, sizeof(Object_Symbol), compare_symbols);
+    qsort(image->module.externs, image->module.externs_count, sizeof(Object_Symbol), compare_symbols);
+    image->regions = malloc((image->module.entries_count + 2) * sizeof(Region));
+    if (image->regions == NULL || normalize(image)) {
+        printf("Error: Memory allocation failed\n");
+        return 1;
+    }
+    split_section(image, symbol_names[CODE_START], 0, image->module.code_length);
+    split_section(image, symbol_names[DATA_START], image->module.code_length,
+                  image->module.code_length + image->module.data_length);
+    return 0;
+}
+
+/* Frees the memory of an image */
+static void free_image(Image *image) {
+    free_object_module(&image->module);
+    free(image->words);
+    free(image->regions);
+}
+
+/* Counts the equivalent words at the start of two runs, skipping equal blocks with memcmp */
+static int common_prefix(const Normal_Word *first, const Normal_Word *second, int length) {
+    int same = 0;
+
+    while (length - same >= BLOCK_WORDS &&
+           memcmp(first + same, second + same, BLOCK_WORDS * sizeof(Normal_Word)) == 0)
+        same += BLOCK_WORDS;
+    while (same < length && first[same].symbol == second[same].symbol && first[same].value == second[same].value)
+        same++;
+    return same;
+}
+
+/* Counts the equivalent words at the end of two runs, skipping equal blocks with memcmp */
+static int common_suffix(const Normal_Word *first_end, const Normal_Word *second_end, int length) {
+    int same = 0;
+
+    while (length - same >= BLOCK_WORDS && memcmp(first_end - same - BLOCK_WORDS, second_end - same - BLOCK_WORDS,
+                                                  BLOCK_WORDS * sizeof(Normal_Word)) == 0)
+        same += BLOCK_WORDS;
+    while (same < length && first_end[-same - 1].symbol == second_end[-same - 1].symbol &&
+           first_end[-same - 1].value == second_end[-same - 1].value)
+        same++;
+    return same;
+}
+
+/* Prints one word with its meaning */
+static void print_word(char sign, const Image *image, int index) {
+    const Normal_Word *word = &image->words[index];
+
+    printf("  %c %07d %0*x", sign, IC_INITIAL + index, WORD_DIGITS, image->module.words[index]);
+    if (word->symbol == NO_SYMBOL)
+        printf("\n");
+    else if (word->value == 0)
+        printf("  (%s)\n", symbol_names[word->symbol]);
+    else
+        printf("  (%s%+d)\n", symbol_names[word->symbol], word->value);
+}
+
+/* Compares two regions with the same name and prints the words that changed */
+static void diff_region(const Image *old, const Region *old_region, const Image *new, const Region *new_region) {
+    int old_length = old_region->end - old_region->start, new_length = new_region->end - new_region->start;
+    int shorter = old_length < new_length ? old_length : new_length, prefix, suffix, i;
+    const Normal_Word *old_words = old->words + old_region->start, *new_words = new->words + new_region->start;
+
+    prefix = common_prefix(old_words, new_words, shorter);
+    suffix = common_suffix(old_words + old_length, new_words + new_length, shorter - prefix);
+    identical_words += prefix + suffix;
+    if (prefix == old_length && prefix == new_length)
+        return;
+    printf("@@ %s%+d: old %07d, new %07d @@\n", old_region->name, prefix, IC_INITIAL + old_region->start + prefix,
+           IC_INITIAL + new_region->start + prefix);
+    if (old_length == new_length) {
+        /* Nothing moved, only the words that differ are printed */
+        for (i = prefix; i < old_length - suffix; i++) {
+            if (old_words[i].symbol == new_words[i].symbol && old_words[i].value == new_words[i].value) {
+                identical_words++;
+                continue;
+            }
+            print_word('-', old, old_region->start + i);
+            print_word('+', new, new_region->start + i);
+            changed_words++;
+        }
+        return;
+    }
+    for (i = prefix; i < old_length - suffix; i++)
+        print_word('-', old, old_region->start + i);
+    for (i = prefix; i < new_length - suffix; i++)
+        print_word('+', new, new_region->start + i);
+    removed_words += old_length - suffix - prefix;
+    added_words += new_length - suffix - prefix;
+}
+
+/* Matches the regions of two images by name and compares them, returns 1 if memory allocation failed */
+static int diff_images(const Image *old, const Image *new) {
+    Hash_Table new_regions;
+    Hash_Slot *slot;
+    char *matched;
+    int i;
+
+    matched = calloc(new->regions_count + 1, 1);
+    if (matched == NULL || init_hash_table(&new_regions, new->regions_count)) {
+        free(matched);
+        return 1;
+    }
+    for (i = 0; i < new->regions_count; i++)
+        if (hash_insert(&new_regions, new->regions[i].name, i) == -1) {
+            free(matched);
+            free_hash_table(&new_regions);
+            return 1;
+        }
+    for (i = 0; i < old->regions_count; i++) {
+        slot = hash_find(&new_regions, old->regions[i].name);
+        if (slot == NULL || matched[slot->value]) {
+            printf("Only in old: %s (%d words at %07d)\n", old->regions[i].name,
+                   old->regions[i].end - old->regions[i].start, IC_INITIAL + old->regions[i].start);
+            removed_words += old->regions[i].end - old->regions[i].start;
+            continue;
+        }
+        matched[slot->value] = 1;
+        diff_region(old, &old->regions[i], new, &new->regions[slot->value]);
+    }
+    for (i = 0; i < new->regions_count; i++) {
+        if (matched[i])
+            continue;
+        printf("Only in new: %s (%d words at %07d)\n", new->regions[i].name,
+               new->regions[i].end - new->regions[i].start, IC_INITIAL + new->regions[i].start);
+        added_words += new->regions[i].end - new->regions[i].start;
+    }
+    free(matched);
+    free_hash_table(&new_regions);
+    return 0;
+}
+
+/**
+ * @brief Compares the two images given on the command line.
+ * @param argc The number of command-line arguments.
+ * @param argv An array of command-line arguments.
+ * @return 0 if the images are equivalent, 1 if they differ, 2 on error.
+ */
+int main(int argc, char *argv[]) {
+    Image old, new;
+    int status = EXIT_ERROR;
+
+    memset(&old, 0, sizeof(Image));
+    memset(&new, 0, sizeof(Image));
+    if (argc != 3) {
+        printf("Usage: objdiff old_module new_module\n");
+        return EXIT_ERROR;
+    }
+    if (init_hash_table(&symbol_ids, 0) || symbol_id("<none>") != NO_SYMBOL || symbol_id("<code>") != CODE_START ||
+        symbol_id("<data>") != DATA_START || symbol_id("<unknown extern>") != UNKNOWN_EXTERN) {
+        printf("Error: Memory allocation failed\n");
+        return EXIT_ERROR;
+    }
+    if (load_image(argv[1], &old) == 0 && load_image(argv[2], &new) == 0) {
+        if (diff_images(&old, &new) != 0) {
+            printf("Error: Memory allocation failed\n");
+        } else {
+            printf("%ld identical, %ld changed, %ld removed, %ld added words (code %d -> %d, data %d -> %d)\n",
+                   identical_words, changed_words, removed_words, added_words, old.module.code_length,
+                   new.module.code_length, old.module.data_length, new.module.data_length);
+            status = changed_words + removed_words + added_words != 0 ? EXIT_DIFFERENT : 0;
+        }
+    }
+    free_image(&old);
+    free_image(&new);
+    free_hash_table(&symbol_ids);
+    free(symbol_names);
+    return status;
+}
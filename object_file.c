@@ -0,0 +1,558 @@
+/**
+ * @file object_file.c
+ * @brief Reading and writing of the assembler output formats (.ob, .ent and .ext).
+ *
+ * The formats are the ones written by create_ob_file, create_ent_file and
+ * create_ext_file: an .ob header with the code and data lengths followed by
+ * "address word" lines, and "label address" lines in the .ent and .ext files.
+ *
+ * Files are read through mmap. The "%07d %0*x" lines of create_ob_file have a fixed
+ * width, so a line is recognized by its separators alone and its address is parsed
+ * as one 64-bit chunk (SWAR): all digits are validated with a few masks and combined
+ * with three multiplications. Lines in any other layout fall back to a byte-by-byte
+ * parser, so hand-written files are still accepted. Symbols are returned as one
+ * array per file whose names are packed into a single buffer.
+ *
+ * The binary .sym file is used in place: its sections are checked once when it is
+ * mapped, and a lookup hashes the name and probes the bucket array of the file. The
+ * binary .dbg file is used in the same way, a lookup is a binary search of its records.
+ */
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "object_file.h"
+#include "hash_table.h"
+#include "const.h"
+
+#define ADDRESS_DIGITS 7
+#define WORD_LINE_LENGTH (ADDRESS_DIGITS + WORD_DIGITS + 2) /* "%07d %0*x\n" */
+#define HEX_BASE 16
+#define INVALID_DIGIT 16 /* Flag bit of a character that is not a hex digit */
+
+static unsigned char hex_values[UCHAR_MAX + 1];
+static int hex_ready = 0;
+
+/* Returns a newly allocated "<name><extension>", or NULL if allocation failed */
+static char *file_name_of(const char *name, const char *extension) {
+    char *file_name = malloc(strlen(name) + strlen(extension) + 1);
+    if (file_name == NULL) {
+        printf("Error: Memory allocation failed\n");
+        return NULL;
+    }
+    strcpy(file_name, name);
+    strcat(file_name, extension);
+    return file_name;
+}
+
+/* Maps a file for reading, returns 0 on success and 1 if it can't be opened or mapped */
+static int map_file(const char *file_name, const char **data, size_t *size) {
+    struct stat status;
+    void *mapped;
+    int fd = open(file_name, O_RDONLY);
+
+    if (fd < 0)
+        return 1;
+    if (fstat(fd, &status) != 0) {
+        close(fd);
+        return 1;
+    }
+    *size = (size_t) status.st_size;
+    *data = "";
+    if (*size > 0) {
+        mapped = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            close(fd);
+            return 1;
+        }
+        *data = mapped;
+    }
+    close(fd);
+    return 0;
+}
+
+/* Unmaps a file mapped by map_file */
+static void unmap_file(const char *data, size_t size) {
+    if (size > 0)
+        munmap((void *) data, size);
+}
+
+/* Checks if a character is a space, a tab or a line break */
+static int is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/* Skips spaces and line breaks, returns the new position */
+static size_t skip_spaces(const char *data, size_t size, size_t position) {
+    while (position < size && is_space(data[position]))
+        position++;
+    return position;
+}
+
+/* Builds the table of hex digit values, other characters get INVALID_DIGIT */
+static void init_hex_values() {
+    int i;
+
+    for (i = 0; i <= UCHAR_MAX; i++)
+        hex_values[i] = INVALID_DIGIT;
+    for (i = 0; i < DECIMAL_BASE; i++)
+        hex_values['0' + i] = (unsigned char) i;
+    for (i = 0; i < HEX_BASE - DECIMAL_BASE; i++) {
+        hex_values['a' + i] = (unsigned char) (DECIMAL_BASE + i);
+        hex_values['A' + i] = (unsigned char) (DECIMAL_BASE + i);
+    }
+    hex_ready = 1;
+}
+
+/* Parses exactly 7 decimal digits, returns 0 on success and 1 if a character is not a digit */
+static int parse_address_field(const char *p, int *value) {
+#if ULONG_MAX > 0xffffffffUL
+    /* The 7 digits are loaded after a leading '0' as one little-endian 8-digit chunk */
+    unsigned long chunk = '0';
+    int i;
+
+    for (i = 0; i < ADDRESS_DIGITS; i++)
+        chunk |= (unsigned long) (unsigned char) p[i] << (8 * (i + 1));
+    /* Every byte must have the high nibble 3, and still have it after adding 6 */
+    if (((chunk & 0xf0f0f0f0f0f0f0f0UL) | (((chunk + 0x0606060606060606UL) & 0xf0f0f0f0f0f0f0f0UL) >> 4)) !=
+        0x3333333333333333UL)
+        return 1;
+    chunk -= 0x3030303030303030UL;
+    chunk = chunk * 10 + (chunk >> 8); /* Pairs of digits */
+    chunk = ((chunk & 0x000000ff000000ffUL) * (100 + (1000000UL << 32)) +
+             ((chunk >> 16) & 0x000000ff000000ffUL) * (1 + (10000UL << 32))) >> 32;
+    *value = (int) chunk;
+    return 0;
+#else
+    int i;
+
+    *value = 0;
+    for (i = 0; i < ADDRESS_DIGITS; i++) {
+        if (p[i] < '0' || p[i] > '9')
+            return 1;
+        *value = *value * DECIMAL_BASE + p[i] - '0';
+    }
+    return 0;
+#endif
+}
+
+/* Parses exactly WORD_DIGITS hex digits, returns 0 on success and 1 if a character is not a hex digit */
+static int parse_word_field(const char *p, unsigned int *word) {
+    const unsigned char *digits = (const unsigned char *) p;
+#if WORD_DIGITS == 6
+    unsigned int d0, d1, d2, d3, d4, d5;
+
+    d0 = hex_values[digits[0]];
+    d1 = hex_values[digits[1]];
+    d2 = hex_values[digits[2]];
+    d3 = hex_values[digits[3]];
+    d4 = hex_values[digits[4]];
+    d5 = hex_values[digits[5]];
+    if ((d0 | d1 | d2 | d3 | d4 | d5) & INVALID_DIGIT)
+        return 1;
+    *word = d0 << 20 | d1 << 16 | d2 << 12 | d3 << 8 | d4 << 4 | d5;
+    return 0;
+#else
+    unsigned int invalid = 0;
+    int i;
+
+    *word = 0;
+    for (i = 0; i < WORD_DIGITS; i++) {
+        invalid |= hex_values[digits[i]];
+        *word = *word << 4 | hex_values[digits[i]];
+    }
+    return (invalid & INVALID_DIGIT) != 0;
+#endif
+}
+
+/* Parses a number in any layout after optional spaces, returns 0 on success */
+static int parse_number(const char *data, size_t size, size_t *position, int base, unsigned long *value) {
+    size_t start;
+
+    *position = skip_spaces(data, size, *position);
+    start = *position;
+    *value = 0;
+    while (*position < size && hex_values[(unsigned char) data[*position]] < base && *value <= MASK_WORD) {
+        *value = *value * base + hex_values[(unsigned char) data[*position]];
+        (*position)++;
+    }
+    return *position == start || *value > MASK_WORD || (*position < size && !is_space(data[*position]));
+}
+
+/* Checks that only spaces are left on the line, returns 0 if so */
+static int expect_line_end(const char *data, size_t size, size_t *position) {
+    while (*position < size && data[*position] != '\n' && is_space(data[*position]))
+        (*position)++;
+    return *position < size && data[*position] != '\n';
+}
+
+int open_object_reader(const char *name, Object_Reader *reader) {
+    unsigned long code_length, data_length;
+
+    if (!hex_ready)
+        init_hex_values();
+    reader->size = 0;
+    reader->position = 0;
+    reader->file_name = file_name_of(name, ".ob");
+    if (reader->file_name == NULL)
+        return 1;
+    if (map_file(reader->file_name, &reader->data, &reader->size)) {
+        printf("Error: can't open %s\n", reader->file_name);
+        free(reader->file_name);
+        reader->file_name = NULL;
+        return 1;
+    }
+    if (parse_number(reader->data, reader->size, &reader->position, DECIMAL_BASE, &code_length) ||
+        parse_number(reader->data, reader->size, &reader->position, DECIMAL_BASE, &data_length) ||
+        code_length + data_length > CAPACITY) {
+        printf("Error in %s: invalid header\n", reader->file_name);
+        close_object_reader(reader);
+        return 1;
+    }
+    reader->code_length = (int) code_length;
+    reader->data_length = (int) data_length;
+    reader->position = skip_spaces(reader->data, reader->size, reader->position);
+    reader->address = IC_INITIAL;
+    return 0;
+}
+
+int read_object_word(Object_Reader *reader, unsigned int *word) {
+    const char *line = reader->data + reader->position;
+    unsigned long address, value;
+    int fixed_address;
+
+    if (reader->address == IC_INITIAL + reader->code_length + reader->data_length)
+        return 0; /* Indicates the end of the image */
+    if (reader->size - reader->position >= WORD_LINE_LENGTH && line[ADDRESS_DIGITS] == ' ' &&
+        line[WORD_LINE_LENGTH - 1] == '\n' && parse_address_field(line, &fixed_address) == 0 &&
+        parse_word_field(line + ADDRESS_DIGITS + 1, word) == 0) {
+        address = (unsigned long) fixed_address;
+        reader->position += WORD_LINE_LENGTH;
+    } else if (parse_number(reader->data, reader->size, &reader->position, DECIMAL_BASE, &address) ||
+               parse_number(reader->data, reader->size, &reader->position, HEX_BASE, &value) ||
+               expect_line_end(reader->data, reader->size, &reader->position)) {
+        address = 0; /* Indicates a line that is not an "address word" pair */
+    } else {
+        *word = (unsigned int) value;
+        reader->position = skip_spaces(reader->data, reader->size, reader->position);
+    }
+    if (address != (unsigned long) reader->address) {
+        printf("Error in %s: expected the word of address %07d\n", reader->file_name, reader->address);
+        return -1;
+    }
+    reader->address++;
+    return 1;
+}
+
+void close_object_reader(Object_Reader *reader) {
+    unmap_file(reader->data, reader->size);
+    free(reader->file_name);
+    reader->data = NULL;
+    reader->size = 0;
+    reader->file_name = NULL;
+}
+
+/* Loads the words of an .ob file into one array */
+static int load_words(const char *name, Object_Module *module) {
+    Object_Reader reader;
+    int i, error = 0;
+
+    if (open_object_reader(name, &reader))
+        return 1;
+    module->code_length = reader.code_length;
+    module->data_length = reader.data_length;
+    module->words = malloc((module->code_length + module->data_length + 1) * sizeof(unsigned int));
+    if (module->words == NULL) {
+        printf("Error: Memory allocation failed\n");
+        error = 1;
+    }
+    for (i = 0; !error && i < module->code_length + module->data_length; i++)
+        error = read_object_word(&reader, &module->words[i]) != 1;
+    if (!error && skip_spaces(reader.data, reader.size, reader.position) != reader.size) {
+        printf("Error in %s: more words than the header declares\n", reader.file_name);
+        error = 1;
+    }
+    close_object_reader(&reader);
+    return error;
+}
+
+/* Loads the "label address" lines of an .ent or .ext file, a missing file has no lines */
+static int load_symbols(const char *name, const char *extension, Object_Symbol **symbols, int *count,
+                        char **names) {
+    const char *data;
+    char *file_name = file_name_of(name, extension), *next_name;
+    size_t size, position = 0, start, length;
+    unsigned long address;
+    int lines = 1, error = 0;
+
+    *symbols = NULL;
+    *names = NULL;
+    *count = 0;
+    if (file_name == NULL)
+        return 1;
+    if (map_file(file_name, &data, &size)) {
+        free(file_name);
+        return 0; /* Indicates no symbols */
+    }
+    /* Every symbol takes a line, and every name is followed by at least one byte */
+    for (start = 0; start < size; start++)
+        lines += data[start] == '\n';
+    *symbols = malloc(lines * sizeof(Object_Symbol));
+    *names = malloc(size + 1);
+    if (*symbols == NULL || *names == NULL) {
+        printf("Error: Memory allocation failed\n");
+        error = 1;
+    }
+    next_name = *names;
+    while (!error && (position = skip_spaces(data, size, position)) < size) {
+        for (start = position; position < size && !is_space(data[position]); position++);
+        length = position - start;
+        if (length > MAX_DECLARATION_LENGTH || parse_number(data, size, &position, DECIMAL_BASE, &address) ||
+            expect_line_end(data, size, &position)) {
+            printf("Error in %s symbol %d: expected a label and an address\n", file_name, *count + 1);
+            error = 1;
+            break;
+        }
+        memcpy(next_name, data + start, length);
+        next_name[length] = NULL_TERMINATOR;
+        (*symbols)[*count].name = next_name;
+        (*symbols)[*count].address = (int) address;
+        next_name += length + 1;
+        (*count)++;
+    }
+    unmap_file(data, size);
+    free(file_name);
+    return error;
+}
+
+int load_object_symbols(const char *name, Object_Module *module) {
+    if (!hex_ready)
+        init_hex_values();
+    return load_symbols(name, ".ent", &module->entries, &module->entries_count, &module->entry_names) ||
+           load_symbols(name, ".ext", &module->externs, &module->externs_count, &module->extern_names);
+}
+
+int load_object_module(const char *name, Object_Module *module) {
+    memset(module, 0, sizeof(Object_Module));
+    module->name = file_name_of(name, "");
+    if (module->name == NULL || load_words(name, module) || load_object_symbols(name, module)) {
+        free_object_module(module);
+        return 1;
+    }
+    return 0;
+}
+
+/* Writes "label address" lines, the file is created only if there are symbols */
+static int write_symbols(const char *name, const char *extension, const Object_Symbol *symbols, int count) {
+    FILE *file;
+    int i;
+    char *file_name;
+
+    if (count == 0)
+        return 0;
+    file_name = file_name_of(name, extension);
+    if (file_name == NULL)
+        return 1;
+    file = fopen(file_name, "w");
+    if (file == NULL) {
+        printf("Error: can't create %s\n", file_name);
+        free(file_name);
+        return 1;
+    }
+    for (i = 0; i < count; i++)
+        fprintf(file, "%s %07d\n", symbols[i].name, symbols[i].address);
+    fclose(file);
+    free(file_name);
+    return 0;
+}
+
+int write_object_module(const char *name, const Object_Module *module) {
+    FILE *file;
+    int i;
+    char *file_name = file_name_of(name, ".ob");
+
+    if (file_name == NULL)
+        return 1;
+    file = fopen(file_name, "w");
+    if (file == NULL) {
+        printf("Error: can't create %s\n", file_name);
+        free(file_name);
+        return 1;
+    }
+    fprintf(file, "%7d %d\n", module->code_length, module->data_length);
+    for (i = 0; i < module->code_length + module->data_length; i++)
+        fprintf(file, "%07d %0*x\n", IC_INITIAL + i, WORD_DIGITS, module->words[i]);
+    fclose(file);
+    free(file_name);
+    return write_symbols(name, ".ent", module->entries, module->entries_count) ||
+           write_symbols(name, ".ext", module->externs, module->externs_count);
+}
+
+void free_object_module(Object_Module *module) {
+    free(module->name);
+    free(module->words);
+    free(module->entries);
+    free(module->externs);
+    free(module->entry_names);
+    free(module->extern_names);
+    memset(module, 0, sizeof(Object_Module));
+}
+
+/* Reads a 32-bit little-endian field */
+static unsigned long read_field(const unsigned char *p) {
+    return (unsigned long) p[0] | (unsigned long) p[1] << 8 | (unsigned long) p[2] << 16 |
+           (unsigned long) p[3] << 24;
+}
+
+int open_symbol_file(const char *name, Symbol_File *file) {
+    char *file_name = file_name_of(name, ".sym");
+    const char *data;
+    size_t size, needed;
+
+    memset(file, 0, sizeof(Symbol_File));
+    if (file_name == NULL)
+        return 1;
+    if (map_file(file_name, &data, &size) != 0) {
+        printf("Error: can't open %s\n", file_name);
+        free(file_name);
+        return 1;
+    }
+    file->data = (const unsigned char *) data;
+    file->size = size;
+    if (size >= SYMBOL_FILE_HEADER && memcmp(data, SYMBOL_FILE_MAGIC, SYMBOL_FILE_FIELD) == 0) {
+        file->symbols_count = read_field(file->data + SYMBOL_FILE_FIELD);
+        file->buckets_count = read_field(file->data + 2 * SYMBOL_FILE_FIELD);
+        file->references_count = read_field(file->data + 3 * SYMBOL_FILE_FIELD);
+        file->names_size = read_field(file->data + 4 * SYMBOL_FILE_FIELD);
+    }
+    /* The sections must fit in the file and the last name must be terminated */
+    needed = SYMBOL_FILE_HEADER + file->buckets_count * SYMBOL_FILE_FIELD +
+             file->symbols_count * SYMBOL_FILE_RECORD + file->references_count * SYMBOL_FILE_REFERENCE +
+             file->names_size;
+    if (size < SYMBOL_FILE_HEADER || file->buckets_count == 0 || file->buckets_count > size ||
+        file->symbols_count > size || file->references_count > size || file->names_size > size ||
+        (file->buckets_count & (file->buckets_count - 1)) != 0 || file->buckets_count < file->symbols_count ||
+        needed != size || file->names_size == 0 || data[size - 1] != NULL_TERMINATOR) {
+        printf("Error: %s is not a valid symbol file\n", file_name);
+        free(file_name);
+        close_symbol_file(file);
+        return 1;
+    }
+    file->buckets = file->data + SYMBOL_FILE_HEADER;
+    file->symbols = file->buckets + file->buckets_count * SYMBOL_FILE_FIELD;
+    file->references = file->symbols + file->symbols_count * SYMBOL_FILE_RECORD;
+    file->names = (const char *) file->references + file->references_count * SYMBOL_FILE_REFERENCE;
+    free(file_name);
+    return 0;
+}
+
+/* Reads a symbol record, returns 0 if it is out of range */
+static int read_symbol_record(const Symbol_File *file, unsigned long index, Symbol_File_Entry *entry) {
+    const unsigned char *record = file->symbols + index * SYMBOL_FILE_RECORD;
+    unsigned long offset;
+
+    if (index >= file->symbols_count || (offset = read_field(record)) >= file->names_size)
+        return 0;
+    entry->name = file->names + offset;
+    entry->address = (int) read_field(record + SYMBOL_FILE_FIELD);
+    entry->type = (int) read_field(record + 2 * SYMBOL_FILE_FIELD);
+    return 1;
+}
+
+int find_symbol_file_entry(const Symbol_File *file, const char *label, Symbol_File_Entry *entry) {
+    unsigned long mask = file->buckets_count - 1, i = hash_string(label) & mask, probes, bucket;
+
+    for (probes = 0; probes < file->buckets_count; probes++, i = (i + 1) & mask) {
+        bucket = read_field(file->buckets + i * SYMBOL_FILE_FIELD);
+        if (bucket == 0 || !read_symbol_record(file, bucket - 1, entry))
+            return 0; /* Indicates an empty bucket ends the probe sequence */
+        if (strcmp(entry->name, label) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+int get_symbol_file_reference(const Symbol_File *file, unsigned long index, Symbol_File_Entry *entry) {
+    const unsigned char *record = file->references + index * SYMBOL_FILE_REFERENCE;
+
+    if (index >= file->references_count || !read_symbol_record(file, read_field(record), entry))
+        return 0;
+    entry->address = (int) read_field(record + SYMBOL_FILE_FIELD);
+    return 1;
+}
+
+void close_symbol_file(Symbol_File *file) {
+    if (file->data != NULL)
+        unmap_file((const char *) file->data, file->size);
+    memset(file, 0, sizeof(Symbol_File));
+}
+
+int open_debug_file(const char *name, Debug_File *file) {
+    char *file_name = file_name_of(name, ".dbg");
+    const char *data;
+    size_t size;
+
+    memset(file, 0, sizeof(Debug_File));
+    if (file_name == NULL)
+        return 1;
+    if (map_file(file_name, &data, &size) != 0) {
+        free(file_name);
+        return -1; /* Indicates the module has no debug file */
+    }
+    file->data = (const unsigned char *) data;
+    file->size = size;
+    if (size >= DEBUG_FILE_HEADER && memcmp(data, DEBUG_FILE_MAGIC, SYMBOL_FILE_FIELD) == 0) {
+        file->code_end = (int) read_field(file->data + SYMBOL_FILE_FIELD);
+        file->lines_count = read_field(file->data + 2 * SYMBOL_FILE_FIELD);
+        file->names_size = read_field(file->data + 3 * SYMBOL_FILE_FIELD);
+    }
+    /* The sections must fit in the file and the last name must be terminated */
+    if (size < DEBUG_FILE_HEADER || file->lines_count > size || file->names_size == 0 || file->names_size > size ||
+        DEBUG_FILE_HEADER + file->lines_count * DEBUG_FILE_RECORD + file->names_size != size ||
+        data[size - 1] != NULL_TERMINATOR) {
+        printf("Error: %s is not a valid debug file\n", file_name);
+        free(file_name);
+        close_debug_file(file);
+        return 1;
+    }
+    file->lines = file->data + DEBUG_FILE_HEADER;
+    file->names = (const char *) file->lines + file->lines_count * DEBUG_FILE_RECORD;
+    free(file_name);
+    return 0;
+}
+
+int find_debug_line(const Debug_File *file, int address, Debug_Line *line) {
+    unsigned long low = 0, high = file->lines_count, middle, macro;
+    const unsigned char *record;
+
+    if (address >= file->code_end)
+        return 0;
+    /* Finding the last instruction that starts at or before the address */
+    while (low < high) {
+        middle = low + (high - low) / 2;
+        if ((int) read_field(file->lines + middle * DEBUG_FILE_RECORD) <= address)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    if (low == 0)
+        return 0;
+    record = file->lines + (low - 1) * DEBUG_FILE_RECORD;
+    line->address = (int) read_field(record);
+    line->line = (int) read_field(record + SYMBOL_FILE_FIELD);
+    line->macro_line = (int) read_field(record + 2 * SYMBOL_FILE_FIELD);
+    macro = read_field(record + 3 * SYMBOL_FILE_FIELD);
+    line->macro = macro > 0 && macro <= file->names_size ? file->names + macro - 1 : NULL;
+    return 1;
+}
+
+void close_debug_file(Debug_File *file) {
+    if (file->data != NULL)
+        unmap_file((const char *) file->data, file->size);
+    memset(file, 0, sizeof(Debug_File));
+}
@@ -0,0 +1,236 @@
+#ifndef OBJECT_FILE_H
+#define OBJECT_FILE_H
+
+#include <stddef.h>
+
+/* A label listed in an .ent file or a use listed in an .ext file */
+typedef struct Object_Symbol {
+    char *name;
+    int address;
+} Object_Symbol;
+
+/* The contents of an .ob file and its optional .ent/.ext files */
+typedef struct Object_Module {
+    char *name;
+    int code_length; /* Number of code words (the first address is IC_INITIAL) */
+    int data_length; /* Number of data words, placed right after the code */
+    unsigned int *words; /* Code words followed by data words */
+    Object_Symbol *entries;
+    int entries_count;
+    Object_Symbol *externs; /* One record per use of an extern label */
+    int externs_count;
+    char *entry_names; /* Packed names of the entries */
+    char *extern_names; /* Packed names of the extern uses */
+} Object_Module;
+
+/* A.R.E bits of a code word */
+#define ARE_MASK 7
+#define ARE_ABSOLUTE 4
+#define ARE_RELOCATABLE 2
+#define ARE_EXTERNAL 1
+
+/* A reader that streams the words of a memory-mapped .ob file */
+typedef struct Object_Reader {
+    const char *data;
+    size_t size;
+    size_t position; /* Offset of the next line */
+    char *file_name;
+    int code_length;
+    int data_length;
+    int address; /* Address of the next word */
+} Object_Reader;
+
+/*
+ * Binary symbol file "<name>.sym". All the fields are 32-bit little-endian numbers:
+ * a header with the magic "SYM1", the symbol, bucket, reference and name-pool sizes;
+ * the buckets, each 0 or 1 + the index of a symbol, placed by the FNV-1a hash of its
+ * name with linear probing (the bucket count is a power of two); the symbols as
+ * (name offset, address, type) records; the extern uses as (symbol index, address)
+ * records; and the pool of null-terminated names.
+ */
+#define SYMBOL_FILE_MAGIC "SYM1"
+#define SYMBOL_FILE_FIELD 4
+#define SYMBOL_FILE_HEADER (5 * SYMBOL_FILE_FIELD)
+#define SYMBOL_FILE_RECORD (3 * SYMBOL_FILE_FIELD)
+#define SYMBOL_FILE_REFERENCE (2 * SYMBOL_FILE_FIELD)
+
+/* Types of the symbol file records */
+#define SYMBOL_CODE 1
+#define SYMBOL_DATA 2
+#define SYMBOL_EXTERN 3
+#define SYMBOL_ENTRY 4 /* Added to SYMBOL_CODE or SYMBOL_DATA for an .entry label */
+
+/* A memory-mapped symbol file */
+typedef struct Symbol_File {
+    const unsigned char *data;
+    size_t size;
+    unsigned long symbols_count;
+    unsigned long buckets_count;
+    unsigned long references_count;
+    unsigned long names_size;
+    const unsigned char *buckets;
+    const unsigned char *symbols;
+    const unsigned char *references;
+    const char *names;
+} Symbol_File;
+
+/* A symbol or an extern use read from a symbol file */
+typedef struct Symbol_File_Entry {
+    const char *name; /* Points into the mapped file */
+    int address;
+    int type; /* SYMBOL_CODE, SYMBOL_DATA or SYMBOL_EXTERN, plus SYMBOL_ENTRY */
+} Symbol_File_Entry;
+
+/*
+ * Binary debug file "<name>.dbg", in the fields of the symbol file: a header with the magic
+ * "DBG1", the end of the code, the record and name-pool sizes; one (address, source line,
+ * macro line, macro) record per instruction in address order, where the lines are the ones
+ * of the .as file and the macro is 0 outside macros and 1 + the offset of its name
+ * otherwise; and the pool of null-terminated macro names.
+ */
+#define DEBUG_FILE_MAGIC "DBG1"
+#define DEBUG_FILE_HEADER (4 * SYMBOL_FILE_FIELD)
+#define DEBUG_FILE_RECORD (4 * SYMBOL_FILE_FIELD)
+
+/* A memory-mapped debug file */
+typedef struct Debug_File {
+    const unsigned char *data;
+    size_t size;
+    int code_end;
+    unsigned long lines_count;
+    unsigned long names_size;
+    const unsigned char *lines;
+    const char *names;
+} Debug_File;
+
+/* The source of an instruction read from a debug file */
+typedef struct Debug_Line {
+    int address; /* Address of the first word of the instruction */
+    int line; /* Line in the .as file, the macro call for a line of a macro body */
+    int macro_line; /* Line of the macro body, 0 outside macros */
+    const char *macro; /* Points into the mapped file, NULL outside macros */
+} Debug_Line;
+
+/**
+ * Maps "<name>.sym" and checks that its sections fit in the file.
+ * @param name Module file name without extension
+ * @param file The symbol file to open
+ * @return 0 on success, 1 on failure (an error is printed)
+ */
+int open_symbol_file(const char *name, Symbol_File *file);
+
+
+/**
+ * Looks up a label through the hashed index of a symbol file, without parsing the file.
+ * @param file The symbol file
+ * @param label The name of the label
+ * @param entry The symbol found
+ * @return 1 if the label was found, 0 otherwise
+ */
+int find_symbol_file_entry(const Symbol_File *file, const char *label, Symbol_File_Entry *entry);
+
+
+/**
+ * Reads an extern use of a symbol file.
+ * @param file The symbol file
+ * @param index The index of the use, in the order of the .ext file
+ * @param entry The extern label and the address of the use
+ * @return 1 if the use was read, 0 if the index or the record is out of range
+ */
+int get_symbol_file_reference(const Symbol_File *file, unsigned long index, Symbol_File_Entry *entry);
+
+
+/**
+ * Unmaps a symbol file.
+ * @param file The symbol file to close
+ */
+void close_symbol_file(Symbol_File *file);
+
+
+/**
+ * Maps "<name>.dbg" and checks that its sections fit in the file.
+ * @param name Module file name without extension
+ * @param file The debug file to open
+ * @return 0 on success, -1 if the file does not exist, 1 if it is not valid (an error is printed)
+ */
+int open_debug_file(const char *name, Debug_File *file);
+
+
+/**
+ * Finds the instruction that contains a code address with a binary search over the
+ * records of a debug file, without parsing the file.
+ * @param file The debug file
+ * @param address The code address
+ * @param line The source of the instruction
+ * @return 1 if the address was found, 0 if it is outside the code
+ */
+int find_debug_line(const Debug_File *file, int address, Debug_Line *line);
+
+
+/**
+ * Unmaps a debug file.
+ * @param file The debug file to close
+ */
+void close_debug_file(Debug_File *file);
+
+
+/**
+ * Maps "<name>.ob" and reads its header.
+ * @param name Module file name without extension
+ * @param reader The reader to open
+ * @return 0 on success, 1 on failure (an error is printed)
+ */
+int open_object_reader(const char *name, Object_Reader *reader);
+
+
+/**
+ * Reads the next word of an .ob file. Lines in the fixed-width layout of create_ob_file
+ * are parsed with SWAR arithmetic, other layouts fall back to a byte-by-byte parser.
+ * @param reader The reader
+ * @param word The word read
+ * @return 1 if a word was read, 0 at the end of the image, -1 on failure (an error is printed)
+ */
+int read_object_word(Object_Reader *reader, unsigned int *word);
+
+
+/**
+ * Unmaps the file of a reader.
+ * @param reader The reader to close
+ */
+void close_object_reader(Object_Reader *reader);
+
+
+/**
+ * Loads only the entries and extern uses of a module from "<name>.ent" and "<name>.ext", if they exist.
+ * @param name Module file name without extension
+ * @param module The module to fill, its symbol fields must be empty
+ * @return 0 on success, 1 on failure (an error is printed)
+ */
+int load_object_symbols(const char *name, Object_Module *module);
+
+
+/**
+ * Loads an object module from "<name>.ob" and, if they exist, "<name>.ent" and "<name>.ext".
+ * @param name Module file name without extension
+ * @param module The module to fill
+ * @return 0 on success, 1 on failure (an error is printed)
+ */
+int load_object_module(const char *name, Object_Module *module);
+
+
+/**
+ * Writes an object module to "<name>.ob" and, if it has entries or extern uses, "<name>.ent" and "<name>.ext".
+ * @param name Module file name without extension
+ * @param module The module to write
+ * @return 0 on success, 1 on failure (an error is printed)
+ */
+int write_object_module(const char *name, const Object_Module *module);
+
+
+/**
+ * Frees the memory of an object module.
+ * @param module The module to free
+ */
+void free_object_module(Object_Module *module);
+
+#endif
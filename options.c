@@ -0,0 +1,111 @@
+/**
+ * @file options.c
+ * @brief Parsing of the assembler command-line options.
+ *
+ * Options start with "--" and may appear anywhere between the file names.
+ * They apply to all the files of the run.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "options.h"
+#include "stats.h"
+#include "alloc.h"
+#include "trace.h"
+#include "report.h"
+#include "cost.h"
+#include "second_pass.h"
+#include "peephole.h"
+#include "strip.h"
+#include "dedup.h"
+#include "trusted.h"
+#include "assemble.h"
+#include "util.h"
+#include "const.h"
+
+static Options options = {STATS_OFF, 0, NULL, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+int parse_option(char *arg) {
+    if (strncmp(arg, "--", TWO) != 0)
+        return 0; /* Indicates argument is a file name */
+
+    if (strcmp(arg, "--stats") == 0 || strcmp(arg, "--stats=text") == 0) {
+        options.stats = STATS_TEXT;
+        set_stats_format(STATS_TEXT);
+        return 1;
+    }
+    if (strcmp(arg, "--stats=json") == 0) {
+        options.stats = STATS_JSON;
+        set_stats_format(STATS_JSON);
+        return 1;
+    }
+    if (strcmp(arg, "--mem") == 0) {
+        options.mem = 1;
+        set_mem_report(1);
+        return 1;
+    }
+    if (strncmp(arg, "--trace=", 8) == 0 && arg[8] != NULL_TERMINATOR) {
+        options.trace = arg + 8;
+        set_trace_file(options.trace);
+        return 1;
+    }
+    if (strcmp(arg, "--report") == 0) {
+        options.report = 1;
+        set_mix_report(1);
+        return 1;
+    }
+    if (strcmp(arg, "--cost") == 0 || (strncmp(arg, "--cost=", 7) == 0 && arg[7] != NULL_TERMINATOR)) {
+        options.cost = 1;
+        return set_cost_report(arg[6] == '=' ? arg + 7 : NULL) ? -1 : 1;
+    }
+    if (strcmp(arg, "--relax") == 0) {
+        options.relax = 1;
+        set_branch_relaxation(1);
+        return 1;
+    }
+    if (strcmp(arg, "--peephole") == 0) {
+        options.peephole = 1;
+        set_peephole(1);
+        return 1;
+    }
+    if (strcmp(arg, "--strip") == 0) {
+        options.strip = 1;
+        set_strip(1);
+        return 1;
+    }
+    if (strcmp(arg, "--dedup") == 0) {
+        options.dedup = 1;
+        set_dedup(1);
+        return 1;
+    }
+    if (strcmp(arg, "--group-ext") == 0) {
+        options.group_ext = 1;
+        set_extern_grouping(1);
+        return 1;
+    }
+    if (strcmp(arg, "--sym") == 0) {
+        options.sym = 1;
+        set_symbol_export(1);
+        return 1;
+    }
+    if (strcmp(arg, "--debug") == 0) {
+        options.debug = 1;
+        set_debug_export(1);
+        return 1;
+    }
+    if (strcmp(arg, "--trusted") == 0) {
+        options.trusted = 1;
+        set_trusted(1);
+        return 1;
+    }
+    if (strcmp(arg, "--check") == 0) {
+        options.check = 1;
+        set_check_only(1);
+        return 1;
+    }
+    printf("Error: Unknown option \"%s\"\n", arg);
+    return -1; /* Indicates invalid option */
+}
+
+const Options *get_options() {
+    return &options;
+}
@@ -0,0 +1,36 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+/* Command-line options that apply to all the files of a run */
+typedef struct Options {
+    int stats; /* Statistics report format (see Stats_Format) */
+    int mem; /* Whether to report memory usage per file */
+    char *trace; /* Name of the Chrome trace-event file, or NULL */
+    int report; /* Whether to report the instruction mix */
+    int cost; /* Whether to estimate the cycle cost of the code */
+    int relax; /* Whether to rewrite local direct branch targets as relative */
+    int peephole; /* Whether to remove redundant instructions after the first pass */
+    int strip; /* Whether to remove unreachable code and unreferenced data */
+    int dedup; /* Whether to merge identical labeled data blocks */
+    int group_ext; /* Whether to group the .ext lines by extern label */
+    int sym; /* Whether to write the binary symbol file */
+    int debug; /* Whether to write the binary debug file */
+    int trusted; /* Whether canonical instruction lines take the fast path of the first pass */
+    int check; /* Whether the files are only checked, without writing any file */
+} Options;
+
+/**
+ * Parses a single command-line argument if it is an option ("--name[=value]").
+ * @param arg The command-line argument.
+ * @return 1 if the argument is a valid option, 0 if it is not an option, -1 if it is an invalid option.
+ */
+int parse_option(char *arg);
+
+
+/**
+ * Gets the options of the current run.
+ * @return Pointer to the options.
+ */
+const Options *get_options();
+
+#endif
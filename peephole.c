@@ -0,0 +1,210 @@
+/**
+ * @file peephole.c
+ * @brief Peephole optimization of the encoded instruction stream.
+ *
+ * Runs between the first and second pass, while the operands that refer to labels
+ * are still unresolved. The following instructions are removed:
+ * "mov rX, rX", which changes nothing; an "inc rX" directly followed by a "dec rX"
+ * (or the other way around), which cancel out; and a "cmp" directly followed by
+ * another "cmp", since only "cmp" sets the zero flag and the second one overwrites it.
+ *
+ * A label of a removed instruction moves to the next kept instruction, so nothing is
+ * removed from the end of the code, and an "inc"/"dec" pair is kept when a label
+ * points between its two instructions. The removed words are dropped by compact.c.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "peephole.h"
+#include "machine_code.h"
+#include "compact.h"
+#include "symbols_list.h"
+#include "const.h"
+#include "alloc.h"
+#include "trace.h"
+
+/* An instruction of the code list */
+typedef struct Peephole_Instruction {
+    Code *first; /* First word */
+    int id; /* Index in the opcode table, -1 if unknown */
+    int length; /* Number of words */
+    int labeled; /* Whether a code label points to it */
+    int removed;
+} Peephole_Instruction;
+
+static int enabled = 0;
+
+void set_peephole(int value) {
+    enabled = value;
+}
+
+/* Checks if an instruction is the named one */
+static int is_named(const Peephole_Instruction *instruction, const char *name) {
+    return instruction->id >= 0 && strcmp(INSTRUCTIONS[instruction->id].instruction, name) == 0;
+}
+
+/* Gets the register of the operand at the given position, -1 if the operand is not a register */
+static int register_at(const Peephole_Instruction *instruction, int method_pos, int register_pos) {
+    if (((instruction->first->value >> method_pos) & METHOD_MASK) != DIRECT_REGISTER)
+        return -1;
+    return (int) ((instruction->first->value >> register_pos) & REGISTER_MASK);
+}
+
+/* Checks if an instruction is "mov rX, rX" */
+static int is_self_move(const Peephole_Instruction *instruction) {
+    int source = register_at(instruction, SRC_OPERAND_POS, SRC_REGISTER_POS);
+
+    return is_named(instruction, "mov") && source >= 0 &&
+           source == register_at(instruction, DST_OPERAND_POS, DST_REGISTER_POS);
+}
+
+/* Checks if two instructions are an "inc" and a "dec" of the same register, in any order */
+static int is_cancelling_pair(const Peephole_Instruction *first, const Peephole_Instruction *second) {
+    int reg = register_at(first, DST_OPERAND_POS, DST_REGISTER_POS);
+
+    if (reg < 0 || reg != register_at(second, DST_OPERAND_POS, DST_REGISTER_POS))
+        return 0;
+    return (is_named(first, "inc") && is_named(second, "dec")) ||
+           (is_named(first, "dec") && is_named(second, "inc"));
+}
+
+/* Prints a removed instruction */
+static void print_removed(const Peephole_Instruction *instruction, const char *reason) {
+    int reg = register_at(instruction, DST_OPERAND_POS, DST_REGISTER_POS);
+
+    printf("Peephole: removed \"%s", INSTRUCTIONS[instruction->id].instruction);
+    if (is_self_move(instruction))
+        printf(" %s, %s", REGISTERS[reg], REGISTERS[reg]);
+    else if (is_named(instruction, "inc") || is_named(instruction, "dec"))
+        printf(" %s", REGISTERS[reg]);
+    printf("\" at %07u (%s)\n", instruction->first->IC, reason);
+}
+
+/* Splits the code list into instructions and marks the ones that code labels point to */
+static Peephole_Instruction *list_instructions(Code *code_head, int words, int *count) {
+    Peephole_Instruction *instructions;
+    const Symbol_Table *table = get_symbol_table();
+    char *labeled;
+    Code *current;
+    int i, extra, symbol;
+
+    *count = 0;
+    for (current = code_head; current != NULL; (*count)++) {
+        for (extra = extra_words_of(current->value); current != NULL && extra >= 0; extra--)
+            current = current->next;
+    }
+    instructions = tracked_malloc(*count * sizeof(Peephole_Instruction), MEM_TEMP);
+    labeled = tracked_malloc(words + 1, MEM_TEMP);
+    if (instructions == NULL || labeled == NULL) {
+        printf("Error: Memory allocation failed\n");
+        tracked_free(instructions);
+        tracked_free(labeled);
+        return NULL;
+    }
+    memset(labeled, 0, words + 1);
+    for (symbol = 0; symbol < table->count; symbol++)
+        if (table->types[symbol] == CODE && table->addresses[symbol] >= IC_INITIAL &&
+            table->addresses[symbol] - IC_INITIAL < words)
+            labeled[table->addresses[symbol] - IC_INITIAL] = 1;
+
+    current = code_head;
+    for (i = 0; i < *count; i++) {
+        instructions[i].first = current;
+        instructions[i].id = instruction_of(current->value);
+        instructions[i].length = 1 + extra_words_of(current->value);
+        instructions[i].labeled = labeled[current->IC - IC_INITIAL];
+        instructions[i].removed = 0;
+        for (extra = instructions[i].length; current != NULL && extra > 0; extra--)
+            current = current->next;
+    }
+    tracked_free(labeled);
+    return instructions;
+}
+
+/* Marks the redundant instructions on a stack of the kept ones, returns the number of removed words */
+static int mark_removed(Peephole_Instruction *instructions, int count, int *kept, int *label_before,
+                        int *removed_count) {
+    /* Number of kept instructions, label_before[i] is 1 if a label points after kept[i - 1], up to kept[i] */
+    int top = 0;
+    int boundary = 0; /* Whether a label points after the last kept instruction */
+    int i, words = 0;
+    Peephole_Instruction *current, *previous;
+
+    *removed_count = 0;
+    for (i = 0; i < count; i++) {
+        current = &instructions[i];
+        previous = top > 0 ? &instructions[kept[top - 1]] : NULL;
+        boundary |= current->labeled;
+        if (i + 1 < count && is_self_move(current)) {
+            print_removed(current, "no effect");
+            current->removed = 1;
+        } else if (i + 1 < count && previous != NULL && !boundary && is_cancelling_pair(previous, current)) {
+            print_removed(previous, "cancelled by the next instruction");
+            print_removed(current, "cancelled by the previous instruction");
+            previous->removed = current->removed = 1;
+            boundary = label_before[--top];
+        } else {
+            if (previous != NULL && is_named(previous, "cmp") && is_named(current, "cmp")) {
+                print_removed(previous, "flag overwritten by the next cmp");
+                previous->removed = 1;
+                boundary |= label_before[--top];
+            }
+            label_before[top] = boundary;
+            kept[top++] = i;
+            boundary = 0;
+        }
+    }
+    for (i = 0; i < count; i++)
+        if (instructions[i].removed) {
+            words += instructions[i].length;
+            (*removed_count)++;
+        }
+    return words;
+}
+
+int peephole(Code **code_head, int *IC) {
+    Peephole_Instruction *instructions;
+    int *kept, *label_before, *new_address;
+    int words = *IC - IC_INITIAL, count, removed_count, removed_words, i, word, address;
+
+    if (!enabled || *code_head == NULL)
+        return 0;
+    trace_begin("peephole");
+    instructions = list_instructions(*code_head, words, &count);
+    if (instructions == NULL) {
+        trace_end("peephole");
+        return 1;
+    }
+    kept = tracked_malloc((count + 1) * sizeof(int), MEM_TEMP);
+    label_before = tracked_malloc((count + 1) * sizeof(int), MEM_TEMP);
+    new_address = tracked_malloc((words + 1) * sizeof(int), MEM_TEMP);
+    if (kept == NULL || label_before == NULL || new_address == NULL) {
+        printf("Error: Memory allocation failed\n");
+        tracked_free(instructions);
+        tracked_free(kept);
+        tracked_free(label_before);
+        tracked_free(new_address);
+        trace_end("peephole");
+        return 1;
+    }
+
+    removed_words = mark_removed(instructions, count, kept, label_before, &removed_count);
+    if (removed_words > 0) {
+        /* A removed word takes the address of the next kept word */
+        address = IC_INITIAL;
+        for (i = 0; i < count; i++)
+            for (word = 0; word < instructions[i].length; word++)
+                new_address[instructions[i].first->IC - IC_INITIAL + word] = instructions[i].removed
+                                                                                 ? address
+                                                                                 : address++;
+        new_address[words] = address;
+        compact_image(code_head, NULL, new_address, NULL, IC, NULL);
+    }
+    printf("Peephole removed %d instructions (%d words)\n", removed_count, removed_words);
+
+    tracked_free(instructions);
+    tracked_free(kept);
+    tracked_free(label_before);
+    tracked_free(new_address);
+    trace_end("peephole");
+    return 0;
+}
@@ -0,0 +1,24 @@
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include "code_list.h"
+
+/**
+ * Enables the peephole optimization of the code between the first and second pass.
+ * @param enabled 1 to enable the optimization, 0 to disable it.
+ */
+void set_peephole(int enabled);
+
+
+/**
+ * Removes redundant instructions from the code of the current file and moves the
+ * addresses of the labels, the operand fixups and the data labels to match, if the
+ * optimization is enabled. Prints every removed instruction and a summary.
+ * Must be called after the first pass, before the operands are resolved.
+ * @param code_head Pointer to the head of the code list.
+ * @param IC Pointer to the final instruction counter, lowered by the removed words.
+ * @return 0 on success, 1 if memory allocation failed.
+ */
+int peephole(Code **code_head, int *IC);
+
+#endif
@@ -0,0 +1,245 @@
+/**
+ * @file perf_regress.c
+ * @brief Performance-regression harness for the assembler.
+ * @details Assembles every corpus file several times in-process, checks the produced
+ *          .ob/.ent/.ext files against the golden "<name>.v.<ext>" files that sit next
+ *          to the source, and compares the mean time of every stage with a stored
+ *          baseline. The other correctness checks are run by selfcheck, which needs no
+ *          baseline. A stage is reported as a regression only when it is slower than
+ *          the baseline by more than the tolerance and by more than the run-to-run
+ *          noise (three standard errors of the difference of the means).
+ *
+ *          Usage: perf_regress [--runs=N] [--tolerance=PERCENT] [--min-ms=MS]
+ *                              [--baseline=FILE] [--update] file_name_1 ... file_name_N
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "assemble.h"
+#include "harness.h"
+#include "stats.h"
+#include "const.h"
+
+#define DEFAULT_RUNS 10
+#define DEFAULT_TOLERANCE 25.0
+#define DEFAULT_MIN_MS 0.05
+#define NOISE_FACTOR 3.0
+#define TOTAL_STAGE STAGES_COUNT /* Index of the sum of all stages */
+
+/* Timing summary of one stage of one file */
+typedef struct Timing {
+    char name[MAX_LINE_LENGTH];
+    char stage[MAX_LINE_LENGTH];
+    double mean; /* Milliseconds */
+    double stddev; /* Milliseconds */
+    int runs;
+} Timing;
+
+static int runs = DEFAULT_RUNS;
+static double tolerance = DEFAULT_TOLERANCE;
+static double min_ms = DEFAULT_MIN_MS;
+static char *baseline_name = "perf_baseline.txt";
+static int update = 0;
+
+static Timing *baseline = NULL; /* Stored baseline entries */
+static int baseline_count = 0;
+static Timing *results = NULL; /* Timings of this run */
+static int results_count = 0;
+
+/* Appends a timing to an array, exits if memory allocation failed */
+static void append_timing(Timing **array, int *count, const Timing *timing) {
+    Timing *new_array = realloc(*array, (*count + 1) * sizeof(Timing));
+    if (new_array == NULL) {
+        printf("Error: Memory allocation failed\n");
+        exit(1);
+    }
+    *array = new_array;
+    (*array)[(*count)++] = *timing;
+}
+
+/* Returns the base name of a path (the part after the last '/') */
+static const char *base_name(const char *path) {
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+/* Times the runs of a file and appends the summary of every stage to the results */
+static int time_file(char *name) {
+    double sum[STAGES_COUNT + 1] = {0}, sum_squares[STAGES_COUNT + 1] = {0}, value, total;
+    const File_Stats *stats;
+    Timing timing;
+    int run, stage;
+
+    if (assemble_quietly(name) != 0) {
+        /* Warm-up run, also shows why the file failed */
+        assemble_file(name);
+        printf("FAILED: %s does not assemble\n", name);
+        return 1;
+    }
+    for (run = 0; run < runs; run++) {
+        assemble_quietly(name);
+        stats = get_file_stats();
+        total = 0;
+        for (stage = 0; stage <= STAGES_COUNT; stage++) {
+            value = stage == TOTAL_STAGE ? total : stats->wall[stage] * 1000;
+            total += value;
+            sum[stage] += value;
+            sum_squares[stage] += value * value;
+        }
+    }
+    for (stage = 0; stage <= STAGES_COUNT; stage++) {
+        strncpy(timing.name, base_name(name), MAX_LINE_LENGTH - 1);
+        timing.name[MAX_LINE_LENGTH - 1] = NULL_TERMINATOR;
+        strcpy(timing.stage, stage == TOTAL_STAGE ? "total" : STAGE_NAMES[stage]);
+        timing.mean = sum[stage] / runs;
+        value = sum_squares[stage] / runs - timing.mean * timing.mean;
+        timing.stddev = runs > 1 && value > 0 ? sqrt(value * runs / (runs - 1)) : 0;
+        timing.runs = runs;
+        append_timing(&results, &results_count, &timing);
+    }
+    return 0;
+}
+
+/* Loads the baseline file, returns 0 if it does not exist */
+static int load_baseline() {
+    char line[MAX_LINE_LENGTH * 3];
+    Timing timing;
+    FILE *file = fopen(baseline_name, "r");
+
+    if (file == NULL)
+        return 0;
+    while (fgets(line, sizeof(line), file)) {
+        if (line[0] == '#')
+            continue;
+        if (sscanf(line, "%81s %81s %lf %lf %d", timing.name, timing.stage, &timing.mean, &timing.stddev,
+                   &timing.runs) == 5)
+            append_timing(&baseline, &baseline_count, &timing);
+    }
+    fclose(file);
+    return 1;
+}
+
+/* Writes the results of this run as the new baseline */
+static int save_baseline() {
+    int i;
+    FILE *file = fopen(baseline_name, "w");
+
+    if (file == NULL) {
+        printf("Error: can't create %s\n", baseline_name);
+        return 1;
+    }
+    fprintf(file, "# file stage mean_ms stddev_ms runs\n");
+    for (i = 0; i < results_count; i++)
+        fprintf(file, "%s %s %.6f %.6f %d\n", results[i].name, results[i].stage, results[i].mean, results[i].stddev,
+                results[i].runs);
+    fclose(file);
+    printf("Baseline written to %s\n", baseline_name);
+    return 0;
+}
+
+/* Finds the baseline entry of a result */
+static const Timing *find_baseline(const Timing *result) {
+    int i;
+    for (i = 0; i < baseline_count; i++)
+        if (strcmp(baseline[i].name, result->name) == 0 && strcmp(baseline[i].stage, result->stage) == 0)
+            return &baseline[i];
+    return NULL;
+}
+
+/* Compares the results with the baseline, returns the number of regressions */
+static int compare_baseline() {
+    const Timing *base;
+    double delta, noise;
+    int i, regressions = 0;
+
+    printf("\n%-12s %-12s %12s %12s %12s %9s\n", "file", "stage", "mean (ms)", "stddev (ms)", "base (ms)", "change");
+    for (i = 0; i < results_count; i++) {
+        base = find_baseline(&results[i]);
+        if (base == NULL) {
+            printf("%-12s %-12s %12.4f %12.4f %12s %9s\n", results[i].name, results[i].stage, results[i].mean,
+                   results[i].stddev, "-", "new");
+            continue;
+        }
+        delta = results[i].mean - base->mean;
+        noise = NOISE_FACTOR * sqrt(results[i].stddev * results[i].stddev / results[i].runs +
+                                    base->stddev * base->stddev / base->runs);
+        printf("%-12s %-12s %12.4f %12.4f %12.4f %+8.1f%%", results[i].name, results[i].stage, results[i].mean,
+               results[i].stddev, base->mean, base->mean > 0 ? delta * 100 / base->mean : 0);
+        if (delta > base->mean * tolerance / 100 && delta > noise && delta > min_ms) {
+            printf("  REGRESSION");
+            regressions++;
+        }
+        printf("\n");
+    }
+    return regressions;
+}
+
+/* Parses a harness option, returns 0 if the argument is a file name and -1 if the option is invalid */
+static int parse_harness_option(char *arg) {
+    if (strncmp(arg, "--", TWO) != 0)
+        return 0;
+    if (strncmp(arg, "--runs=", 7) == 0 && (runs = atoi(arg + 7)) > 0)
+        return 1;
+    if (strncmp(arg, "--tolerance=", 12) == 0 && (tolerance = atof(arg + 12)) >= 0)
+        return 1;
+    if (strncmp(arg, "--min-ms=", 9) == 0 && (min_ms = atof(arg + 9)) >= 0)
+        return 1;
+    if (strncmp(arg, "--baseline=", 11) == 0 && arg[11] != NULL_TERMINATOR) {
+        baseline_name = arg + 11;
+        return 1;
+    }
+    if (strcmp(arg, "--update") == 0) {
+        update = 1;
+        return 1;
+    }
+    printf("Error: Invalid option \"%s\"\n", arg);
+    return -1;
+}
+
+/**
+ * @brief Runs the corpus, checks the outputs and compares the timings with the baseline.
+ * @param argc The number of command-line arguments.
+ * @param argv An array of command-line arguments.
+ * @return 0 if all outputs match and there are no regressions, 1 otherwise.
+ */
+int main(int argc, char *argv[]) {
+    int i, files = 0, failures = 0, regressions;
+
+    for (i = 1; i < argc; i++) {
+        switch (parse_harness_option(argv[i])) {
+            case -1:
+                return 1;
+            case 0:
+                files++;
+                break;
+            default:
+                break;
+        }
+    }
+    if (files == 0) {
+        printf("Error: No files entered\n");
+        return 1;
+    }
+    for (i = 1; i < argc; i++) {
+        if (parse_harness_option(argv[i]) != 0)
+            continue;
+        if (time_file(argv[i]) != 0)
+            failures++;
+        else
+            failures += check_golden(argv[i]);
+    }
+    if (update || !load_baseline()) {
+        if (!update)
+            printf("No baseline found, recording this run\n");
+        save_baseline();
+        compare_baseline();
+        return failures != 0;
+    }
+    regressions = compare_baseline();
+    printf("\n%d output mismatches, %d regressions (tolerance %.1f%%, %d runs)\n", failures, regressions, tolerance,
+           runs);
+    free(results);
+    free(baseline);
+    return failures != 0 || regressions != 0;
+}
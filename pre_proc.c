@@ -12,7 +12,65 @@
 #include "validations.h"
 #include "util.h"
 #include "macro_list.h"
+#include "source_map.h"
 #include "const.h"
+#include "stats.h"
+#include "report.h"
+#include "alloc.h"
+
+#define INITIAL_EXPANSION 4096
+
+/* Expanded source of the last file when it is kept in memory */
+static int in_memory = 0;
+static char *expanded = NULL;
+static long expanded_size = 0;
+static long expanded_capacity = 0;
+
+void set_expansion_in_memory(int enabled) {
+    in_memory = enabled;
+}
+
+const char *get_expanded_source() {
+    if (!in_memory)
+        return NULL;
+    return expanded != NULL ? expanded : "";
+}
+
+void free_expanded_source() {
+    tracked_free(expanded);
+    expanded = NULL;
+    expanded_size = expanded_capacity = 0;
+}
+
+/* Writes expanded text to the .am file, or to the expansion in memory, and maps its lines
+ * to the .as line and the macro they come from, returns 0 on success */
+static int emit(const char *text, FILE *out, int line, int macro) {
+    long length, capacity = expanded_capacity > 0 ? expanded_capacity : INITIAL_EXPANSION;
+    char *grown;
+
+    if (text == NULL)
+        return 0; /* Indicates an empty macro */
+    length = (long) strlen(text);
+    if (add_expanded_lines(text, line, macro) != 0)
+        return 1;
+    if (out != NULL) {
+        fputs(text, out);
+        return 0;
+    }
+    while (expanded_size + length + 1 > capacity)
+        capacity *= 2;
+    if (capacity != expanded_capacity) {
+        if ((grown = tracked_realloc(expanded, capacity, MEM_STRINGS)) == NULL) {
+            printf("Error: Memory allocation failed\n");
+            return 1;
+        }
+        expanded = grown;
+        expanded_capacity = capacity;
+    }
+    memcpy(expanded + expanded_size, text, length + 1); /* +1 to copy the '\0' */
+    expanded_size += length;
+    return 0;
+}
 
 /* Expands macro calls and creates an .am output file from a .as source */
 int pre_proc(char *name) {
@@ -32,21 +90,26 @@ int pre_proc(char *name) {
     src = fopen(src_name, "r");
     if (!src) {
         printf("Error: can't open %s\n", src_name);
-        free(src_name);
-        free(out_name);
+        tracked_free(src_name);
+        tracked_free(out_name);
         return 1;
     }
-    out = fopen(out_name, "w");
-    if (!out) {
+    /* The expansion in memory starts empty, no file is created */
+    expanded_size = 0;
+    if (expanded != NULL)
+        expanded[0] = NULL_TERMINATOR;
+    out = in_memory ? NULL : fopen(out_name, "w");
+    if (!out && !in_memory) {
         printf("Error: can't create %s\n", out_name);
         fclose(src);
-        free(src_name);
-        free(out_name);
+        tracked_free(src_name);
+        tracked_free(out_name);
         return 1;
     }
 
     if (scan_as_file(src, out, src_name, out_name, &head)) {
-        delete_file(out_name);
+        if (out != NULL)
+            delete_file(out_name);
         cleanup(src, out, src_name, out_name, &head);
         return 1;
     }
@@ -71,6 +134,8 @@ int scan_as_file(FILE *src, FILE *out, char *src_name, char *out_name, Macro **h
     /* loop through each line of the source file */
     while (fgets(line, MAX_LINE_LENGTH, src)) {
         line_num++;
+        stats_add(COUNT_LINES, 1);
+        stats_add(COUNT_BYTES_IN, (long) strlen(line));
         /* Check if line is too long */
         if (strlen(line) == MAX_LINE_LENGTH - 1 && line[MAX_LINE_LENGTH - 2] != '\n') {
             print_error("Line too long", src_name, line_num);
@@ -91,14 +156,18 @@ void process_line(char *line, FILE *out, FILE *src, char *src_name, char *out_na
                   int *error, Macro **head) {
     char trimmed_line[MAX_LINE_LENGTH]; /* trimmed line of the line */
     char *macro_name = NULL; /* Macro aname */
-    char *current_word; /* Current word being processed */
+    char current_word[MAX_LINE_LENGTH]; /* Current word being processed */
+    size_t curr_word_len;
     Macro *macro;
     strcpy(trimmed_line, line);
     trim_whitespace(trimmed_line);
 
     /* If line is comment, write it to output */
     if (*line == COMMENT) {
-        fputs(line, out);
+        if (emit(line, out, *line_num, NO_MACRO)) {
+            cleanup(src, out, src_name, out_name, head);
+            exit(1);
+        }
         return;
     }
 
@@ -112,7 +181,11 @@ void process_line(char *line, FILE *out, FILE *src, char *src_name, char *out_na
     /* Check if line is a macro call */
     macro = is_macro_name(trimmed_line, *head);
     if (macro) {
-        fputs(macro->content, out);
+        report_macro_expansion(macro->name);
+        if (emit(macro->content, out, *line_num, macro->source)) {
+            cleanup(src, out, src_name, out_name, head);
+            exit(1);
+        }
         return;
     }
 
@@ -125,7 +198,7 @@ void process_line(char *line, FILE *out, FILE *src, char *src_name, char *out_na
             return;
         }
         /* Add macro to list */
-        if (add_macro(macro_name, head)) {
+        if (add_macro(macro_name, head) || add_source_macro(get_last_macro(*head))) {
             cleanup(src, out, src_name, out_name, head);
             exit(1);
         }
@@ -147,33 +220,28 @@ void process_line(char *line, FILE *out, FILE *src, char *src_name, char *out_na
             return;
         }
         /* Append content to macro */
-        if (append_macro_content(line, *head)) {
+        if (append_macro_content(line, *head) || add_macro_source_line(*line_num)) {
             cleanup(src, out, src_name, out_name, head);
             exit(1);
         }
         return;
     }
 
-    current_word = get_first_word(line);
-    if (current_word == NULL) {
-        /* Indicates memory allocation failed */
-        cleanup(src, out, src_name, out_name, head);
-        free(current_word);
-        exit(1);
-    }
+    curr_word_len = copy_first_word(line, current_word);
 
     /* Checking for a potential label definition */
-    if (current_word[strlen(current_word) - 1] == COLON) {
+    if (curr_word_len > 0 && current_word[curr_word_len - 1] == COLON) {
         /* Checking if the label is a macro label */
         if (is_macro_name(current_word, *head) != NULL) {
             print_error("Invalid label declaration: a label cannot be the same as a macro label", src_name, *line_num);
-            free(current_word);
             *error = 1;
             return;
         }
     }
-    free(current_word);
-    fputs(line, out);
+    if (emit(line, out, *line_num, NO_MACRO)) {
+        cleanup(src, out, src_name, out_name, head);
+        exit(1);
+    }
 }
 
 char *parse_macro_line(char *line, char *file, int line_num, Macro **head) {
@@ -200,9 +268,10 @@ char *parse_macro_line(char *line, char *file, int line_num, Macro **head) {
 
 void cleanup(FILE *src, FILE *out, char *src_name, char *out_name, Macro **head) {
     fclose(src);
-    fclose(out);
+    if (out != NULL)
+        fclose(out);
     free_macros(head);
-    free(src_name);
-    free(out_name);
+    tracked_free(src_name);
+    tracked_free(out_name);
 }
 
@@ -10,6 +10,23 @@
  */
 int pre_proc(char *name);
 
+/**
+ * Keeps the expanded source in memory instead of writing the .am file.
+ * @param enabled 1 to keep the expansion in memory, 0 to write the .am file.
+ */
+void set_expansion_in_memory(int enabled);
+
+/**
+ * Gets the expanded source of the last pre-processed file when it is kept in memory.
+ * @return The expanded source, or NULL if it was written to the .am file.
+ */
+const char *get_expanded_source();
+
+/**
+ * Frees the expanded source kept in memory.
+ */
+void free_expanded_source();
+
 /**
  * Checks if the input label ends with ".as"
  * @param name - Source file name without extension
@@ -0,0 +1,217 @@
+/**
+ * @file report.c
+ * @brief Instruction-mix and addressing-mode histogram report.
+ *
+ * The counters are updated as a side effect of encoding (an array increment per
+ * instruction and operand), so the report can be enabled on any run. When the report
+ * is enabled, the instructions and operands are counted again from the first words of
+ * the final code, so the instructions that --peephole and --strip remove are not
+ * counted. Macro and extern names are counted in small name lists, per file and for
+ * the whole run.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "report.h"
+#include "symbols_list.h"
+#include "machine_code.h"
+#include "alloc.h"
+#include "const.h"
+
+/* Number of occurrences of a name */
+typedef struct Name_Count {
+    char *name;
+    long count;
+    struct Name_Count *next;
+} Name_Count;
+
+/* Counters of a single file or of the whole run */
+typedef struct Mix {
+    long instructions[INSTRUCTIONS_COUNT];
+    long methods[SLOTS_COUNT][METHODS_COUNT];
+    long data_words;
+    long string_words;
+    Name_Count *macros;
+    Name_Count *externs;
+} Mix;
+
+static const char *METHOD_NAMES[] = {"immediate", "direct", "relative", "register"};
+static const char *SLOT_NAMES[] = {"source", "destination"};
+
+static int enabled = 0;
+static Mix file_mix; /* Counters of the current file */
+static Mix total_mix; /* Counters of the whole run */
+
+/* Adds an amount to the count of a name, adding the name to the list if needed */
+static void count_name(Name_Count **list, const char *name, long amount) {
+    Name_Count *current = *list, *last = NULL;
+
+    while (current != NULL) {
+        if (strcmp(current->name, name) == 0) {
+            current->count += amount;
+            return;
+        }
+        last = current;
+        current = current->next;
+    }
+    current = tracked_malloc(sizeof(Name_Count), MEM_REPORTS);
+    if (current == NULL)
+        return; /* The report is best effort, counting stops if memory ran out */
+    current->name = tracked_malloc(strlen(name) + 1, MEM_REPORTS);
+    if (current->name == NULL) {
+        tracked_free(current);
+        return;
+    }
+    strcpy(current->name, name);
+    current->count = amount;
+    current->next = NULL;
+    if (last == NULL)
+        *list = current;
+    else
+        last->next = current;
+}
+
+/* Frees a name list */
+static void free_names(Name_Count **list) {
+    Name_Count *current = *list, *next;
+
+    while (current != NULL) {
+        next = current->next;
+        tracked_free(current->name);
+        tracked_free(current);
+        current = next;
+    }
+    *list = NULL;
+}
+
+/* Prints a name list as "name count" pairs, returns the sum of the counts */
+static long print_names(const Name_Count *list) {
+    long sum = 0;
+
+    for (; list != NULL; list = list->next) {
+        fprintf(stderr, " %s %ld", list->name, list->count);
+        sum += list->count;
+    }
+    return sum;
+}
+
+/* Prints the report of a file or of the run */
+static void print_mix(const char *name, const Mix *mix) {
+    const Name_Count *current;
+    long references = 0, symbols = 0;
+    int i, j;
+
+    fprintf(stderr, "Instruction mix for %s:\n  instructions:", name);
+    for (i = 0; i < INSTRUCTIONS_COUNT; i++)
+        if (mix->instructions[i])
+            fprintf(stderr, " %s %ld", INSTRUCTIONS[i].instruction, mix->instructions[i]);
+    fprintf(stderr, "\n  %-12s", "addressing");
+    for (j = 0; j < METHODS_COUNT; j++)
+        fprintf(stderr, " %10s", METHOD_NAMES[j]);
+    for (i = 0; i < SLOTS_COUNT; i++) {
+        fprintf(stderr, "\n  %-12s", SLOT_NAMES[i]);
+        for (j = 0; j < METHODS_COUNT; j++)
+            fprintf(stderr, " %10ld", mix->methods[i][j]);
+    }
+    fprintf(stderr, "\n  .data words %ld, .string words %ld\n", mix->data_words, mix->string_words);
+    fprintf(stderr, "  macro expansions:");
+    print_names(mix->macros);
+    for (current = mix->externs; current != NULL; current = current->next) {
+        references += current->count;
+        symbols++;
+    }
+    fprintf(stderr, "\n  extern references %ld (%ld symbols):", references, symbols);
+    print_names(mix->externs);
+    fprintf(stderr, "\n");
+}
+
+void set_mix_report(int new_enabled) {
+    enabled = new_enabled;
+}
+
+void report_start_file() {
+    free_names(&file_mix.macros);
+    free_names(&file_mix.externs);
+    memset(&file_mix, 0, sizeof(file_mix));
+}
+
+void report_end_file(const char *name) {
+    const Name_Count *current;
+    int i, j;
+
+    if (!enabled)
+        return;
+    for (i = 0; i < INSTRUCTIONS_COUNT; i++)
+        total_mix.instructions[i] += file_mix.instructions[i];
+    for (i = 0; i < SLOTS_COUNT; i++)
+        for (j = 0; j < METHODS_COUNT; j++)
+            total_mix.methods[i][j] += file_mix.methods[i][j];
+    total_mix.data_words += file_mix.data_words;
+    total_mix.string_words += file_mix.string_words;
+    for (current = file_mix.macros; current != NULL; current = current->next)
+        count_name(&total_mix.macros, current->name, current->count);
+    for (current = file_mix.externs; current != NULL; current = current->next)
+        count_name(&total_mix.externs, current->name, current->count);
+    print_mix(name, &file_mix);
+}
+
+void report_instruction(int instruct_id) {
+    file_mix.instructions[instruct_id]++;
+}
+
+void report_method(Operand_Slot slot, int method) {
+    file_mix.methods[slot][method]++;
+}
+
+void report_final_code(const Code *code_head) {
+    unsigned int word;
+    int id, extra;
+
+    if (!enabled)
+        return;
+    memset(file_mix.instructions, 0, sizeof(file_mix.instructions));
+    memset(file_mix.methods, 0, sizeof(file_mix.methods));
+    while (code_head != NULL) {
+        word = code_head->value;
+        if ((id = instruction_of(word)) >= 0) {
+            file_mix.instructions[id]++;
+            if (INSTRUCTIONS[id].operands_num == 2)
+                file_mix.methods[SOURCE_SLOT][(word >> SRC_OPERAND_POS) & METHOD_MASK]++;
+            if (INSTRUCTIONS[id].operands_num >= 1)
+                file_mix.methods[DESTINATION_SLOT][(word >> DST_OPERAND_POS) & METHOD_MASK]++;
+        }
+        for (extra = extra_words_of(word); code_head != NULL && extra >= 0; extra--)
+            code_head = code_head->next; /* Skipping to the next first word */
+    }
+}
+
+void report_data_words(long words) {
+    file_mix.data_words += words;
+}
+
+void report_string_words(long words) {
+    file_mix.string_words += words;
+}
+
+void report_macro_expansion(const char *name) {
+    if (enabled)
+        count_name(&file_mix.macros, name, 1);
+}
+
+void report_extern_references() {
+    const Extern_Reference *references;
+    int i, count;
+
+    if (!enabled)
+        return;
+    references = get_extern_references(&count);
+    for (i = 0; i < count; i++)
+        count_name(&file_mix.externs, symbol_name(references[i].symbol), 1);
+}
+
+void print_total_report() {
+    if (enabled)
+        print_mix("all files", &total_mix);
+    report_start_file();
+    free_names(&total_mix.macros);
+    free_names(&total_mix.externs);
+}
@@ -0,0 +1,88 @@
+#ifndef REPORT_H
+#define REPORT_H
+
+#include "code_list.h"
+
+/* Operand slots of an instruction */
+typedef enum Operand_Slot {
+    SOURCE_SLOT,
+    DESTINATION_SLOT,
+    SLOTS_COUNT
+} Operand_Slot;
+
+/**
+ * Enables printing of the instruction-mix report after every file and for the whole run.
+ * @param enabled 1 to enable the report, 0 to disable it.
+ */
+void set_mix_report(int enabled);
+
+
+/**
+ * Resets the per-file counters before a new file is processed.
+ */
+void report_start_file();
+
+
+/**
+ * Adds the per-file counters to the run totals and prints the file report if enabled.
+ * @param name The name of the file that was processed.
+ */
+void report_end_file(const char *name);
+
+
+/**
+ * Counts an encoded instruction.
+ * @param instruct_id Index of the instruction in the INSTRUCTIONS table.
+ */
+void report_instruction(int instruct_id);
+
+
+/**
+ * Counts the addressing method of an operand.
+ * @param slot The operand slot (source or destination).
+ * @param method The addressing method.
+ */
+void report_method(Operand_Slot slot, int method);
+
+
+/**
+ * Counts data words emitted by a ".data" prompt.
+ * @param words Number of words.
+ */
+void report_data_words(long words);
+
+
+/**
+ * Counts data words emitted by a ".string" prompt (including the null-terminator).
+ * @param words Number of words.
+ */
+void report_string_words(long words);
+
+
+/**
+ * Counts the instructions and operand methods again from the final code, after the
+ * optimizations that remove instructions, if the report is enabled.
+ * @param code_head The head of the code list.
+ */
+void report_final_code(const Code *code_head);
+
+
+/**
+ * Counts an expansion of a macro.
+ * @param name The name of the macro.
+ */
+void report_macro_expansion(const char *name);
+
+
+/**
+ * Counts the references to extern labels from the label list after the fixups were resolved.
+ */
+void report_extern_references();
+
+
+/**
+ * Prints the instruction-mix report of the whole run if enabled, and frees the report memory.
+ */
+void print_total_report();
+
+#endif
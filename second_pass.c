@@ -13,38 +13,97 @@
 #include "second_pass.h"
 #include "util.h"
 #include "validations.h"
+#include "machine_code.h"
 #include "code_list.h"
 #include "data_list.h"
+#include "stats.h"
+#include "trace.h"
+#include "report.h"
+#include "alloc.h"
+#include "hash_table.h"
+#include "pre_proc.h"
+#include "source_map.h"
 
-int code_operand_labels(char *file_am_name, Code *code_head) {
+static int relax = 0; /* Whether local direct branch targets are rewritten as relative */
+static int relaxed_count = 0; /* Branches relaxed in the current file */
+
+static int symbol_export = 0; /* Whether the binary symbol file is written */
+static int debug_export = 0; /* Whether the binary debug file is written */
+
+void set_symbol_export(int enabled) {
+    symbol_export = enabled;
+}
+
+void set_debug_export(int enabled) {
+    debug_export = enabled;
+}
+
+void set_branch_relaxation(int enabled) {
+    relax = enabled;
+}
+
+/* Rewrites the direct operand of a branch as relative, returns 1 if it was rewritten */
+static int relax_branch(Code *first_word, Code *operand_word, int address) {
+    int id, displacement;
+
+    if (!relax || first_word == NULL || (id = instruction_of(first_word->value)) < 0)
+        return 0;
+    /* Only the one-operand instructions that accept a relative destination ("jmp", "bne" and "jsr") */
+    if (INSTRUCTIONS[id].destination_methods != METHODS_1_2 || INSTRUCTIONS[id].operands_num != 1)
+        return 0;
+    displacement = address - (int) first_word->IC;
+    if (displacement < MIN_VALUE || displacement > MAX_VALUE)
+        return 0;
+    first_word->value &= ~((unsigned int) METHOD_MASK << DST_OPERAND_POS);
+    first_word->value |= (unsigned int) RELATIVE << DST_OPERAND_POS;
+    operand_word->value = (((unsigned int) displacement & MASK_VALUE) << VALUE_POS) | BIT_ABSOLUTE_FLAG;
+    relaxed_count++;
+    return 1;
+}
+
+int code_operand_labels(char *file_name, Code *code_head) {
     int error = 0;
-    Symbol *operand_label, *label;
+    Symbol_Table *table = get_symbol_table();
+    int operand_label, label;
+    Code *first_word = NULL; /* First word of the current instruction, tracked for relaxation */
+    int extra_words = 0; /* Extra words of the current instruction not reached yet */
     unsigned int word = 0;
+    relaxed_count = 0;
     /* Looping through code array */
     while (code_head != NULL) {
+        if (relax && extra_words > 0) {
+            extra_words--;
+        } else if (relax) {
+            first_word = code_head;
+            extra_words = extra_words_of(code_head->value);
+        }
         /* Checking if the instruction is of type "direct" */
         if ((code_head->value & BIT_MASK_DIRECT) == BIT_MASK_DIRECT) {
             operand_label = get_operand_label(); /* Getting the next label of type "operand" */
-            if (operand_label == NULL) {
+            if (operand_label == NO_SYMBOL) {
                 return error; /* Indicates no more labels of type "operand" left */
             }
-            if ((label = is_label_defined(operand_label->label)) != NULL) {
+            if ((label = is_label_defined(symbol_name(operand_label))) != NO_SYMBOL &&
+                table->types[label] != EXTERN && relax_branch(first_word, code_head, table->addresses[label])) {
+                /* A relative operand needs no relocation */
+                remove_label(operand_label);
+            } else if (label != NO_SYMBOL) {
                 /* Checking if this label was defined */
-                word |= (unsigned int) (label->address & MASK_21BIT);
+                word |= (unsigned int) (table->addresses[label] & MASK_VALUE);
                 word <<= BIT_MASK_DIRECT;
 
-                if (label->type == EXTERN) {
+                if (table->types[label] == EXTERN) {
                     /* Indicates operand label is of type "extern" */
                     word |= BIT_MASK_EXTERNAL; /* Setting bit 0 for "External" */
-                    operand_label->type = EXTERN; /* Updating the address of the label */
+                    if (add_extern_reference(label, (int) code_head->IC) != 0)
+                        error = 1;
                 } else {
                     word |= BIT_MASK_RELOCATABLE; /* Setting bit 1 for "Relocatable" */
-                    remove_label(operand_label);
                 }
+                remove_label(operand_label);
                 code_head->value = word; /* Updating machine code */
             } else {
-                print_error("Unrecognized operand, please check syntax", file_am_name,
-                            (int) ((code_head->IC) - IC_INITIAL));
+                print_source_error("Unrecognized operand, please check syntax", file_name, (int) code_head->IC);
                 remove_label(operand_label);
                 error = 1; /* Indicates failure */
             }
@@ -52,17 +111,20 @@ int code_operand_labels(char *file_am_name, Code *code_head) {
         if ((code_head->value & BIT_MASK_RELATIVE) == BIT_MASK_RELATIVE) {
             /* Searching for instruction symbol addresses signaled by the first pass */
             operand_label = get_operand_label(); /* Getting the next label of type "operand" */
-            if (operand_label == NULL) {
+            if (operand_label == NO_SYMBOL) {
                 return error; /* Indicates no more labels of type "operand" left */
             }
 
-            if ((label = is_label_defined(operand_label->label)) != NULL) {
+            if ((label = is_label_defined(symbol_name(operand_label))) != NO_SYMBOL) {
                 /* Checking if this label was defined */
 
-                word |= (((label->address) - ((code_head->value) >> FUNCS_POS) + 1) & MASK_21BIT);
-                word <<= FUNCS_POS;
+                word |= (((table->addresses[label]) - ((code_head->value) >> VALUE_POS) + 1) & MASK_VALUE);
+                word <<= VALUE_POS;
                 word |= BIT_ABSOLUTE_FLAG;
                 code_head->value = word; /* Updating machine code */
+            } else {
+                print_source_error("Unrecognized operand, please check syntax", file_name, (int) code_head->IC);
+                error = 1; /* Indicates failure */
             }
             remove_label(operand_label);
         }
@@ -72,47 +134,139 @@ int code_operand_labels(char *file_am_name, Code *code_head) {
     return error;
 }
 
+/* Reports the operands whose label is not defined, from the symbols alone, returns 1 if one was found */
+static int check_operand_labels(char *file_name) {
+    const Symbol_Table *table = get_symbol_table();
+    Hash_Table defined;
+    int symbol, error = 0;
+
+    if (init_hash_table(&defined, (unsigned long) table->count) != 0) {
+        printf("Error: Memory allocation failed\n");
+        return 1;
+    }
+    for (symbol = 0; symbol < table->count; symbol++)
+        if ((table->types[symbol] == CODE || table->types[symbol] == DATA || table->types[symbol] == EXTERN) &&
+            hash_insert(&defined, symbol_name(symbol), symbol) < 0) {
+            printf("Error: Memory allocation failed\n");
+            free_hash_table(&defined);
+            return 1;
+        }
+    /* Every fixup holds the address of its operand word, like the words code_operand_labels reports */
+    for (symbol = 0; symbol < table->count; symbol++)
+        if (table->types[symbol] == OPERAND && hash_find(&defined, symbol_name(symbol)) == NULL) {
+            print_source_error("Unrecognized operand, please check syntax", file_name, table->addresses[symbol]);
+            error = 1;
+        }
+    free_hash_table(&defined);
+    return error;
+}
+
+int check_labels(char *file_name) {
+    char *file_am_name;
+    int error;
+
+    stage_begin(STAGE_FIXUPS);
+    trace_begin("check_operand_labels");
+    error = check_operand_labels(file_name);
+    trace_end("check_operand_labels");
+    stage_end(STAGE_FIXUPS);
+    if (error != 0) {
+        free_labels();
+        return 1; /* Indicates failure */
+    }
+
+    /* Scanning the expanded source for the ".entry" lines */
+    file_am_name = add_extension(file_name, ".am");
+    stage_begin(STAGE_ENTRIES);
+    trace_begin("scan_file");
+    error = scan_file(file_am_name);
+    trace_end("scan_file");
+    stage_end(STAGE_ENTRIES);
+    tracked_free(file_am_name);
+    if (error) {
+        free_labels();
+        return 1; /* Indicates failure */
+    }
+    return 0;
+}
+
 int second_pass(char *file_name, Data *data_head, Code *code_head, const int *IC, const int *DC) {
-    char *file_ob_name, *file_ent_name, *file_ext_name;
+    char *file_ob_name, *file_ent_name, *file_ext_name, *file_sym_name, *file_dbg_name;
     int error = 0;
 
     char *file_am_name = add_extension(file_name, ".am");
 
-    if (code_operand_labels(file_name, code_head) != 0) {
+    stage_begin(STAGE_FIXUPS);
+    trace_begin("code_operand_labels");
+    error = code_operand_labels(file_name, code_head);
+    trace_end("code_operand_labels");
+    stage_end(STAGE_FIXUPS);
+    if (error != 0) {
         free_labels();
         return 1; /* Indicates failure */
     }
+    report_extern_references();
+    if (relax)
+        printf("Relaxed %d direct branch targets to relative addressing\n", relaxed_count);
 
     /* Scanning the file */
-    if (scan_file(file_am_name)) {
+    stage_begin(STAGE_ENTRIES);
+    trace_begin("scan_file");
+    error = scan_file(file_am_name);
+    trace_end("scan_file");
+    stage_end(STAGE_ENTRIES);
+    if (error) {
         free_labels();
-        free_code_list(&code_head);
-        free_data_list(&data_head);
         delete_file(file_am_name);
-        free(file_am_name);
+        tracked_free(file_am_name);
         return 1; /* Indicates failure */
     }
 
+
     /* Getting the object file label */
+    stage_begin(STAGE_OUTPUT);
     file_ob_name = add_extension(file_name, ".ob");
 
     /* Creating the object file */
+    trace_begin("create_ob_file");
     create_ob_file(file_ob_name, code_head, data_head, IC, DC);
+    trace_end("create_ob_file");
 
     /* Creating "file.ent" if there are "entry" labels */
     if (entry_exist() != 0) {
         file_ent_name = add_extension(file_name, ".ent");
+        trace_begin("create_ent_file");
         create_ent_file(file_ent_name);
-        free(file_ent_name);
+        trace_end("create_ent_file");
+        tracked_free(file_ent_name);
     }
     /* Creating "file.ext" if there are "extern" labels */
     if (extern_exist() != 0) {
         file_ext_name = add_extension(file_name, ".ext");
+        trace_begin("create_ext_file");
         create_ext_file(file_ext_name);
-        free(file_ext_name);
+        trace_end("create_ext_file");
+        tracked_free(file_ext_name);
+    }
+    /* Creating "file.sym" if it was requested */
+    if (symbol_export) {
+        file_sym_name = add_extension(file_name, ".sym");
+        trace_begin("create_sym_file");
+        error = create_sym_file(file_sym_name, IC);
+        trace_end("create_sym_file");
+        tracked_free(file_sym_name);
     }
-    free(file_ob_name);
-    free(file_am_name);
+    /* Creating "file.dbg" if it was requested */
+    if (debug_export && error == 0) {
+        file_dbg_name = add_extension(file_name, ".dbg");
+        trace_begin("create_dbg_file");
+        error = create_dbg_file(file_dbg_name, IC);
+        trace_end("create_dbg_file");
+        tracked_free(file_dbg_name);
+    }
+    tracked_free(file_ob_name);
+    tracked_free(file_am_name);
+    stage_end(STAGE_OUTPUT);
     return error;
 }
 
@@ -121,9 +275,19 @@ int scan_file(char *file_name) {
     char line[MAX_LINE_LENGTH]; /* Buffer for reading lines */
     int line_num = 0; /* Current line number */
     int error = 0; /* Error flag */
+    const char *text = get_expanded_source(); /* NULL if the expansion was written to the .am file */
+    FILE *file;
 
+    if (text != NULL) {
+        /* Reading the expansion in memory line by line */
+        while (read_text_line(&text, line)) {
+            line_num++;
+            process_the_line(line_num, file_name, line, &error, NULL);
+        }
+        return error;
+    }
     /* Opening the file */
-    FILE *file = fopen(file_name, "r");
+    file = fopen(file_name, "r");
     if (!file) {
         printf("Error: can't open %s\n", file_name);
         return 1;
@@ -138,7 +302,7 @@ int scan_file(char *file_name) {
 }
 
 int is_entry(char *file_name, int line_num, char *line, int *error, const char *current_word) {
-    Symbol *symbol;
+    int symbol;
 
     if (get_prompt(current_word) != 2) {
         return 0; /* Scanning line finished */
@@ -161,8 +325,8 @@ int is_entry(char *file_name, int line_num, char *line, int *error, const char *
         return 0; /* Scanning line finished */
     }
     symbol = is_symbol_name(line);
-    if (symbol) {
-        symbol->type = ENTRY; /* Changing the type to "entry" */
+    if (symbol != NO_SYMBOL) {
+        get_symbol_table()->types[symbol] = ENTRY; /* Changing the type to "entry" */
         return 0;
     }
     print_error("Label was declared as \".entry\" but was not defined", file_name, line_num);
@@ -172,7 +336,7 @@ int is_entry(char *file_name, int line_num, char *line, int *error, const char *
 
 /* Function to process each line of the am file */
 void process_the_line(int line_num, char *file_name, char *line, int *error, FILE *file) {
-    char *current_word; /* Pointer to the current first word */
+    char current_word[MAX_LINE_LENGTH]; /* The current first word */
     size_t curr_word_len;
 
     trim_whitespace(line);
@@ -182,34 +346,17 @@ void process_the_line(int line_num, char *file_name, char *line, int *error, FIL
         return; /* Skipping to the next line */
 
     /* Getting the first word */
-    current_word = get_first_word(line);
-    if (current_word == NULL) {
-        /* Indicates memory allocation failed (all the other allocations were freed inside function) */
-        fclose(file);
-        free(file_name);
-        exit(1); /* Exiting program */
-    }
-    curr_word_len = strlen(current_word);
+    curr_word_len = copy_first_word(line, current_word);
 
     /* Checking for a potential symbol definition */
     if (current_word[curr_word_len - 1] == COLON) {
-        free(current_word); /* Freeing memory no longer needed */
         /* Scanning the next word */
         while (*line != NULL_TERMINATOR && !isspace(*line)) /* Skipping the label label */
             line++;
         while (*line != NULL_TERMINATOR && isspace(*line)) /* Setting 'line' to point to the next word */
             line++;
         /* Getting the next word */
-        current_word = get_first_word(line);
-        curr_word_len = strlen(current_word);
-        if (current_word == NULL) {
-            /* Indicates memory allocation failed (all the other allocations were freed inside function) */
-            fclose(file);
-            free(current_word);
-            free_labels();
-            free(file_name);
-            exit(1); /* Exiting program */
-        }
+        curr_word_len = copy_first_word(line, current_word);
     }
 
     /* Checking for a potential prompt definition */
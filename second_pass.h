@@ -16,11 +16,44 @@ int second_pass(char *file_name, Data *data_head, Code *code_head, const int *IC
 
 
 /**
- * @param file_am_name The name of the input file after pre-processing.
+ * Checks the labels of the current file without the code and data lists, for "--check":
+ * reports the operands whose label is not defined and the bad ".entry" lines of the
+ * expanded source, like the second pass, and writes nothing.
+ * @param file_name The name of the input file.
+ * @return 0 if no errors were detected, 1 if errors were detected.
+ */
+int check_labels(char *file_name);
+
+
+/**
+ * Enables rewriting the direct operands of "jmp", "bne" and "jsr" that refer to local labels
+ * as relative operands, which need no relocation.
+ * @param enabled 1 to enable the rewriting, 0 to disable it.
+ */
+void set_branch_relaxation(int enabled);
+
+
+/**
+ * Enables writing the binary symbol file (.sym) at the end of the second pass.
+ * @param enabled 1 to write the file, 0 not to.
+ */
+void set_symbol_export(int enabled);
+
+
+/**
+ * Enables writing the binary debug file (.dbg), which maps every instruction to its
+ * source line, at the end of the second pass.
+ * @param enabled 1 to write the file, 0 not to.
+ */
+void set_debug_export(int enabled);
+
+
+/**
+ * @param file_name The name of the input file, errors are reported at its source lines.
  * @param code_head Array containing the instruction code.
  * @return 0 if no errors were detected, 1 if errors were detected.
  */
-int code_operand_labels(char *file_am_name, Code *code_head);
+int code_operand_labels(char *file_name, Code *code_head);
 
 
 /**
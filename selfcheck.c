@@ -0,0 +1,703 @@
+/**
+ * @file selfcheck.c
+ * @brief Correctness checks of the assembler outputs and of the object-file library.
+ * @details Assembles every corpus file in-process and checks the produced .ob/.ent/.ext
+ *          files against the golden "<name>.v.<ext>" files. The outputs are also read with
+ *          the object-file library and written back, which must reproduce them byte for
+ *          byte, and the binary symbol file must agree with the .ent and .ext files. The
+ *          binary debug file must map every code address to a source line, in source
+ *          order. The outputs of "--trusted" must match the golden files too, and "--check"
+ *          must pass without writing a file. Damaged copies of every .ob file (truncated,
+ *          with a wrong header count, or with a bad digit in a fixed-width line) must be
+ *          rejected, while a line in another layout must be read through the slow path. A
+ *          generated source of instruction lines, with every operand method, must allocate
+ *          as many new blocks in every subsystem as one twice as long when it is checked
+ *          with "--check", so the lines are parsed without allocating, and
+ *          "--dedup" must not merge a block that the code writes or ".entry" names.
+ *          With "--relax", generated branches to local labels must become relative to
+ *          the same targets, while branches to extern labels and the .ext file must not change.
+ *
+ *          Unlike perf_regress, nothing is timed, so no baseline is needed.
+ *
+ *          With "--peephole=NAME", NAME is assembled with "--peephole" and checked against
+ *          its golden files, and every label that an operand or entry names must still be
+ *          an instruction or data. With "--strip=NAME", NAME is assembled with "--strip" and
+ *          checked the same way, and its symbol file must hold exactly the labels of strip.as
+ *          that are reachable.
+ *
+ *          Usage: selfcheck [--peephole=NAME] [--strip=NAME] file_name_1 ... file_name_N
+ */
+#include <stdio.h>
+#include <string.h>
+#include "harness.h"
+#include "assemble.h"
+#include "second_pass.h"
+#include "trusted.h"
+#include "dedup.h"
+#include "peephole.h"
+#include "strip.h"
+#include "decode.h"
+#include "object_file.h"
+#include "util.h"
+#include "alloc.h"
+#include "const.h"
+
+#define PEEPHOLE_OPTION "--peephole=" /* Names a source to check with "--peephole" */
+#define STRIP_OPTION "--strip=" /* Names a source to check with "--strip" */
+#define SOURCE_LINES 200 /* Instruction lines of the shorter generated source */
+#define ADDRESS_FIELD 7 /* Digits of the address of an .ob line */
+
+/* A source with two pairs of repeated blocks, and a written block and an entry block that repeat them */
+static const char *DEDUP_SOURCE = "MAIN: inc C1\nprn C2\nprn C3\nprn E1\nprn R1\nprn R2\nstop\n"
+                                  "C1: .data 7\nC2: .data 7\nC3: .data 7\nE1: .data 7\nR1: .data 9\nR2: .data 9\n"
+                                  ".entry E1\n";
+#define DEDUP_DATA_WORDS 4 /* C3 and R2 are merged, C1 and E1 keep their words */
+
+/* Branches to local labels before and after them, and to an extern label */
+static const char *RELAX_SOURCE = ".extern EX\nMAIN: jmp NEXT\nNEXT: bne BACK\njsr EX\nBACK: jsr NEXT\nbne EX\n"
+                                  "jmp EX\njsr FAR\nstop\nFAR: rts\n";
+#define RELAX_LOCALS 4 /* Branches that become relative */
+#define RELAX_EXTERNS 3 /* Branches that stay direct */
+
+/* Labels of the corpus file strip.as that "--strip" removes, and the ones it keeps */
+static const char *STRIP_REMOVED[] = {"DEAD", "N2", "UNUSED"};
+#define STRIP_REMOVED_COUNT (sizeof(STRIP_REMOVED) / sizeof(STRIP_REMOVED[0]))
+static const char *STRIP_KEPT[] = {"MAIN", "F", "L", "API", "N1", "N3"};
+#define STRIP_KEPT_COUNT (sizeof(STRIP_KEPT) / sizeof(STRIP_KEPT[0]))
+
+/* Instruction lines that the generated sources repeat, with every operand method and spacing */
+static const char *INSTRUCTION_LINES[] = {"mov r1, r2", "add #5,r3", "cmp X , #-3", "sub\tX,\tr6", "lea X ,r5",
+                                          "jmp &MAIN", "bne MAIN", "prn #7", "inc X", "clr r0", "not r7", "rts"};
+#define INSTRUCTION_LINES_COUNT (sizeof(INSTRUCTION_LINES) / sizeof(INSTRUCTION_LINES[0]))
+
+/* Reads the outputs of a file with the object-file library and writes them back, returns the number of mismatches */
+static int check_round_trip(char *name) {
+    Object_Module module;
+    char *output_name, *copy_name, *copy_base = add_extension(name, ".rt");
+    int i, mismatches = 0;
+
+    if (load_object_module(name, &module) != 0 || write_object_module(copy_base, &module) != 0) {
+        printf("MISMATCH: %s could not be read back\n", name);
+        mismatches++;
+    }
+    for (i = 0; mismatches == 0 && i < OUTPUT_EXTENSIONS_COUNT; i++) {
+        output_name = add_extension(name, (char *) OUTPUT_EXTENSIONS[i]);
+        copy_name = add_extension(copy_base, (char *) OUTPUT_EXTENSIONS[i]);
+        if (!same_bytes(output_name, copy_name)) {
+            printf("MISMATCH: %s changed when read and written back\n", output_name);
+            mismatches++;
+        }
+        remove(copy_name);
+        tracked_free(output_name);
+        tracked_free(copy_name);
+    }
+    free_object_module(&module);
+    tracked_free(copy_base);
+    return mismatches;
+}
+
+/* Checks the symbol file of a file against its .ent and .ext files, returns the number of mismatches */
+static int check_symbol_file(char *name) {
+    Object_Module module;
+    Symbol_File file;
+    Symbol_File_Entry entry;
+    char *sym_name = add_extension(name, ".sym");
+    int i, status, mismatches = 0;
+
+    set_symbol_export(1);
+    status = assemble_quietly(name);
+    set_symbol_export(0);
+    memset(&module, 0, sizeof(Object_Module));
+    if (status != 0 || open_symbol_file(name, &file) != 0) {
+        printf("MISMATCH: %s was not written\n", sym_name);
+        tracked_free(sym_name);
+        return 1;
+    }
+    if (load_object_symbols(name, &module) != 0)
+        mismatches++;
+    /* Every entry is found through the index */
+    for (i = 0; i < module.entries_count; i++)
+        if (!find_symbol_file_entry(&file, module.entries[i].name, &entry) ||
+            entry.address != module.entries[i].address || !(entry.type & SYMBOL_ENTRY)) {
+            printf("MISMATCH: %s has a wrong entry \"%s\"\n", sym_name, module.entries[i].name);
+            mismatches++;
+        }
+    /* The extern uses are stored in the order of the .ext file */
+    if (file.references_count != (unsigned long) module.externs_count) {
+        printf("MISMATCH: %s has %lu extern uses instead of %d\n", sym_name, file.references_count,
+               module.externs_count);
+        mismatches++;
+    }
+    for (i = 0; mismatches == 0 && i < module.externs_count; i++)
+        if (!get_symbol_file_reference(&file, (unsigned long) i, &entry) ||
+            strcmp(entry.name, module.externs[i].name) != 0 || entry.address != module.externs[i].address) {
+            printf("MISMATCH: %s has a wrong use of \"%s\"\n", sym_name, module.externs[i].name);
+            mismatches++;
+        }
+    close_symbol_file(&file);
+    free_object_module(&module);
+    remove(sym_name);
+    tracked_free(sym_name);
+    return mismatches;
+}
+
+/* Counts the lines of a file, returns -1 if it can't be opened */
+static int count_lines(const char *file_name) {
+    char line[MAX_LINE_LENGTH];
+    FILE *file = fopen(file_name, "r");
+    int lines = 0;
+
+    if (file == NULL)
+        return -1;
+    while (fgets(line, MAX_LINE_LENGTH, file))
+        lines++;
+    fclose(file);
+    return lines;
+}
+
+/* Checks that the debug file maps every code address to a line of the source, returns the number of mismatches */
+static int check_debug_file(char *name) {
+    Debug_File file;
+    Debug_Line line;
+    char *dbg_name = add_extension(name, ".dbg"), *source_name = add_extension(name, ".as");
+    int address, status, previous = 1, lines = count_lines(source_name), mismatches = 0;
+
+    set_debug_export(1);
+    status = assemble_quietly(name);
+    set_debug_export(0);
+    if (status != 0 || open_debug_file(name, &file) != 0) {
+        printf("MISMATCH: %s was not written\n", dbg_name);
+        tracked_free(dbg_name);
+        tracked_free(source_name);
+        return 1;
+    }
+    /* The code follows the source, a macro body is defined before its calls */
+    for (address = IC_INITIAL; mismatches == 0 && address < file.code_end; address++) {
+        if (!find_debug_line(&file, address, &line) || line.address > address || line.line < previous ||
+            line.line > lines || (line.macro != NULL && (line.macro_line <= 0 || line.macro_line >= line.line))) {
+            printf("MISMATCH: %s has a wrong line for address %07d\n", dbg_name, address);
+            mismatches++;
+        }
+        previous = line.line;
+    }
+    close_debug_file(&file);
+    remove(dbg_name);
+    tracked_free(dbg_name);
+    tracked_free(source_name);
+    return mismatches;
+}
+
+/* Assembles a file through the fast path of "--trusted" and checks the outputs, returns the number of mismatches */
+static int check_trusted(char *name) {
+    int status;
+
+    set_trusted(1);
+    status = assemble_quietly(name);
+    set_trusted(0);
+    if (status != 0) {
+        printf("MISMATCH: %s failed with --trusted\n", name);
+        return 1;
+    }
+    return check_golden(name);
+}
+
+/* Checks a file with "--check", which must succeed without writing a file, returns the number of mismatches */
+static int check_only(char *name) {
+    const char *extensions[] = {".am", ".ob", ".ent", ".ext"};
+    char *output_name;
+    FILE *file;
+    int i, status, mismatches = 0;
+
+    for (i = 0; i < (int) (sizeof(extensions) / sizeof(extensions[0])); i++) {
+        output_name = add_extension(name, (char *) extensions[i]);
+        remove(output_name);
+        tracked_free(output_name);
+    }
+    set_check_only(1);
+    status = assemble_quietly(name);
+    set_check_only(0);
+    if (status != 0) {
+        printf("MISMATCH: %s failed with --check\n", name);
+        mismatches++;
+    }
+    for (i = 0; i < (int) (sizeof(extensions) / sizeof(extensions[0])); i++) {
+        output_name = add_extension(name, (char *) extensions[i]);
+        if ((file = fopen(output_name, "r")) != NULL) {
+            printf("MISMATCH: %s was written with --check\n", output_name);
+            fclose(file);
+            mismatches++;
+        }
+        tracked_free(output_name);
+    }
+    assemble_quietly(name); /* Writing the outputs again */
+    return mismatches;
+}
+
+/* Reads a whole file into a new buffer, returns NULL if it can't be read */
+static char *read_whole_file(const char *file_name, long *size) {
+    FILE *file = fopen(file_name, "r");
+    char *text;
+
+    if (file == NULL)
+        return NULL;
+    fseek(file, 0, SEEK_END);
+    *size = ftell(file);
+    rewind(file);
+    text = tracked_malloc(*size + 1, MEM_TEMP);
+    if (text != NULL && (long) fread(text, 1, *size, file) != *size) {
+        tracked_free(text);
+        text = NULL;
+    }
+    fclose(file);
+    if (text != NULL)
+        text[*size] = NULL_TERMINATOR;
+    return text;
+}
+
+/* Writes a copy of a text with "removed" characters at "at" replaced by "inserted", returns 0 on success */
+static int write_variant(const char *file_name, const char *text, long size, long at, long removed,
+                         const char *inserted) {
+    FILE *file = fopen(file_name, "w");
+
+    if (file == NULL)
+        return 1;
+    fwrite(text, 1, at, file);
+    fputs(inserted, file);
+    fwrite(text + at + removed, 1, size - at - removed, file);
+    fclose(file);
+    return 0;
+}
+
+/* Loads a damaged .ob file, which must fail, or a relaid one, which must give the original words */
+static int check_variant(char *variant_base, const Object_Module *original, int valid, const char *damage) {
+    Object_Module module;
+    int saved = silence_stdout(); /* The rejected files print their errors */
+    int status = load_object_module(variant_base, &module);
+
+    restore_stdout(saved);
+    if (status == 0 && !valid) {
+        printf("MISMATCH: %s.ob was accepted with %s\n", original->name, damage);
+        free_object_module(&module);
+        return 1;
+    }
+    if (status != 0 && valid) {
+        printf("MISMATCH: %s.ob was rejected with %s\n", original->name, damage);
+        return 1;
+    }
+    if (valid && (module.code_length != original->code_length || module.data_length != original->data_length ||
+                  memcmp(module.words, original->words,
+                         (original->code_length + original->data_length) * sizeof(unsigned int)) != 0)) {
+        printf("MISMATCH: %s.ob was read differently with %s\n", original->name, damage);
+        status = 1;
+    }
+    if (valid)
+        free_object_module(&module);
+    return valid && status != 0;
+}
+
+/* Checks that damaged copies of an .ob file are rejected, returns the number of mismatches */
+static int check_malformed_object(char *name) {
+    Object_Module original;
+    char *ob_name = add_extension(name, ".ob"), *variant_base = add_extension(name, ".bad");
+    char *variant_name = add_extension(variant_base, ".ob");
+    char header[MAX_LINE_LENGTH], *text;
+    long size, body, last_space;
+    int mismatches = 0;
+
+    text = read_whole_file(ob_name, &size);
+    if (text == NULL || load_object_module(name, &original) != 0) {
+        printf("MISMATCH: %s could not be read\n", ob_name);
+        mismatches++;
+    } else if (original.code_length + original.data_length > 0) {
+        body = (long) (strchr(text, '\n') + 1 - text); /* The first "address word" line */
+        last_space = (long) (strrchr(text, ' ') - text);
+        /* The last line is cut after its address */
+        write_variant(variant_name, text, last_space + 1, last_space + 1, 0, "");
+        mismatches += check_variant(variant_base, &original, 0, "a truncated last line");
+        /* The header declares one word less, then one word more */
+        if (original.data_length > 0)
+            sprintf(header, "%d %d\n", original.code_length, original.data_length - 1);
+        else
+            sprintf(header, "%d %d\n", original.code_length - 1, original.data_length);
+        write_variant(variant_name, text, size, 0, body, header);
+        mismatches += check_variant(variant_base, &original, 0, "one word less in the header");
+        sprintf(header, "%d %d\n", original.code_length, original.data_length + 1);
+        write_variant(variant_name, text, size, 0, body, header);
+        mismatches += check_variant(variant_base, &original, 0, "one word more in the header");
+        /* Bad digits in the fixed-width fields of the first line */
+        write_variant(variant_name, text, size, body + ADDRESS_FIELD - 2, 1, "a");
+        mismatches += check_variant(variant_base, &original, 0, "a hex digit in an address");
+        write_variant(variant_name, text, size, body + ADDRESS_FIELD + 2, 1, "g");
+        mismatches += check_variant(variant_base, &original, 0, "a non-hex digit in a word");
+        /* A line that is not fixed-width is read by the slow path */
+        write_variant(variant_name, text, size, body + ADDRESS_FIELD, 0, " ");
+        mismatches += check_variant(variant_base, &original, 1, "a line of another layout");
+        free_object_module(&original);
+    }
+    remove(variant_name);
+    tracked_free(text);
+    tracked_free(ob_name);
+    tracked_free(variant_name);
+    tracked_free(variant_base);
+    return mismatches;
+}
+
+/* Writes a source of the given number of instruction lines, returns 0 on success */
+static int write_instruction_source(char *name, int lines) {
+    char *source_name = add_extension(name, ".as");
+    FILE *file = fopen(source_name, "w");
+    int i;
+
+    tracked_free(source_name);
+    if (file == NULL)
+        return 1;
+    fprintf(file, "MAIN: stop\n");
+    for (i = 0; i < lines; i++)
+        fprintf(file, "%s\n", INSTRUCTION_LINES[i % INSTRUCTION_LINES_COUNT]);
+    fprintf(file, "X: .data 1\n");
+    fclose(file);
+    return 0;
+}
+
+/* Checks a generated source with "--check" and gets the new blocks of every subsystem, returns 0 on success */
+static int count_new_blocks(char *name, int lines, long *blocks) {
+    int tag, status;
+
+    if (write_instruction_source(name, lines) != 0)
+        return 1;
+    set_check_only(1);
+    status = assemble_quietly(name);
+    set_check_only(0);
+    /* A realloc that grows a table is not new, the tables double so they grow a few times per file */
+    for (tag = 0; tag < MEM_TAGS_COUNT; tag++)
+        blocks[tag] = get_mem_usage((Mem_Tag) tag)->allocations - get_mem_usage((Mem_Tag) tag)->reallocations;
+    return status;
+}
+
+/* Checks that an instruction line allocates no new block in any subsystem, returns the number of mismatches */
+static int check_line_allocations(char *first_file) {
+    char *name = add_extension(first_file, ".lines");
+    char *output_name;
+    long shorter[MEM_TAGS_COUNT], longer[MEM_TAGS_COUNT];
+    const char *extensions[] = {".as", ".am", ".ob"};
+    int i, mismatches = 0;
+
+    /* With "--check" no code image is built, the normal passes allocate a code node for every word by design */
+    if (count_new_blocks(name, SOURCE_LINES, shorter) != 0 || count_new_blocks(name, 2 * SOURCE_LINES, longer) != 0) {
+        printf("MISMATCH: the generated source of instruction lines was rejected\n");
+        mismatches++;
+    }
+    /* Twice the lines must not allocate a single block more */
+    for (i = 0; mismatches == 0 && i < MEM_TAGS_COUNT; i++)
+        if (longer[i] != shorter[i]) {
+            printf("MISMATCH: %d instruction lines allocated %ld new blocks (%s), %d lines allocated %ld\n",
+                   SOURCE_LINES, shorter[i], MEM_TAG_NAMES[i], 2 * SOURCE_LINES, longer[i]);
+            mismatches++;
+        }
+    for (i = 0; i < (int) (sizeof(extensions) / sizeof(extensions[0])); i++) {
+        output_name = add_extension(name, (char *) extensions[i]);
+        remove(output_name);
+        tracked_free(output_name);
+    }
+    tracked_free(name);
+    return mismatches;
+}
+
+/* Writes a generated source, returns 0 on success */
+static int write_source(char *name, const char *text) {
+    char *source_name = add_extension(name, ".as");
+    FILE *file = fopen(source_name, "w");
+
+    tracked_free(source_name);
+    if (file == NULL)
+        return 1;
+    fputs(text, file);
+    fclose(file);
+    return 0;
+}
+
+/* Removes a generated source and the files that the assembler wrote for it */
+static void remove_outputs(char *name) {
+    const char *extensions[] = {".as", ".am", ".ob", ".ent", ".ext"};
+    char *output_name;
+    int i;
+
+    for (i = 0; i < (int) (sizeof(extensions) / sizeof(extensions[0])); i++) {
+        output_name = add_extension(name, (char *) extensions[i]);
+        remove(output_name);
+        tracked_free(output_name);
+    }
+}
+
+/* Checks that "--dedup" merges only the blocks that no instruction writes and ".entry" does not name */
+static int check_dedup(char *first_file) {
+    Object_Module module;
+    char *name = add_extension(first_file, ".dedup");
+    int status = 1, mismatches = 0;
+
+    if (write_source(name, DEDUP_SOURCE) == 0) {
+        set_dedup(1);
+        status = assemble_quietly(name);
+        set_dedup(0);
+    }
+    if (status != 0 || load_object_module(name, &module) != 0) {
+        printf("MISMATCH: %s.as could not be assembled with --dedup\n", name);
+        mismatches++;
+    } else {
+        if (module.data_length != DEDUP_DATA_WORDS) {
+            printf("MISMATCH: --dedup left %d data words of %s.as instead of %d\n", module.data_length, name,
+                   DEDUP_DATA_WORDS);
+            mismatches++;
+        }
+        free_object_module(&module);
+    }
+    remove_outputs(name);
+    tracked_free(name);
+    return mismatches;
+}
+
+/* Checks if an instruction is a branch that "--relax" may rewrite */
+static int is_branch(int id) {
+    const char *name = INSTRUCTIONS[id].instruction;
+    return strcmp(name, "jmp") == 0 || strcmp(name, "bne") == 0 || strcmp(name, "jsr") == 0;
+}
+
+/* Compares the code of a source assembled with and without "--relax", returns the number of mismatches */
+static int compare_relaxed(const Object_Module *plain, const Object_Module *relaxed) {
+    Decoded_Instruction before, after;
+    int i, locals = 0, externs = 0, mismatches = 0, address;
+
+    if (plain->code_length != relaxed->code_length || plain->data_length != relaxed->data_length) {
+        printf("MISMATCH: --relax changed the size of %s.ob\n", plain->name);
+        return 1;
+    }
+    for (i = 0; mismatches == 0 && i < plain->code_length; i += before.length) {
+        address = IC_INITIAL + i;
+        if (decode_instruction(plain->words + i, plain->code_length - i, address, &before) != 0 ||
+            decode_instruction(relaxed->words + i, relaxed->code_length - i, address, &after) != 0 ||
+            before.id != after.id || before.length != after.length) {
+            printf("MISMATCH: --relax changed the instruction at %07d of %s.ob\n", address, plain->name);
+            return 1;
+        }
+        if (!is_branch(before.id) || before.destination.method != DIRECT) {
+            mismatches += memcmp(plain->words + i, relaxed->words + i, before.length * sizeof(unsigned int)) != 0;
+        } else if (before.destination.are == BIT_MASK_EXTERNAL) {
+            /* An extern target is only known to the linker */
+            mismatches += after.destination.method != DIRECT ||
+                          memcmp(plain->words + i, relaxed->words + i, before.length * sizeof(unsigned int)) != 0;
+            externs++;
+        } else {
+            /* The relative operand holds the displacement from the branch to the same target */
+            mismatches += after.destination.method != RELATIVE || after.destination.value != before.destination.value;
+            locals++;
+        }
+        if (mismatches)
+            printf("MISMATCH: --relax encoded the instruction at %07d of %s.ob wrongly\n", address, plain->name);
+    }
+    if (mismatches == 0 && (locals != RELAX_LOCALS || externs != RELAX_EXTERNS)) {
+        printf("MISMATCH: --relax found %d local and %d extern branches in %s.ob instead of %d and %d\n", locals,
+               externs, plain->name, RELAX_LOCALS, RELAX_EXTERNS);
+        mismatches++;
+    }
+    return mismatches;
+}
+
+/* Checks that "--relax" makes local branches relative and keeps extern ones, returns the number of mismatches */
+static int check_relax(char *first_file) {
+    Object_Module plain, relaxed;
+    char *name = add_extension(first_file, ".relax");
+    char *ext_name = add_extension(name, ".ext"), *plain_ext_name = add_extension(name, ".plain.ext");
+    int mismatches = 0;
+
+    if (write_source(name, RELAX_SOURCE) != 0 || assemble_quietly(name) != 0 || load_object_module(name, &plain) != 0) {
+        printf("MISMATCH: %s.as could not be assembled\n", name);
+        mismatches++;
+    } else {
+        rename(ext_name, plain_ext_name);
+        set_branch_relaxation(1);
+        if (assemble_quietly(name) != 0 || load_object_module(name, &relaxed) != 0) {
+            printf("MISMATCH: %s.as could not be assembled with --relax\n", name);
+            mismatches++;
+        } else {
+            mismatches += compare_relaxed(&plain, &relaxed);
+            free_object_module(&relaxed);
+        }
+        set_branch_relaxation(0);
+        if (mismatches == 0 && !same_bytes(ext_name, plain_ext_name)) {
+            printf("MISMATCH: --relax changed %s\n", ext_name);
+            mismatches++;
+        }
+        free_object_module(&plain);
+    }
+    remove(plain_ext_name);
+    remove_outputs(name);
+    tracked_free(ext_name);
+    tracked_free(plain_ext_name);
+    tracked_free(name);
+    return mismatches;
+}
+
+/* Checks if an address is the first word of an instruction or a data word of a module */
+static int is_target(const Object_Module *module, const char *starts, int address) {
+    int offset = address - IC_INITIAL;
+
+    if (offset < 0 || offset >= module->code_length + module->data_length)
+        return 0;
+    return offset >= module->code_length || starts[offset];
+}
+
+/* Checks if an operand names a local label that is neither an instruction nor data */
+static int misses_target(const Object_Module *module, const char *starts, const Decoded_Operand *operand) {
+    if (!operand->present || (operand->method != RELATIVE &&
+                              (operand->method != DIRECT || operand->are != BIT_MASK_RELOCATABLE)))
+        return 0;
+    return !is_target(module, starts, operand->value);
+}
+
+/* Checks that the operands and entries name instructions or data, returns the number of mismatches */
+static int check_label_targets(char *name) {
+    Object_Module module;
+    Decoded_Instruction instruction;
+    char *starts;
+    int i, mismatches = 0;
+
+    if (load_object_module(name, &module) != 0) {
+        printf("MISMATCH: %s.ob could not be loaded\n", name);
+        return 1;
+    }
+    starts = tracked_malloc(module.code_length + 1, MEM_TEMP);
+    if (starts == NULL) {
+        printf("Error: Memory allocation failed\n");
+        free_object_module(&module);
+        return 1;
+    }
+    memset(starts, 0, module.code_length + 1);
+    for (i = 0; i < module.code_length; i += instruction.length) {
+        if (decode_instruction(module.words + i, module.code_length - i, IC_INITIAL + i, &instruction) != 0) {
+            printf("MISMATCH: %s.ob has no instruction at %07d\n", name, IC_INITIAL + i);
+            mismatches++;
+            break;
+        }
+        starts[i] = 1;
+    }
+    for (i = 0; mismatches == 0 && i < module.code_length; i += instruction.length) {
+        decode_instruction(module.words + i, module.code_length - i, IC_INITIAL + i, &instruction);
+        if (misses_target(&module, starts, &instruction.source) ||
+            misses_target(&module, starts, &instruction.destination)) {
+            printf("MISMATCH: %s.ob names a label outside the instructions and data at %07d\n", name, IC_INITIAL + i);
+            mismatches++;
+        }
+    }
+    for (i = 0; i < module.entries_count; i++)
+        if (!is_target(&module, starts, module.entries[i].address)) {
+            printf("MISMATCH: %s.ent places %s at %07d\n", name, module.entries[i].name, module.entries[i].address);
+            mismatches++;
+        }
+    tracked_free(starts);
+    free_object_module(&module);
+    return mismatches;
+}
+
+/* Checks a source assembled with "--peephole" against its golden files, returns the number of mismatches */
+static int check_peephole(char *name) {
+    int status;
+
+    set_peephole(1);
+    status = assemble_quietly(name);
+    set_peephole(0);
+    if (status != 0) {
+        printf("MISMATCH: %s.as could not be assembled with --peephole\n", name);
+        return 1;
+    }
+    return check_golden(name) + check_label_targets(name);
+}
+
+/* Checks which labels are left in the symbol file of a stripped source, returns the number of mismatches */
+static int check_stripped_labels(char *name) {
+    Symbol_File file;
+    Symbol_File_Entry entry;
+    int i, mismatches = 0;
+
+    if (open_symbol_file(name, &file) != 0) {
+        printf("MISMATCH: %s.sym was not written\n", name);
+        return 1;
+    }
+    for (i = 0; i < STRIP_REMOVED_COUNT; i++)
+        if (find_symbol_file_entry(&file, STRIP_REMOVED[i], &entry)) {
+            printf("MISMATCH: --strip kept the label \"%s\" of %s.as\n", STRIP_REMOVED[i], name);
+            mismatches++;
+        }
+    for (i = 0; i < STRIP_KEPT_COUNT; i++)
+        if (!find_symbol_file_entry(&file, STRIP_KEPT[i], &entry)) {
+            printf("MISMATCH: --strip removed the label \"%s\" of %s.as\n", STRIP_KEPT[i], name);
+            mismatches++;
+        }
+    close_symbol_file(&file);
+    return mismatches;
+}
+
+/* Checks a source assembled with "--strip" against its golden files, returns the number of mismatches */
+static int check_strip(char *name) {
+    char *sym_name;
+    int status, mismatches;
+
+    set_strip(1);
+    set_symbol_export(1);
+    status = assemble_quietly(name);
+    set_symbol_export(0);
+    set_strip(0);
+    if (status != 0) {
+        printf("MISMATCH: %s.as could not be assembled with --strip\n", name);
+        return 1;
+    }
+    mismatches = check_golden(name) + check_label_targets(name) + check_stripped_labels(name);
+    sym_name = add_extension(name, ".sym");
+    remove(sym_name);
+    tracked_free(sym_name);
+    return mismatches;
+}
+
+/**
+ * @brief Assembles the files and runs the correctness checks on their outputs.
+ * @param argc The number of command-line arguments.
+ * @param argv An array of command-line arguments.
+ * @return 0 if all the checks pass, 1 otherwise.
+ */
+int main(int argc, char *argv[]) {
+    char *peephole_file = NULL, *strip_file = NULL;
+    int i, first, failures = 0;
+
+    for (first = 1; first < argc && strncmp(argv[first], "--", 2) == 0; first++) {
+        if (strncmp(argv[first], PEEPHOLE_OPTION, strlen(PEEPHOLE_OPTION)) == 0) {
+            peephole_file = argv[first] + strlen(PEEPHOLE_OPTION);
+        } else if (strncmp(argv[first], STRIP_OPTION, strlen(STRIP_OPTION)) == 0) {
+            strip_file = argv[first] + strlen(STRIP_OPTION);
+        } else {
+            printf("Error: Unknown option %s\n", argv[first]);
+            return 1;
+        }
+    }
+    if (first >= argc) {
+        printf("Error: No files entered\n");
+        return 1;
+    }
+    for (i = first; i < argc; i++) {
+        if (assemble_quietly(argv[i]) != 0) {
+            assemble_file(argv[i]); /* Shows why the file failed */
+            printf("FAILED: %s does not assemble\n", argv[i]);
+            failures++;
+            continue;
+        }
+        failures += check_golden(argv[i]) + check_round_trip(argv[i]) + check_symbol_file(argv[i]) +
+                    check_debug_file(argv[i]) + check_trusted(argv[i]) + check_malformed_object(argv[i]);
+        failures += check_only(argv[i]); /* Removes the outputs, so it runs after the checks that read them */
+    }
+    /* The generated sources are written next to the first file */
+    failures += check_line_allocations(argv[first]) + check_dedup(argv[first]) + check_relax(argv[first]);
+    if (peephole_file != NULL)
+        failures += check_peephole(peephole_file);
+    if (strip_file != NULL)
+        failures += check_strip(strip_file);
+    printf("\n%d mismatches\n", failures);
+    return failures != 0;
+}
@@ -0,0 +1,368 @@
+/**
+ * @file simulator.c
+ * @brief Instruction-set simulator of the target machine.
+ * @details Loads an .ob image (a single module or the output of the linker) at
+ *          IC_INITIAL and runs it from its first word until "stop". The machine has
+ *          the 8 registers of REGISTERS, a zero flag set by "cmp" and a return-address
+ *          stack used by "jsr" and "rts". "prn" prints a decimal number and "red" reads
+ *          one character from the standard input.
+ *
+ *          Every word of the image has a decode-cache entry. An instruction is decoded the
+ *          first time it runs: its operands are resolved to pointers into the registers,
+ *          the memory or the entry itself (for immediates), and its handler is taken from a
+ *          table in the order of INSTRUCTIONS. Later runs only call the handler. A store to
+ *          memory invalidates the entries of the instructions that may contain the word.
+ *          The instruction counts are reported to stderr at exit. When the program has a
+ *          .dbg file, a run that ends with an error or after --max-steps also shows the
+ *          line of the .as file of the last instruction.
+ *
+ *          Usage: simulator [--max-steps=N] program
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "object_file.h"
+#include "decode.h"
+#include "const.h"
+
+#define STACK_SIZE 65536
+#define MAX_INSTRUCTION_LENGTH 3
+#define HALT_STOP (-1)
+#define HALT_ERROR (-2)
+
+typedef struct Cached_Instruction Cached_Instruction;
+
+/* Executes a decoded instruction and returns the next address, or a negative halt code */
+typedef int (*Handler)(Cached_Instruction *instruction, int pc);
+
+/* A decode-cache entry */
+struct Cached_Instruction {
+    Handler handler; /* decode_and_run until the instruction is decoded */
+    int *source;
+    int *destination;
+    int source_value; /* Storage of an immediate source, or of the address loaded by "lea" */
+    int destination_value; /* Storage of an immediate destination */
+    int written; /* Memory address written through the destination, -1 for a register */
+    int target; /* Jump target */
+    int length;
+    int id; /* Index of the instruction in INSTRUCTIONS */
+    unsigned long executed; /* Executions since the entry was decoded */
+};
+
+static int registers[REGISTERS_COUNT];
+static int zero_flag = 0;
+static int stack[STACK_SIZE];
+static int stack_top = 0;
+static int *memory; /* CAPACITY sign-extended words */
+static int image_end; /* First address after the loaded image */
+static Cached_Instruction *cache; /* One entry per address up to image_end, and a sentinel */
+static unsigned long counts[INSTRUCTIONS_COUNT]; /* Executions of invalidated entries */
+static Debug_File debug; /* The source lines of the instructions, empty without a .dbg file */
+
+/* Wraps a value to a signed word */
+static int wrap(int value) {
+    return (int) ((((unsigned int) value & MASK_WORD) ^ SIGN_WORD)) - SIGN_WORD;
+}
+
+static int decode_and_run(Cached_Instruction *instruction, int pc);
+
+/* Drops the decoded instructions that may contain a stored word */
+static void invalidate(int address) {
+    int i;
+
+    for (i = address; i > address - MAX_INSTRUCTION_LENGTH; i--) {
+        if (i < IC_INITIAL || i >= image_end || cache[i].handler == decode_and_run)
+            continue;
+        counts[cache[i].id] += cache[i].executed;
+        cache[i].executed = 0;
+        cache[i].handler = decode_and_run;
+    }
+}
+
+/* Writes the destination of an instruction, invalidating the cache if memory was written */
+static void store(const Cached_Instruction *instruction, int value) {
+    *instruction->destination = wrap(value);
+    if (instruction->written >= 0)
+        invalidate(instruction->written);
+}
+
+/* Instruction handlers, in the order of INSTRUCTIONS */
+static int run_mov(Cached_Instruction *c, int pc) {
+    store(c, *c->source);
+    return pc + c->length;
+}
+
+static int run_cmp(Cached_Instruction *c, int pc) {
+    zero_flag = wrap(*c->source - *c->destination) == 0;
+    return pc + c->length;
+}
+
+static int run_add(Cached_Instruction *c, int pc) {
+    store(c, *c->destination + *c->source);
+    return pc + c->length;
+}
+
+static int run_sub(Cached_Instruction *c, int pc) {
+    store(c, *c->destination - *c->source);
+    return pc + c->length;
+}
+
+static int run_clr(Cached_Instruction *c, int pc) {
+    store(c, 0);
+    return pc + c->length;
+}
+
+static int run_not(Cached_Instruction *c, int pc) {
+    store(c, ~*c->destination);
+    return pc + c->length;
+}
+
+static int run_inc(Cached_Instruction *c, int pc) {
+    store(c, *c->destination + 1);
+    return pc + c->length;
+}
+
+static int run_dec(Cached_Instruction *c, int pc) {
+    store(c, *c->destination - 1);
+    return pc + c->length;
+}
+
+static int run_jmp(Cached_Instruction *c, int pc) {
+    return c->target;
+}
+
+static int run_bne(Cached_Instruction *c, int pc) {
+    return zero_flag ? pc + c->length : c->target;
+}
+
+static int run_jsr(Cached_Instruction *c, int pc) {
+    if (stack_top == STACK_SIZE) {
+        printf("Error: stack overflow at address %07d\n", pc);
+        return HALT_ERROR;
+    }
+    stack[stack_top++] = pc + c->length;
+    return c->target;
+}
+
+static int run_red(Cached_Instruction *c, int pc) {
+    int ch = getchar();
+    store(c, ch == EOF ? -1 : ch);
+    return pc + c->length;
+}
+
+static int run_prn(Cached_Instruction *c, int pc) {
+    printf("%d\n", *c->destination);
+    return pc + c->length;
+}
+
+static int run_rts(Cached_Instruction *c, int pc) {
+    if (stack_top == 0) {
+        printf("Error: return with an empty stack at address %07d\n", pc);
+        return HALT_ERROR;
+    }
+    return stack[--stack_top];
+}
+
+static int run_stop(Cached_Instruction *c, int pc) {
+    return HALT_STOP;
+}
+
+/* The handlers follow the 16 instructions of default.isa, a spec with other instructions needs its own */
+#if INSTRUCTIONS_COUNT != 16
+#error "HANDLERS implements the 16 instructions of default.isa only"
+#endif
+static const Handler HANDLERS[INSTRUCTIONS_COUNT] = {
+    run_mov, run_cmp, run_add, run_sub, run_mov /* lea loads the address as an immediate */, run_clr, run_not,
+    run_inc, run_dec, run_jmp, run_bne, run_jsr, run_red, run_prn, run_rts, run_stop
+};
+
+/* Handler of the addresses outside of the image */
+static int run_outside(Cached_Instruction *c, int pc) {
+    printf("Error: execution reached address %07d outside of the program\n", pc);
+    return HALT_ERROR;
+}
+
+/* Resolves an operand to the location it reads and writes, returns 1 on error */
+static int resolve_operand(const Decoded_Operand *operand, int pc, int *storage, int **location, int *written) {
+    *written = -1;
+    switch (operand->method) {
+        case IMMEDIATE:
+            *storage = operand->value;
+            *location = storage;
+            return 0;
+        case DIRECT_REGISTER:
+            *location = &registers[operand->reg];
+            return 0;
+        default:
+            if (operand->are == BIT_MASK_EXTERNAL) {
+                printf("Error: unresolved extern used at address %07d\n", pc);
+                return 1;
+            }
+            if (operand->value < 0 || operand->value >= CAPACITY) {
+                printf("Error: address %d used at address %07d is outside of the memory\n", operand->value, pc);
+                return 1;
+            }
+            *location = &memory[operand->value];
+            *written = operand->value;
+            return 0;
+    }
+}
+
+/* Decodes the instruction at an address into its cache entry, then runs it */
+static int decode_and_run(Cached_Instruction *c, int pc) {
+    unsigned int words[MAX_INSTRUCTION_LENGTH];
+    Decoded_Instruction decoded;
+    int i, available = image_end - pc < MAX_INSTRUCTION_LENGTH ? image_end - pc : MAX_INSTRUCTION_LENGTH;
+
+    for (i = 0; i < available; i++)
+        words[i] = (unsigned int) memory[pc + i] & MASK_WORD;
+    if (decode_instruction(words, available, pc, &decoded)) {
+        printf("Error: illegal instruction %0*x at address %07d\n", WORD_DIGITS, words[0], pc);
+        return HALT_ERROR;
+    }
+    c->id = decoded.id;
+    c->length = decoded.length;
+    c->source = NULL;
+    c->destination = NULL;
+    c->written = -1;
+    c->target = 0;
+    if (decoded.source.present && resolve_operand(&decoded.source, pc, &c->source_value, &c->source, &i))
+        return HALT_ERROR;
+    if (decoded.destination.present) {
+        if (decoded.destination.are == BIT_MASK_EXTERNAL) {
+            printf("Error: unresolved extern used at address %07d\n", pc);
+            return HALT_ERROR;
+        }
+        if (HANDLERS[c->id] == run_jmp || HANDLERS[c->id] == run_bne || HANDLERS[c->id] == run_jsr) {
+            c->target = decoded.destination.value;
+            if (c->target < IC_INITIAL || c->target >= image_end) {
+                printf("Error: jump to address %d at address %07d is outside of the program\n", c->target, pc);
+                return HALT_ERROR;
+            }
+        } else if (resolve_operand(&decoded.destination, pc, &c->destination_value, &c->destination,
+                                   &c->written)) {
+            return HALT_ERROR;
+        }
+    }
+    if (INSTRUCTIONS[c->id].source_methods == METHOD_1) {
+        /* "lea" copies the address of its source operand */
+        c->source_value = decoded.source.value;
+        c->source = &c->source_value;
+    }
+    c->handler = HANDLERS[c->id];
+    return c->handler(c, pc);
+}
+
+/* Returns the monotonic wall clock in seconds */
+static double wall_clock() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec / 1e9;
+}
+
+/* Prints the source line of an address to a stream, if it is known */
+static void print_source_line(FILE *stream, const char *name, int address) {
+    Debug_Line line;
+
+    if (!find_debug_line(&debug, address, &line))
+        return;
+    fprintf(stream, "The instruction at address %07d is in %s.as line %d", address, name, line.line);
+    if (line.macro != NULL)
+        fprintf(stream, " (macro \"%s\" line %d)", line.macro, line.macro_line);
+    fprintf(stream, "\n");
+}
+
+/* Prints the instruction counts and the final registers */
+static void print_summary(unsigned long steps, double seconds) {
+    int i;
+
+    for (i = 0; i < image_end; i++)
+        if (cache[i].handler != decode_and_run && cache[i].handler != run_outside)
+            counts[cache[i].id] += cache[i].executed;
+    fprintf(stderr, "Executed %lu instructions in %.3f s (%.1f million instructions/s)\n", steps, seconds,
+            seconds > 0 ? (double) steps / seconds / 1e6 : 0);
+    for (i = 0; i < INSTRUCTIONS_COUNT; i++)
+        if (counts[i] != 0)
+            fprintf(stderr, "  %-5s %12lu\n", INSTRUCTIONS[i].instruction, counts[i]);
+    fprintf(stderr, " ");
+    for (i = 0; i < REGISTERS_COUNT; i++)
+        fprintf(stderr, " %s=%d", REGISTERS[i], registers[i]);
+    fprintf(stderr, "\n");
+}
+
+/**
+ * @brief Runs the program given on the command line.
+ * @param argc The number of command-line arguments.
+ * @param argv An array of command-line arguments.
+ * @return 0 if the program reached "stop", 1 otherwise.
+ */
+int main(int argc, char *argv[]) {
+    Object_Module program;
+    Cached_Instruction *c = NULL;
+    unsigned long steps = 0, max_steps = (unsigned long) -1;
+    char *name = NULL;
+    double start;
+    int i, pc = IC_INITIAL;
+
+    for (i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--max-steps=", 12) == 0)
+            max_steps = strtoul(argv[i] + 12, NULL, DECIMAL_BASE);
+        else if (name == NULL && argv[i][0] != '-')
+            name = argv[i];
+        else {
+            printf("Usage: simulator [--max-steps=N] program\n");
+            return 1;
+        }
+    }
+    if (name == NULL) {
+        printf("Usage: simulator [--max-steps=N] program\n");
+        return 1;
+    }
+    if (load_object_module(name, &program) != 0)
+        return 1;
+    if (open_debug_file(name, &debug) > 0) {
+        free_object_module(&program);
+        return 1;
+    }
+    image_end = IC_INITIAL + program.code_length + program.data_length;
+    memory = calloc(CAPACITY, sizeof(int));
+    cache = malloc((image_end + 1) * sizeof(Cached_Instruction));
+    if (memory == NULL || cache == NULL || image_end > CAPACITY) {
+        printf(image_end > CAPACITY ? "Error: the program exceeds the memory capacity\n"
+                                    : "Error: Memory allocation failed\n");
+        free_object_module(&program);
+        close_debug_file(&debug);
+        free(memory);
+        free(cache);
+        return 1;
+    }
+    for (i = IC_INITIAL; i < image_end; i++)
+        memory[i] = wrap((int) program.words[i - IC_INITIAL]);
+    for (i = 0; i <= image_end; i++) {
+        cache[i].handler = i < IC_INITIAL || i == image_end ? run_outside : decode_and_run;
+        cache[i].executed = 0;
+    }
+    free_object_module(&program);
+
+    start = wall_clock();
+    while (pc >= 0 && steps < max_steps) {
+        c = &cache[pc];
+        c->executed++;
+        pc = c->handler(c, pc);
+        steps++;
+    }
+    if (pc == HALT_ERROR && c != NULL)
+        print_source_line(stdout, name, (int) (c - cache)); /* The instruction that failed */
+    fflush(stdout);
+    print_summary(steps, wall_clock() - start);
+    if (pc >= 0) {
+        fprintf(stderr, "Stopped after %lu instructions at address %07d\n", steps, pc);
+        print_source_line(stderr, name, pc);
+    }
+    close_debug_file(&debug);
+    free(memory);
+    free(cache);
+    return pc != HALT_STOP;
+}
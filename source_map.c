@@ -0,0 +1,212 @@
+/**
+ * @file source_map.c
+ * @brief Map of the code addresses back to the lines of the .as file.
+ *
+ * The pre-processing adds one record per line it writes to the .am file: the .as line it
+ * comes from, and for the lines of a macro body the macro and the .as line of the body
+ * line. The first pass adds the .am line of every instruction in address order, so an
+ * address is found with a binary search. The optimizations between the passes move the
+ * instructions with the code words.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "source_map.h"
+#include "const.h"
+#include "alloc.h"
+
+#define INITIAL_RECORDS 256
+
+/* Where a line of the .am file comes from */
+typedef struct Source_Line {
+    int line;
+    int macro;
+    int macro_line;
+} Source_Line;
+
+/* A macro and its body lines in macro_lines */
+typedef struct Source_Macro {
+    long name; /* Offset of the name in the pool */
+    int first;
+    int count;
+} Source_Macro;
+
+/* An instruction and the .am line it was written on */
+typedef struct Source_Address {
+    int address;
+    int am_line;
+} Source_Address;
+
+static Source_Line *lines = NULL;
+static int lines_count = 0;
+static long lines_capacity = 0;
+static int *macro_lines = NULL; /* The .as lines of the macro bodies, macro after macro */
+static int macro_lines_count = 0;
+static long macro_lines_capacity = 0;
+static Source_Macro *macros = NULL;
+static int macros_count = 0;
+static long macros_capacity = 0;
+static char *names = NULL;
+static long names_size = 0;
+static long names_capacity = 0;
+static Source_Address *addresses = NULL;
+static int addresses_count = 0;
+static long addresses_capacity = 0;
+
+/* Makes room for count + needed elements of the given size, returns 0 on success */
+static int reserve(void **array, long *capacity, long count, long needed, size_t size) {
+    long grown_capacity = *capacity > 0 ? *capacity : INITIAL_RECORDS;
+    void *grown;
+
+    while (count + needed > grown_capacity)
+        grown_capacity *= 2;
+    if (grown_capacity == *capacity)
+        return 0;
+    if ((grown = tracked_realloc(*array, grown_capacity * size, MEM_SYMBOLS)) == NULL) {
+        printf("Error: Memory allocation failed\n");
+        return 1;
+    }
+    *array = grown;
+    *capacity = grown_capacity;
+    return 0;
+}
+
+int add_source_macro(Macro *macro) {
+    long length = (long) strlen(macro->name);
+
+    if (reserve((void **) &macros, &macros_capacity, macros_count, 1, sizeof(Source_Macro)) != 0 ||
+        reserve((void **) &names, &names_capacity, names_size, length + 1, 1) != 0)
+        return 1;
+    memcpy(names + names_size, macro->name, length + 1); /* +1 to copy the '\0' */
+    macros[macros_count].name = names_size;
+    macros[macros_count].first = macro_lines_count;
+    macros[macros_count].count = 0;
+    names_size += length + 1;
+    macro->source = macros_count++;
+    return 0;
+}
+
+int add_macro_source_line(int line) {
+    if (macros_count == 0)
+        return 0;
+    if (reserve((void **) &macro_lines, &macro_lines_capacity, macro_lines_count, 1, sizeof(int)) != 0)
+        return 1;
+    macro_lines[macro_lines_count++] = line;
+    macros[macros_count - 1].count++;
+    return 0;
+}
+
+int add_expanded_lines(const char *text, int line, int macro) {
+    int body;
+
+    for (body = 0; text != NULL && *text != NULL_TERMINATOR; body++) {
+        if (reserve((void **) &lines, &lines_capacity, lines_count, 1, sizeof(Source_Line)) != 0)
+            return 1;
+        lines[lines_count].line = line;
+        lines[lines_count].macro = macro;
+        lines[lines_count++].macro_line = macro != NO_MACRO && body < macros[macro].count
+                                              ? macro_lines[macros[macro].first + body]
+                                              : 0;
+        text = strchr(text, '\n');
+        if (text != NULL)
+            text++;
+    }
+    return 0;
+}
+
+int add_source_address(int address, int am_line) {
+    if (reserve((void **) &addresses, &addresses_capacity, addresses_count, 1, sizeof(Source_Address)) != 0)
+        return 1;
+    addresses[addresses_count].address = address;
+    addresses[addresses_count++].am_line = am_line;
+    return 0;
+}
+
+void move_source_addresses(const int *code_address, int code_words) {
+    int i, index, kept = 0;
+
+    for (i = 0; i < addresses_count; i++) {
+        index = addresses[i].address - IC_INITIAL;
+        if (index >= 0 && index < code_words && code_address[index] == code_address[index + 1])
+            continue; /* Indicates the instruction was dropped */
+        addresses[kept] = addresses[i];
+        if (index >= 0 && index <= code_words)
+            addresses[kept].address = code_address[index];
+        kept++;
+    }
+    addresses_count = kept;
+}
+
+/* Fills the origin of an instruction */
+static void fill_origin(int index, Source_Origin *origin) {
+    const Source_Line *line = NULL;
+
+    if (addresses[index].am_line >= 1 && addresses[index].am_line <= lines_count)
+        line = &lines[addresses[index].am_line - 1];
+    origin->address = addresses[index].address;
+    origin->line = line != NULL ? line->line : 0;
+    origin->macro = line != NULL ? line->macro : NO_MACRO;
+    origin->macro_line = line != NULL ? line->macro_line : 0;
+    origin->macro_name = origin->macro != NO_MACRO ? names + macros[origin->macro].name : NULL;
+}
+
+int find_source_origin(int address, Source_Origin *origin) {
+    int low = 0, high = addresses_count, middle;
+
+    /* Finding the last instruction that starts at or before the address */
+    while (low < high) {
+        middle = low + (high - low) / 2;
+        if (addresses[middle].address <= address)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    if (low == 0)
+        return 0; /* Indicates the address is before the first instruction */
+    fill_origin(low - 1, origin);
+    return 1;
+}
+
+int get_source_origin(int index, Source_Origin *origin) {
+    if (index < 0 || index >= addresses_count)
+        return 0;
+    fill_origin(index, origin);
+    return 1;
+}
+
+int source_macros_count() {
+    return macros_count;
+}
+
+const char *source_macro_name(int macro) {
+    return names + macros[macro].name;
+}
+
+void print_source_error(const char *msg, const char *file_name, int address) {
+    Source_Origin origin;
+
+    if (!find_source_origin(address, &origin))
+        printf("Error in %s.as: %s\n", file_name, msg);
+    else if (origin.macro_name != NULL)
+        printf("Error in %s.as line %d (macro \"%s\" line %d): %s\n", file_name, origin.line, origin.macro_name,
+               origin.macro_line, msg);
+    else
+        printf("Error in %s.as line %d: %s\n", file_name, origin.line, msg);
+}
+
+void free_source_map() {
+    tracked_free(lines);
+    tracked_free(macro_lines);
+    tracked_free(macros);
+    tracked_free(names);
+    tracked_free(addresses);
+    lines = NULL;
+    macro_lines = NULL;
+    macros = NULL;
+    names = NULL;
+    addresses = NULL;
+    lines_count = lines_capacity = 0;
+    macro_lines_count = macro_lines_capacity = 0;
+    macros_count = macros_capacity = 0;
+    names_size = names_capacity = 0;
+    addresses_count = addresses_capacity = 0;
+}
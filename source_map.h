@@ -0,0 +1,112 @@
+#ifndef SOURCE_MAP_H
+#define SOURCE_MAP_H
+
+#include "macro_list.h"
+
+#define NO_MACRO (-1)
+
+/* Where the instruction at a code address comes from */
+typedef struct Source_Origin {
+    int address; /* Address of the first word of the instruction */
+    int line; /* Line in the .as file, the macro call for a line of a macro body */
+    int macro; /* Index of the expanded macro, NO_MACRO outside macros */
+    int macro_line; /* Line of the macro body in the .as file, 0 outside macros */
+    const char *macro_name; /* Name of the expanded macro, NULL outside macros */
+} Source_Origin;
+
+
+/**
+ * Adds a macro to the source map of the current file and sets its index in the macro.
+ * The body lines added next belong to it.
+ * @param macro The macro that was just defined.
+ * @return 0 on success, 1 if memory allocation failed.
+ */
+int add_source_macro(Macro *macro);
+
+
+/**
+ * Adds a line to the body of the last macro of the source map.
+ * @param line The line in the .as file.
+ * @return 0 on success, 1 if memory allocation failed.
+ */
+int add_macro_source_line(int line);
+
+
+/**
+ * Adds the lines of expanded text, in the order they are written to the .am file.
+ * @param text The text written, one or more lines.
+ * @param line The line of the .as file that produced the text.
+ * @param macro The index of the macro whose body is the text, NO_MACRO for a source line.
+ * @return 0 on success, 1 if memory allocation failed.
+ */
+int add_expanded_lines(const char *text, int line, int macro);
+
+
+/**
+ * Adds the instruction of a line of the expanded source. The instructions are added
+ * in address order.
+ * @param address The address of the first word of the instruction.
+ * @param am_line The line in the .am file.
+ * @return 0 on success, 1 if memory allocation failed.
+ */
+int add_source_address(int address, int am_line);
+
+
+/**
+ * Moves the instructions to the new addresses of their words and removes the dropped
+ * ones, like compact_image does with the code.
+ * @param code_address New address of every code word followed by the new end of the code.
+ * @param code_words Number of code words before the move.
+ */
+void move_source_addresses(const int *code_address, int code_words);
+
+
+/**
+ * Finds the instruction that contains a code address with a binary search.
+ * @param address An address inside the code.
+ * @param origin The origin of the instruction.
+ * @return 1 if the address was found, 0 if it is before the first instruction.
+ */
+int find_source_origin(int address, Source_Origin *origin);
+
+
+/**
+ * Gets an instruction of the source map.
+ * @param index The index of the instruction, in address order.
+ * @param origin The origin of the instruction.
+ * @return 1 if the instruction exists, 0 otherwise.
+ */
+int get_source_origin(int index, Source_Origin *origin);
+
+
+/**
+ * Gets the number of macros of the source map.
+ * @return The number of macros.
+ */
+int source_macros_count();
+
+
+/**
+ * Gets the name of a macro of the source map.
+ * @param macro The index of the macro.
+ * @return The name of the macro.
+ */
+const char *source_macro_name(int macro);
+
+
+/**
+ * Prints an error at the source line of a code address, with the macro it was expanded
+ * from.
+ * @param msg The message to print.
+ * @param file_name The name of the input file, without extension.
+ * @param address The code address the error is about.
+ */
+void print_source_error(const char *msg, const char *file_name, int address);
+
+
+/**
+ * Frees the source map of the current file.
+ */
+void free_source_map();
+
+#endif
@@ -0,0 +1,155 @@
+/**
+ * @file stats.c
+ * @brief Per-stage timing and throughput statistics of the assembler.
+ *
+ * Statistics are collected for every file and summed into run totals. Collection
+ * only costs a clock reading per stage and an addition per counter update, so it
+ * is always on; the "--stats" option only controls whether a report is printed.
+ * Reports are written to stderr so they never mix with the assembler messages.
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "stats.h"
+#include "util.h"
+
+const char *STAGE_NAMES[] = {
+    "pre_proc", "first_pass", "fixups", "entries", "output"
+};
+
+const char *COUNTER_NAMES[] = {
+    "lines", "bytes_in", "bytes_out", "code_words", "data_words",
+    "symbols", "macros", "fixups", "peak_symbols", "peak_macro_bytes"
+};
+
+static Stats_Format format = STATS_OFF;
+static File_Stats file_stats; /* Statistics of the current file */
+static File_Stats total_stats; /* Statistics summed over all files */
+static const char *file_name = "";
+static double wall_start[STAGES_COUNT];
+static clock_t cpu_start[STAGES_COUNT];
+
+/* Returns the monotonic wall clock in seconds */
+static double wall_clock() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec / 1e9;
+}
+
+/* Returns the total wall time of all stages */
+static double total_wall(const File_Stats *stats) {
+    double sum = 0;
+    int i;
+    for (i = 0; i < STAGES_COUNT; i++)
+        sum += stats->wall[i];
+    return sum;
+}
+
+/* Prints one record in the selected format */
+static void print_record(const char *name, const File_Stats *stats) {
+    double wall = total_wall(stats);
+    double lines_per_sec = wall > 0 ? (double) stats->counters[COUNT_LINES] / wall : 0;
+    int i;
+
+    if (format == STATS_JSON) {
+        fprintf(stderr, "{\"name\": ");
+        write_json_string(stderr, name);
+        fprintf(stderr, ", \"files\": %d, \"failed\": %d, \"stages\": {", stats->files, stats->failed);
+        for (i = 0; i < STAGES_COUNT; i++)
+            fprintf(stderr, "%s\"%s\": {\"wall_ms\": %.3f, \"cpu_ms\": %.3f}", i ? ", " : "", STAGE_NAMES[i],
+                    stats->wall[i] * 1000, stats->cpu[i] * 1000);
+        fprintf(stderr, "}, \"lines_per_sec\": %.0f", lines_per_sec);
+        for (i = 0; i < COUNTERS_COUNT; i++)
+            fprintf(stderr, ", \"%s\": %ld", COUNTER_NAMES[i], stats->counters[i]);
+        fprintf(stderr, "}");
+        return;
+    }
+    fprintf(stderr, "Statistics for %s:\n", name);
+    fprintf(stderr, "  %-12s %12s %12s\n", "stage", "wall (ms)", "cpu (ms)");
+    for (i = 0; i < STAGES_COUNT; i++)
+        fprintf(stderr, "  %-12s %12.3f %12.3f\n", STAGE_NAMES[i], stats->wall[i] * 1000, stats->cpu[i] * 1000);
+    fprintf(stderr, "  lines %ld (%.0f lines/s), bytes in %ld, bytes out %ld\n", stats->counters[COUNT_LINES],
+            lines_per_sec, stats->counters[COUNT_BYTES_IN], stats->counters[COUNT_BYTES_OUT]);
+    fprintf(stderr, "  code words %ld, data words %ld\n", stats->counters[COUNT_CODE_WORDS],
+            stats->counters[COUNT_DATA_WORDS]);
+    fprintf(stderr, "  symbols %ld, macros %ld, fixups %ld\n", stats->counters[COUNT_SYMBOLS],
+            stats->counters[COUNT_MACROS], stats->counters[COUNT_FIXUPS]);
+    fprintf(stderr, "  peak symbol table entries %ld, peak macro table bytes %ld\n",
+            stats->counters[COUNT_PEAK_SYMBOLS], stats->counters[COUNT_PEAK_MACRO_BYTES]);
+}
+
+void set_stats_format(Stats_Format new_format) {
+    format = new_format;
+}
+
+void stats_start_file(const char *name) {
+    memset(&file_stats, 0, sizeof(file_stats));
+    file_stats.files = 1;
+    file_name = name;
+}
+
+void stats_end_file(int status) {
+    int i;
+
+    file_stats.failed = status != 0;
+    for (i = 0; i < STAGES_COUNT; i++) {
+        total_stats.wall[i] += file_stats.wall[i];
+        total_stats.cpu[i] += file_stats.cpu[i];
+    }
+    for (i = 0; i < COUNTERS_COUNT; i++) {
+        if (i == COUNT_PEAK_SYMBOLS || i == COUNT_PEAK_MACRO_BYTES) {
+            if (file_stats.counters[i] > total_stats.counters[i])
+                total_stats.counters[i] = file_stats.counters[i];
+        } else {
+            total_stats.counters[i] += file_stats.counters[i];
+        }
+    }
+    total_stats.files++;
+    total_stats.failed += file_stats.failed;
+
+    if (format == STATS_OFF)
+        return;
+    if (format == STATS_JSON)
+        fprintf(stderr, total_stats.files == 1 ? "{\"files\": [" : ", ");
+    print_record(file_name, &file_stats);
+}
+
+void stage_begin(Stage stage) {
+    wall_start[stage] = wall_clock();
+    cpu_start[stage] = clock();
+}
+
+void stage_end(Stage stage) {
+    file_stats.wall[stage] += wall_clock() - wall_start[stage];
+    file_stats.cpu[stage] += (double) (clock() - cpu_start[stage]) / CLOCKS_PER_SEC;
+}
+
+void stats_add(Counter counter, long amount) {
+    file_stats.counters[counter] += amount;
+}
+
+void stats_peak(Counter counter, long value) {
+    if (value > file_stats.counters[counter])
+        file_stats.counters[counter] = value;
+}
+
+const File_Stats *get_file_stats() {
+    return &file_stats;
+}
+
+const File_Stats *get_total_stats() {
+    return &total_stats;
+}
+
+void print_total_stats() {
+    if (format == STATS_OFF)
+        return;
+    if (format == STATS_JSON) {
+        fprintf(stderr, total_stats.files == 0 ? "{\"files\": [], \"total\": " : "], \"total\": ");
+        print_record("total", &total_stats);
+        fprintf(stderr, "}\n");
+        return;
+    }
+    print_record("all files", &total_stats);
+}
@@ -0,0 +1,119 @@
+#ifndef STATS_H
+#define STATS_H
+
+/* Stages of the assembler that are timed separately */
+typedef enum Stage {
+    STAGE_PRE_PROC,
+    STAGE_FIRST_PASS,
+    STAGE_FIXUPS,
+    STAGE_ENTRIES,
+    STAGE_OUTPUT,
+    STAGES_COUNT
+} Stage;
+
+/* Counters collected while assembling a file */
+typedef enum Counter {
+    COUNT_LINES,
+    COUNT_BYTES_IN,
+    COUNT_BYTES_OUT,
+    COUNT_CODE_WORDS,
+    COUNT_DATA_WORDS,
+    COUNT_SYMBOLS,
+    COUNT_MACROS,
+    COUNT_FIXUPS,
+    COUNT_PEAK_SYMBOLS,
+    COUNT_PEAK_MACRO_BYTES,
+    COUNTERS_COUNT
+} Counter;
+
+/* Report formats */
+typedef enum Stats_Format {
+    STATS_OFF,
+    STATS_TEXT,
+    STATS_JSON
+} Stats_Format;
+
+/* Timing and counters of a single file (or of the whole run) */
+typedef struct File_Stats {
+    double wall[STAGES_COUNT]; /* Wall time of each stage in seconds */
+    double cpu[STAGES_COUNT]; /* CPU time of each stage in seconds */
+    long counters[COUNTERS_COUNT];
+    int files; /* Number of files summed into this record */
+    int failed; /* Number of files that failed to assemble */
+} File_Stats;
+
+extern const char *STAGE_NAMES[];
+extern const char *COUNTER_NAMES[];
+
+/**
+ * Sets the format in which statistics are reported.
+ * Statistics are always collected, the format only controls reporting.
+ * @param format The report format (STATS_OFF disables reporting).
+ */
+void set_stats_format(Stats_Format format);
+
+
+/**
+ * Resets the per-file statistics before a new file is processed.
+ * @param name The name of the file being processed.
+ */
+void stats_start_file(const char *name);
+
+
+/**
+ * Adds the per-file statistics to the totals and reports them if enabled.
+ * @param status 0 if the file was assembled successfully, 1 otherwise.
+ */
+void stats_end_file(int status);
+
+
+/**
+ * Starts timing a stage of the current file.
+ * @param stage The stage being started.
+ */
+void stage_begin(Stage stage);
+
+
+/**
+ * Stops timing a stage of the current file.
+ * @param stage The stage being stopped.
+ */
+void stage_end(Stage stage);
+
+
+/**
+ * Adds an amount to a counter of the current file.
+ * @param counter The counter to increment.
+ * @param amount The amount to add.
+ */
+void stats_add(Counter counter, long amount);
+
+
+/**
+ * Raises a peak counter of the current file if the value is higher.
+ * @param counter The counter to update.
+ * @param value The current value of the measured quantity.
+ */
+void stats_peak(Counter counter, long value);
+
+
+/**
+ * Gets the statistics of the file currently (or last) processed.
+ * @return Pointer to the per-file statistics.
+ */
+const File_Stats *get_file_stats();
+
+
+/**
+ * Gets the statistics accumulated over all processed files.
+ * @return Pointer to the total statistics.
+ */
+const File_Stats *get_total_stats();
+
+
+/**
+ * Prints the aggregate statistics of the run if reporting is enabled.
+ */
+void print_total_stats();
+
+#endif
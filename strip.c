@@ -0,0 +1,248 @@
+/**
+ * @file strip.c
+ * @brief Elimination of unreachable code and unreferenced data.
+ *
+ * Runs between the first and second pass, after the peephole optimization. The roots are
+ * the first instruction and the labels named by ".entry". An instruction is reachable from
+ * a root, from a reachable instruction before it that is not a "jmp", "rts" or "stop", and
+ * from a reachable instruction whose operand names its label. A data label is kept when a
+ * reachable instruction or an ".entry" names it, and it owns the data words up to the next
+ * data label. Data words before the first data label cannot be named, and are dropped.
+ *
+ * The dropped instructions and data words are removed together with their labels, and
+ * compact.c moves the rest.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "strip.h"
+#include "compact.h"
+#include "machine_code.h"
+#include "symbols_list.h"
+#include "validations.h"
+#include "const.h"
+#include "alloc.h"
+#include "trace.h"
+
+/* The reference graph of the current file */
+typedef struct Strip_Graph {
+    int code_words;
+    int data_words;
+    int count; /* Number of instructions */
+    int *instruction_at; /* Instruction that starts at each code word, -1 for the other words */
+    int *start; /* First word of each instruction, followed by the end of the code */
+    char *ends_flow; /* Whether each instruction never continues to the next one */
+    char *reachable; /* Whether each instruction is reachable */
+    int *pending; /* Reachable instructions whose references were not followed yet */
+    int pending_count;
+    int *target; /* Label named by each code word that is an operand fixup, or NO_SYMBOL */
+    char *data_label; /* Whether a data label starts at each data word */
+    char *referenced; /* Whether each data word is kept */
+} Strip_Graph;
+
+static int enabled = 0;
+
+void set_strip(int value) {
+    enabled = value;
+}
+
+/* Checks if an instruction never continues to the next one */
+static int is_flow_end(int id) {
+    return id >= 0 && (strcmp(INSTRUCTIONS[id].instruction, "jmp") == 0 ||
+                       strcmp(INSTRUCTIONS[id].instruction, "rts") == 0 ||
+                       strcmp(INSTRUCTIONS[id].instruction, "stop") == 0);
+}
+
+/* Frees the graph */
+static void free_graph(Strip_Graph *graph) {
+    tracked_free(graph->instruction_at);
+    tracked_free(graph->start);
+    tracked_free(graph->ends_flow);
+    tracked_free(graph->reachable);
+    tracked_free(graph->pending);
+    tracked_free(graph->target);
+    tracked_free(graph->data_label);
+    tracked_free(graph->referenced);
+}
+
+/* Builds the graph from the code list and the symbols, returns 0 on success */
+static int build_graph(Strip_Graph *graph, const Code *code_head, int IC, int DC) {
+    const Code *current;
+    const Symbol_Table *table = get_symbol_table();
+    int index, extra, symbol;
+
+    memset(graph, 0, sizeof(Strip_Graph));
+    graph->code_words = IC - IC_INITIAL;
+    graph->data_words = DC;
+    graph->instruction_at = tracked_malloc((graph->code_words + 1) * sizeof(int), MEM_TEMP);
+    graph->start = tracked_malloc((graph->code_words + 1) * sizeof(int), MEM_TEMP);
+    graph->ends_flow = tracked_malloc(graph->code_words + 1, MEM_TEMP);
+    graph->reachable = tracked_malloc(graph->code_words + 1, MEM_TEMP);
+    graph->pending = tracked_malloc((graph->code_words + 1) * sizeof(int), MEM_TEMP);
+    graph->target = tracked_malloc((graph->code_words + 1) * sizeof(int), MEM_TEMP);
+    graph->data_label = tracked_malloc(graph->data_words + 1, MEM_TEMP);
+    graph->referenced = tracked_malloc(graph->data_words + 1, MEM_TEMP);
+    if (graph->instruction_at == NULL || graph->start == NULL || graph->ends_flow == NULL ||
+        graph->reachable == NULL || graph->pending == NULL || graph->target == NULL ||
+        graph->data_label == NULL || graph->referenced == NULL) {
+        printf("Error: Memory allocation failed\n");
+        free_graph(graph);
+        return 1;
+    }
+    memset(graph->reachable, 0, graph->code_words + 1);
+    memset(graph->data_label, 0, graph->data_words + 1);
+    memset(graph->referenced, 0, graph->data_words + 1);
+
+    /* Splitting the code into instructions */
+    for (current = code_head, index = 0; current != NULL; graph->count++) {
+        graph->start[graph->count] = index;
+        graph->ends_flow[graph->count] = (char) is_flow_end(instruction_of(current->value));
+        graph->instruction_at[index] = graph->count;
+        graph->target[index++] = NO_SYMBOL;
+        for (extra = extra_words_of(current->value), current = current->next;
+             current != NULL && extra > 0; extra--, current = current->next) {
+            graph->instruction_at[index] = -1;
+            graph->target[index++] = NO_SYMBOL;
+        }
+    }
+    graph->start[graph->count] = graph->code_words;
+
+    /* Every fixup holds the address of its operand word */
+    for (symbol = 0; symbol < table->count; symbol++) {
+        index = table->addresses[symbol] - IC_INITIAL;
+        if (table->types[symbol] == OPERAND && index >= 0 && index < graph->code_words)
+            graph->target[index] = is_label_defined(symbol_name(symbol));
+        else if (table->types[symbol] == DATA && index - graph->code_words >= 0 &&
+                 index - graph->code_words < graph->data_words)
+            graph->data_label[index - graph->code_words] = 1;
+    }
+    return 0;
+}
+
+/* Marks the code or data that a label names as reachable */
+static void reach_label(Strip_Graph *graph, int label) {
+    const Symbol_Table *table = get_symbol_table();
+    int index, instruction;
+
+    if (label == NO_SYMBOL)
+        return;
+    index = table->addresses[label] - IC_INITIAL;
+    if (table->types[label] == CODE && index >= 0 && index < graph->code_words) {
+        instruction = graph->instruction_at[index];
+        if (instruction >= 0 && !graph->reachable[instruction]) {
+            graph->reachable[instruction] = 1;
+            graph->pending[graph->pending_count++] = instruction;
+        }
+    } else if (table->types[label] == DATA) {
+        /* The label owns the words up to the next data label */
+        for (index -= graph->code_words; index >= 0 && index < graph->data_words && !graph->referenced[index];) {
+            graph->referenced[index++] = 1;
+            if (index < graph->data_words && graph->data_label[index])
+                break;
+        }
+    }
+}
+
+/* Marks the labels named by the ".entry" lines as reachable, returns 0 on success */
+static int reach_entries(Strip_Graph *graph, char *file_name) {
+    char name[MAX_LINE_LENGTH];
+    FILE *file = open_entry_lines(file_name);
+
+    if (file == NULL)
+        return 1;
+    while (next_entry_name(file, name))
+        reach_label(graph, is_label_defined(name));
+    fclose(file);
+    return 0;
+}
+
+/* Follows the fall-through and the operands of the reachable instructions */
+static void reach_code(Strip_Graph *graph) {
+    int instruction, word;
+
+    if (graph->count > 0 && !graph->reachable[0]) {
+        graph->reachable[0] = 1;
+        graph->pending[graph->pending_count++] = 0;
+    }
+    while (graph->pending_count > 0) {
+        instruction = graph->pending[--graph->pending_count];
+        for (word = graph->start[instruction]; word < graph->start[instruction + 1]; word++)
+            reach_label(graph, graph->target[word]);
+        if (!graph->ends_flow[instruction] && instruction + 1 < graph->count &&
+            !graph->reachable[instruction + 1]) {
+            graph->reachable[instruction + 1] = 1;
+            graph->pending[graph->pending_count++] = instruction + 1;
+        }
+    }
+}
+
+/* Removes the labels of the dropped code and data, returns the number of removed labels */
+static int remove_dropped_labels(const Strip_Graph *graph) {
+    const Symbol_Table *table = get_symbol_table();
+    int symbol, index, removed = 0;
+
+    for (symbol = 0; symbol < table->count; symbol++) {
+        index = table->addresses[symbol] - IC_INITIAL;
+        if ((table->types[symbol] == CODE && index >= 0 && index < graph->code_words &&
+             graph->instruction_at[index] >= 0 && !graph->reachable[graph->instruction_at[index]]) ||
+            (table->types[symbol] == DATA && index - graph->code_words >= 0 &&
+             index - graph->code_words < graph->data_words && !graph->referenced[index - graph->code_words])) {
+            printf("Strip: removed %s label \"%s\"\n", table->types[symbol] == CODE ? "code" : "data",
+                   symbol_name(symbol));
+            remove_label(symbol);
+            removed++;
+        }
+    }
+    return removed;
+}
+
+int strip(char *file_name, Code **code_head, Data **data_head, int *IC, int *DC) {
+    Strip_Graph graph;
+    int *code_address, *data_address;
+    int i, word, address, code_words, data_words, labels;
+
+    if (!enabled)
+        return 0;
+    trace_begin("strip");
+    if (build_graph(&graph, *code_head, *IC, *DC) != 0) {
+        trace_end("strip");
+        return 1;
+    }
+    if (reach_entries(&graph, file_name) != 0) {
+        free_graph(&graph);
+        trace_end("strip");
+        return 1;
+    }
+    reach_code(&graph);
+
+    code_address = tracked_malloc((graph.code_words + 1) * sizeof(int), MEM_TEMP);
+    data_address = tracked_malloc((graph.data_words + 1) * sizeof(int), MEM_TEMP);
+    if (code_address == NULL || data_address == NULL) {
+        printf("Error: Memory allocation failed\n");
+        tracked_free(code_address);
+        tracked_free(data_address);
+        free_graph(&graph);
+        trace_end("strip");
+        return 1;
+    }
+    /* A dropped word takes the address of the next kept word */
+    for (i = 0, address = IC_INITIAL; i < graph.count; i++)
+        for (word = graph.start[i]; word < graph.start[i + 1]; word++)
+            code_address[word] = graph.reachable[i] ? address++ : address;
+    code_address[graph.code_words] = address;
+    for (word = 0, address = DC_INITIAL; word < graph.data_words; word++)
+        data_address[word] = graph.referenced[word] ? address++ : address;
+    data_address[graph.data_words] = address;
+
+    labels = remove_dropped_labels(&graph);
+    code_words = graph.code_words - (code_address[graph.code_words] - IC_INITIAL);
+    data_words = graph.data_words - (data_address[graph.data_words] - DC_INITIAL);
+    if (code_words > 0 || data_words > 0)
+        compact_image(code_head, data_head, code_address, data_address, IC, DC);
+    printf("Strip removed %d code words and %d data words (%d labels)\n", code_words, data_words, labels);
+
+    tracked_free(code_address);
+    tracked_free(data_address);
+    free_graph(&graph);
+    trace_end("strip");
+    return 0;
+}
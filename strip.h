@@ -0,0 +1,30 @@
+#ifndef STRIP_H
+#define STRIP_H
+
+#include "code_list.h"
+#include "data_list.h"
+
+/**
+ * Enables the elimination of unreachable code and unreferenced data between the first
+ * and second pass.
+ * @param enabled 1 to enable the elimination, 0 to disable it.
+ */
+void set_strip(int enabled);
+
+
+/**
+ * Drops the instructions of the current file that cannot be reached from the first
+ * instruction or from an ".entry" label, and the data labels that no kept instruction
+ * or ".entry" refers to, if the elimination is enabled. Prints every dropped label and
+ * the number of saved words. Must be called after the first pass, before the operands
+ * are resolved.
+ * @param file_name The name of the file, whose ".am" file holds the ".entry" lines.
+ * @param code_head Pointer to the head of the code list.
+ * @param data_head Pointer to the head of the data list.
+ * @param IC Pointer to the final instruction counter, lowered by the dropped code words.
+ * @param DC Pointer to the final data counter, lowered by the dropped data words.
+ * @return 0 on success, 1 if the ".am" file could not be read or memory allocation failed.
+ */
+int strip(char *file_name, Code **code_head, Data **data_head, int *IC, int *DC);
+
+#endif
@@ -2,193 +2,228 @@
  * @file symbols_list.c
  * @brief This file contains the implementation of the functions for managing labels in the assembler.
  * It includes functions to add, check, and free labels.
+ *
+ * The labels are stored as parallel arrays (names in a string pool, addresses and types),
+ * so the sweeps over all the labels are linear loops over one or two arrays.
  */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "symbols_list.h"
-
-/* Defining the head of the labels linked list */
-static Symbol *head = NULL;
-
-Symbol *add_symbol(const char *name, int content, Type type) {
-    Symbol *last_symbol;
-
-    Symbol *new_symbol = (Symbol *) malloc(sizeof(Symbol));
-    if (new_symbol == NULL) {
-        printf("Error: Memory allocation failed");
-        return NULL; /* Indicates failure */
+#include "stats.h"
+#include "alloc.h"
+
+#define INITIAL_SYMBOLS 64
+#define INITIAL_POOL 1024
+
+/* The table of the file being assembled */
+static Symbol_Table table = {NULL, NULL, NULL, NULL, 0, 0, 0, 0};
+/* Number of labels currently in the table */
+static long symbols_count = 0;
+/* Number of "extern" labels in the table */
+static int externs_count = 0;
+/* No "operand" label is stored before this index */
+static int operand_cursor = 0;
+/* Uses of extern labels, appended while the operands are resolved */
+static Extern_Reference *references = NULL;
+static int references_count = 0;
+static int references_capacity = 0;
+
+/* Makes room for one more symbol with a name of the given length, returns 0 on success */
+static int reserve(size_t name_len) {
+    int capacity = table.capacity > 0 ? table.capacity : INITIAL_SYMBOLS;
+    long pool_capacity = table.pool_capacity > 0 ? table.pool_capacity : INITIAL_POOL;
+    void *grown;
+
+    while (table.count >= capacity)
+        capacity *= 2;
+    while (table.pool_size + (long) name_len + 1 > pool_capacity)
+        pool_capacity *= 2;
+    if (capacity != table.capacity) {
+        if ((grown = tracked_realloc(table.name_offsets, capacity * sizeof(long), MEM_SYMBOLS)) == NULL)
+            return 1;
+        table.name_offsets = grown;
+        if ((grown = tracked_realloc(table.addresses, capacity * sizeof(int), MEM_SYMBOLS)) == NULL)
+            return 1;
+        table.addresses = grown;
+        if ((grown = tracked_realloc(table.types, capacity, MEM_SYMBOLS)) == NULL)
+            return 1;
+        table.types = grown;
+        table.capacity = capacity;
     }
-    /* Allocating memory and copying the label */
-    new_symbol->label = (char *) malloc(strlen(name) + 1); /* +1 to accommodate '\0' */
-    if (new_symbol->label == NULL) {
-        printf("Error: Memory allocation failed");
-        free(new_symbol);
-        return NULL; /* Indicates failure */
+    if (pool_capacity != table.pool_capacity) {
+        if ((grown = tracked_realloc(table.names, pool_capacity, MEM_SYMBOLS)) == NULL)
+            return 1;
+        table.names = grown;
+        table.pool_capacity = pool_capacity;
     }
-    strcpy(new_symbol->label, name);
-
-    /* Setting the content, type, location and next pointer */
-    new_symbol->type = type;
-    new_symbol->address = content;
+    return 0;
+}
 
-    new_symbol->next = NULL;
+int add_symbol(const char *name, int content, Type type) {
+    size_t name_len = strlen(name);
 
-    /* If the list is empty, setting the new label as the head */
-    if (head == NULL) {
-        head = new_symbol;
-    } else {
-        /* Otherwise, finding the end of the list and adding the new label */
-        last_symbol = get_last_label();
-        last_symbol->next = new_symbol;
+    if (reserve(name_len) != 0) {
+        printf("Error: Memory allocation failed");
+        return NO_SYMBOL; /* Indicates failure */
     }
-    return new_symbol; /* Indicates success */
+    /* Copying the label to the end of the pool */
+    table.name_offsets[table.count] = table.pool_size;
+    memcpy(table.names + table.pool_size, name, name_len + 1); /* +1 to copy the '\0' */
+    table.pool_size += (long) name_len + 1;
+
+    /* Setting the content and type */
+    table.addresses[table.count] = content;
+    table.types[table.count] = (unsigned char) type;
+
+    externs_count += type == EXTERN;
+    stats_add(type == OPERAND ? COUNT_FIXUPS : COUNT_SYMBOLS, 1);
+    stats_peak(COUNT_PEAK_SYMBOLS, ++symbols_count);
+    return table.count++; /* Indicates success */
 }
 
-Symbol *is_symbol_name(const char *label_name) {
-    Symbol *current = head;
+int is_symbol_name(const char *label_name) {
+    int i;
 
-    while (current != NULL) {
-        if (strcmp(current->label, label_name) == 0 && current->type != OPERAND) {
-            return current; /* Indicates label is a label label and returns a pointer to its node */
+    for (i = 0; i < table.count; i++) {
+        if (table.types[i] != OPERAND && table.types[i] != REMOVED &&
+            strcmp(table.names + table.name_offsets[i], label_name) == 0) {
+            return i; /* Indicates label is a label label and returns its index */
         }
-        current = current->next;
     }
-    return NULL; /* Indicates label is not a label label */
+    return NO_SYMBOL; /* Indicates label is not a label label */
 }
 
-Symbol *is_label_defined(const char *label_name) {
-    Symbol *current = head;
+int is_extern_name(const char *label_name) {
+    int i;
 
-    while (current != NULL) {
-        if ((strcmp(current->label, label_name) == 0) && (
-                (current->type == CODE) || (current->type == EXTERN && current->address == 0) || (
-                    current->type == DATA))) {
-            return current; /* Indicates label is a label label and returns a pointer to its node */
-        }
-        current = current->next;
-    }
-    return NULL; /* Indicates label is not a label label */
+    for (i = 0; externs_count > 0 && i < table.count; i++)
+        if (table.types[i] == EXTERN && strcmp(table.names + table.name_offsets[i], label_name) == 0)
+            return 1;
+    return 0;
 }
 
-void update_data_labels(const int *ICF) {
-    Symbol *current = head;
+int is_label_defined(const char *label_name) {
+    int i;
 
-    while (current != NULL) {
-        if (current->type == DATA) {
-            current->address += *ICF;
+    for (i = 0; i < table.count; i++) {
+        if ((table.types[i] == CODE || table.types[i] == EXTERN || table.types[i] == DATA) &&
+            strcmp(table.names + table.name_offsets[i], label_name) == 0) {
+            return i; /* Indicates label is a label label and returns its index */
         }
-        current = current->next;
     }
+    return NO_SYMBOL; /* Indicates label is not a label label */
 }
 
-Symbol *get_operand_label() {
-    Symbol *current = head;
+void update_data_labels(const int *ICF) {
+    int i, count = table.count, offset = *ICF;
+    int *addresses = table.addresses;
+    const unsigned char *types = table.types;
 
-    while (current != NULL) {
-        if (current->type == OPERAND) {
-            return current; /* Indicates an "operand" type label was found */
-        }
-        current = current->next;
-    }
-    return NULL; /* Indicates no "operand" type label was found */
+    for (i = 0; i < count; i++)
+        addresses[i] += types[i] == DATA ? offset : 0;
 }
 
-int entry_exist() {
-    Symbol *current = head;
+int get_operand_label() {
+    int i;
 
-    while (current != NULL) {
-        if (current->type == ENTRY) {
-            return 1; /* Indicates an "entry" type label was found */
+    /* The operand labels are consumed in order, so the search resumes where the last one was found */
+    for (i = operand_cursor; i < table.count; i++) {
+        if (table.types[i] == OPERAND) {
+            operand_cursor = i;
+            return i; /* Indicates an "operand" type label was found */
         }
-        current = current->next;
     }
-    return 0; /* Indicates no "entry" type label was found */
+    operand_cursor = table.count;
+    return NO_SYMBOL; /* Indicates no "operand" type label was found */
 }
 
-int extern_exist() {
-    Symbol *current = head;
+int add_extern_reference(int symbol, int address) {
+    Extern_Reference *grown;
+    int capacity;
 
-    while (current != NULL) {
-        if (current->type == EXTERN) {
-            return 1; /* Indicates an "extern" type label was found */
+    if (references_count == references_capacity) {
+        capacity = references_capacity > 0 ? references_capacity * 2 : INITIAL_SYMBOLS;
+        grown = tracked_realloc(references, capacity * sizeof(Extern_Reference), MEM_SYMBOLS);
+        if (grown == NULL) {
+            printf("Error: Memory allocation failed\n");
+            return 1;
         }
-        current = current->next;
+        references = grown;
+        references_capacity = capacity;
     }
-    return 0; /* Indicates no "extern" type label was found */
+    references[references_count].symbol = symbol;
+    references[references_count++].address = address;
+    return 0;
+}
+
+const Extern_Reference *get_extern_references(int *count) {
+    *count = references_count;
+    return references;
 }
 
-Symbol *get_label_head() {
-    return head;
+/* Checks if a label of the given type exists */
+static int type_exists(Type type) {
+    int i, found = 0;
+
+    for (i = 0; i < table.count; i++)
+        found |= table.types[i] == type;
+    return found;
 }
 
-Symbol *get_last_label() {
-    Symbol *current;
+int entry_exist() {
+    return type_exists(ENTRY);
+}
 
-    if (head == NULL)
-        return NULL; /* Indicates list is empty */
+int extern_exist() {
+    return type_exists(EXTERN);
+}
 
-    current = head;
-    while (current->next != NULL)
-        current = current->next;
+Symbol_Table *get_symbol_table() {
+    return &table;
+}
 
-    return current; /* Returning the last label in the list */
+const char *symbol_name(int symbol) {
+    return table.names + table.name_offsets[symbol];
 }
 
 void remove_last_label() {
-    Symbol *current;
+    /* Skipping the removed labels at the end */
+    while (table.count > 0 && table.types[table.count - 1] == REMOVED)
+        table.count--;
+    if (table.count == 0)
+        return; /* Indicates table is empty */
+    table.count--;
+    externs_count -= table.types[table.count] == EXTERN;
+    table.pool_size = table.name_offsets[table.count];
+    if (operand_cursor > table.count)
+        operand_cursor = table.count;
+    symbols_count--;
+}
 
-    if (head->next == NULL) {
-        /* Indicates only one label in the list */
-        free(head->label);
-        free(head);
-        head = NULL;
+void remove_label(int symbol) {
+    if (symbol < 0 || symbol >= table.count || table.types[symbol] == REMOVED)
         return;
-    }
-    current = head;
-
-    while (current->next->next != NULL) {
-        /* Skipping to the second-to-last label */
-        current = current->next;
-    }
-    free(current->next->label);
-    free(current->next);
-
-    current->next = NULL; /* Updating the second-to-last label to be the new last */
-}
-
-void remove_label(const Symbol *label) {
-    Symbol *current = head;
-    Symbol *prev = NULL;
-
-    while (current != NULL) {
-        if (current == label) {
-            if (prev == NULL) {
-                /* Checking if "head" is the label to be removed */
-                head = current->next;
-            } else {
-                prev->next = current->next;
-            }
-            free(current->label);
-            free(current);
-            return; /* Symbol found and removed */
-        }
-        prev = current;
-        current = current->next;
-    }
+    externs_count -= table.types[symbol] == EXTERN;
+    table.types[symbol] = REMOVED; /* The slot is kept so that the order does not change */
+    symbols_count--;
 }
 
 void free_labels() {
-    Symbol *current = head;
-    Symbol *next;
-
-    while (current != NULL) {
-        next = current->next; /* Updating the next pointer */
-
-        free(current->label); /* Freeing the dynamically allocated label */
-        free(current); /* Freeing the macro node itself */
-
-        current = next; /* Moving to the next node */
-    }
-    head = NULL;
+    tracked_free(table.names);
+    tracked_free(table.name_offsets);
+    tracked_free(table.addresses);
+    tracked_free(table.types);
+    tracked_free(references);
+    table.names = NULL;
+    table.name_offsets = NULL;
+    table.addresses = NULL;
+    table.types = NULL;
+    table.count = table.capacity = 0;
+    table.pool_size = table.pool_capacity = 0;
+    symbols_count = 0;
+    externs_count = 0;
+    operand_cursor = 0;
+    references = NULL;
+    references_count = references_capacity = 0;
 }
@@ -8,42 +8,68 @@ typedef enum Type {
     EXTERN,
     OPERAND,
     CODE,
-    DATA
+    DATA,
+    REMOVED
 } Type;
 
+/* Index returned when no symbol was found */
+#define NO_SYMBOL (-1)
 
-/* Symbol struct definition */
-typedef struct Symbol {
-    char *label;
-    int address;
-    Type type;
-    struct Symbol *next;
-} Symbol;
+/*
+ * The symbol table, stored as parallel arrays indexed by symbol in the order the symbols
+ * were added. A removed symbol keeps its slot with the type REMOVED, so the order is kept
+ * and a sweep over one field is a linear loop over one array.
+ */
+typedef struct Symbol_Table {
+    char *names; /* Pool of the null-terminated names */
+    long *name_offsets; /* Offset of the name of each symbol in the pool */
+    int *addresses; /* Address of each symbol */
+    unsigned char *types; /* Type of each symbol (see Type) */
+    int count; /* Number of slots, including the removed symbols */
+    int capacity; /* Number of allocated slots */
+    long pool_size; /* Bytes used in the pool */
+    long pool_capacity; /* Bytes allocated for the pool */
+} Symbol_Table;
+
+/* A use of an extern label by an operand word */
+typedef struct Extern_Reference {
+    int symbol; /* Index of the extern label */
+    int address; /* Address of the operand word */
+} Extern_Reference;
 
 /**
- * Adds a new Symbol to the end of the linked list.
+ * Adds a new symbol to the end of the table.
  * @param name The name of the new label.
  * @param address The address of the new label in memory.
  * @param type The type of the new label.
- * @return 0 for a successful instruction ,1 if errors were detected.
+ * @return The index of the new symbol, NO_SYMBOL if memory allocation failed.
  */
-Symbol *add_symbol(const char *name, int address, Type type);
+int add_symbol(const char *name, int address, Type type);
 
 
 /**
  * Checks if a given label is a label label.
  * @param label_name The name to check.
- * @return Pointer to the label if found, NULL otherwise.
+ * @return The index of the label if found, NO_SYMBOL otherwise.
  */
-Symbol *is_symbol_name(const char *label_name);
+int is_symbol_name(const char *label_name);
+
+
+/**
+ * Checks if an "extern" type label of the given name was declared.
+ * Returns without a search while no extern label is declared.
+ * @param label_name The name to check.
+ * @return 1 if the extern label exists, 0 otherwise.
+ */
+int is_extern_name(const char *label_name);
 
 
 /**
  * Checks if a given label label is defined.
  * @param label_name The name to check.
- * @return Pointer to the label if found, NULL otherwise.
+ * @return The index of the label if found, NO_SYMBOL otherwise.
  */
-Symbol *is_label_defined(const char *label_name);
+int is_label_defined(const char *label_name);
 
 
 /**
@@ -55,9 +81,26 @@ void update_data_labels(const int *ICF);
 
 /**
  * Retrieves the first "operand" label.
- * @return Pointer to the operand label if found, NULL otherwise.
+ * @return The index of the operand label if found, NO_SYMBOL otherwise.
+ */
+int get_operand_label();
+
+
+/**
+ * Records a use of an extern label, in the order the uses are resolved.
+ * @param symbol The index of the extern label.
+ * @param address The address of the operand word that uses it.
+ * @return 0 on success, 1 if memory allocation failed.
+ */
+int add_extern_reference(int symbol, int address);
+
+
+/**
+ * Gets the recorded uses of extern labels.
+ * @param count Pointer that receives the number of uses.
+ * @return The array of uses, in the order they were recorded.
  */
-Symbol *get_operand_label();
+const Extern_Reference *get_extern_references(int *count);
 
 
 /**
@@ -75,34 +118,35 @@ int extern_exist();
 
 
 /**
- * Gets the head of the label list.
- * @return Pointer to the head of the label list.
+ * Gets the symbol table, for sweeps over its arrays.
+ * @return Pointer to the symbol table.
  */
-Symbol *get_label_head();
+Symbol_Table *get_symbol_table();
 
 
 /**
- * Gets the last label in the linked list.
- * @return Pointer to the last label in the list.
+ * Gets the name of a symbol.
+ * @param symbol The index of the symbol.
+ * @return The name of the symbol, valid until the next symbol is added.
  */
-Symbol *get_last_label();
+const char *symbol_name(int symbol);
 
 
 /**
- * Removes the last label in the linked list.
+ * Removes the last label in the table.
  */
 void remove_last_label();
 
 
 /**
- * Removes a specific label from the linked list.
- * @param label Pointer to the label to be removed.
+ * Removes a specific label from the table.
+ * @param symbol The index of the label to be removed.
  */
-void remove_label(const Symbol *label);
+void remove_label(int symbol);
 
 
 /**
- * Frees all the labels in the linked list.
+ * Frees all the labels in the table.
  */
 void free_labels();
 
@@ -0,0 +1,114 @@
+/**
+ * @file trace.c
+ * @brief Chrome trace-event export of the assembler stages.
+ *
+ * Events are appended to a buffer owned by the recording thread and are only
+ * formatted when the run ends, so recording costs a clock reading and a store.
+ * The assembler runs on a single thread, so there is one buffer and no locking;
+ * every buffer is written with its own "tid" so Perfetto shows one track per thread.
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <time.h>
+#include "trace.h"
+#include "util.h"
+#include "alloc.h"
+
+#define INITIAL_EVENTS 256
+#define MAIN_THREAD_ID 1
+
+/* A begin or end event of a span */
+typedef struct Trace_Event {
+    const char *name;
+    char phase; /* 'B' or 'E' */
+    double timestamp; /* Microseconds since tracing was enabled */
+} Trace_Event;
+
+/* Events recorded by one thread */
+typedef struct Trace_Buffer {
+    Trace_Event *events;
+    long count;
+    long capacity;
+    int thread_id;
+} Trace_Buffer;
+
+static char *trace_file_name = NULL;
+static Trace_Buffer main_buffer = {NULL, 0, 0, MAIN_THREAD_ID};
+static double start_time;
+static int overflow = 0; /* Set if events were dropped because memory ran out */
+
+/* Returns the monotonic clock in microseconds */
+static double now_us() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec * 1e6 + (double) now.tv_nsec / 1e3;
+}
+
+/* Appends an event to the buffer of the current thread */
+static void record(const char *name, char phase) {
+    Trace_Buffer *buffer = &main_buffer;
+    Trace_Event *new_events;
+    long new_capacity;
+
+    if (trace_file_name == NULL)
+        return; /* Tracing is disabled */
+    if (buffer->count == buffer->capacity) {
+        new_capacity = buffer->capacity ? buffer->capacity * 2 : INITIAL_EVENTS;
+        new_events = tracked_realloc(buffer->events, new_capacity * sizeof(Trace_Event), MEM_REPORTS);
+        if (new_events == NULL) {
+            overflow = 1;
+            return;
+        }
+        buffer->events = new_events;
+        buffer->capacity = new_capacity;
+    }
+    buffer->events[buffer->count].name = name;
+    buffer->events[buffer->count].phase = phase;
+    buffer->events[buffer->count].timestamp = now_us() - start_time;
+    buffer->count++;
+}
+
+void set_trace_file(char *file_name) {
+    trace_file_name = file_name;
+    start_time = now_us();
+}
+
+void trace_begin(const char *name) {
+    record(name, 'B');
+}
+
+void trace_end(const char *name) {
+    record(name, 'E');
+}
+
+int write_trace() {
+    Trace_Buffer *buffer = &main_buffer;
+    FILE *file;
+    long i;
+
+    if (trace_file_name == NULL)
+        return 0;
+    file = fopen(trace_file_name, "w");
+    if (file == NULL) {
+        printf("Error: can't create %s\n", trace_file_name);
+        tracked_free(buffer->events);
+        return 1;
+    }
+    fprintf(file, "{\"traceEvents\": [\n");
+    fprintf(file, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": "
+            "\"assembler\"}}", buffer->thread_id);
+    for (i = 0; i < buffer->count; i++) {
+        fprintf(file, ",\n{\"name\": ");
+        write_json_string(file, buffer->events[i].name);
+        fprintf(file, ", \"ph\": \"%c\", \"ts\": %.3f, \"pid\": 1, \"tid\": %d}", buffer->events[i].phase,
+                buffer->events[i].timestamp, buffer->thread_id);
+    }
+    fprintf(file, "\n], \"displayTimeUnit\": \"ms\"}\n");
+    fclose(file);
+    if (overflow)
+        printf("Warning: memory ran out while tracing, %s is incomplete\n", trace_file_name);
+    tracked_free(buffer->events);
+    buffer->events = NULL;
+    buffer->count = buffer->capacity = 0;
+    return 0;
+}
@@ -0,0 +1,31 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+/**
+ * Enables tracing; the events are written to the given file by write_trace.
+ * @param file_name The name of the Chrome trace-event file to create.
+ */
+void set_trace_file(char *file_name);
+
+
+/**
+ * Opens a span on the current thread. Does nothing if tracing is disabled.
+ * @param name The span name; must stay valid until write_trace is called.
+ */
+void trace_begin(const char *name);
+
+
+/**
+ * Closes the span most recently opened by trace_begin on the current thread.
+ * @param name The span name.
+ */
+void trace_end(const char *name);
+
+
+/**
+ * Writes all recorded events in Chrome trace-event format and frees the buffers.
+ * @return 0 on success, 1 if the file could not be written.
+ */
+int write_trace();
+
+#endif
@@ -0,0 +1,155 @@
+/**
+ * @file trusted.c
+ * @brief Fast path of the first pass for machine-generated sources.
+ *
+ * With "--trusted", an instruction line that is written as "name", "name op" or
+ * "name op, op" (the space after the comma is optional), after an optional "LABEL: ",
+ * is split and classified in one scan and encoded directly. A line is taken only when
+ * every check of the validating path would pass: a label or a label operand is made of
+ * letters and digits and is not a reserved word, a defined label is not the name of an
+ * extern label, an operand is a register, an immediate in range or a label, and its
+ * method is legal.
+ * Any other line, well formed or not, goes through the validating path, so the output
+ * and the error messages are the same as without the option. The label of any other line
+ * skips valid_name when it passes the same checks.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "trusted.h"
+#include "machine_code.h"
+#include "validations.h"
+#include "symbols_list.h"
+#include "report.h"
+#include "util.h"
+#include "const.h"
+
+static int enabled = 0;
+
+void set_trusted(int value) {
+    enabled = value;
+}
+
+/* Copies a word that ends at the stop character or at the end of the line, returns its length, 0 if it is not canonical */
+static size_t copy_word(const char *line, char stop, char *word) {
+    size_t length = 0;
+
+    while (line[length] != NULL_TERMINATOR && line[length] != stop) {
+        if (isspace((unsigned char) line[length]) || line[length] == COMMA || length == MAX_LINE_LENGTH - 1)
+            return 0;
+        word[length] = line[length];
+        length++;
+    }
+    word[length] = NULL_TERMINATOR;
+    return length;
+}
+
+/* Checks if a label of letters and digits is valid and not a reserved word */
+static int is_plain_label(const char *label) {
+    size_t length;
+
+    if (!isalpha((unsigned char) label[0]))
+        return 0;
+    for (length = 1; label[length] != NULL_TERMINATOR; length++)
+        if (!isalnum((unsigned char) label[length]))
+            return 0;
+    return length <= MAX_DECLARATION_LENGTH && get_instruct_id(label) == -1 && get_regis(label) == -1 &&
+           strcmp(label, MACRO_START) != 0 && strcmp(label, MACRO_END) != 0;
+}
+
+/* Gets the addressing method of an operand, -1 if the validating path must handle it */
+static int operand_method(const char *operand) {
+    const char *end;
+    long value;
+
+    if (operand[0] == HASH)
+        return parse_integer(operand + 1, &end, MIN_VALUE, MAX_VALUE, &value) == NUMBER_OK && end != operand + 1 &&
+               *end == NULL_TERMINATOR
+                   ? IMMEDIATE
+                   : -1;
+    if (operand[0] == AMPERSAND)
+        return is_plain_label(operand + 1) ? RELATIVE : -1;
+    if (get_regis(operand) != -1)
+        return DIRECT_REGISTER;
+    return is_plain_label(operand) ? DIRECT : -1;
+}
+
+/* Reads the operands of an instruction in canonical form, returns 0 if the validating path must handle them */
+static int read_operands(const char *line, int id, char *source, int *source_method, char *destination,
+                         int *destination_method) {
+    size_t length;
+
+    switch (INSTRUCTIONS[id].operands_num) {
+        case 0:
+            return *line == NULL_TERMINATOR;
+        case 1:
+            if (*line++ != SPACE || copy_word(line, NULL_TERMINATOR, destination) == 0)
+                return 0;
+            *destination_method = operand_method(destination);
+            return *destination_method != -1 && LEGAL_METHODS[id] >> *destination_method & 1;
+        case TWO:
+            if (*line++ != SPACE || (length = copy_word(line, COMMA, source)) == 0 || line[length] != COMMA)
+                return 0;
+            line += length + 1;
+            if (*line == SPACE)
+                line++;
+            if (copy_word(line, NULL_TERMINATOR, destination) == 0)
+                return 0;
+            *source_method = operand_method(source);
+            *destination_method = operand_method(destination);
+            return *source_method != -1 && *destination_method != -1 &&
+                   LEGAL_METHODS[id] >> (SOURCE_METHODS_POS + *source_method) & 1 &&
+                   LEGAL_METHODS[id] >> *destination_method & 1;
+        default:
+            return 0;
+    }
+}
+
+int trusted_label(const char *label) {
+    /* A label passes valid_name when it is plain and no extern label has its name */
+    return enabled && is_plain_label(label) && !is_extern_name(label);
+}
+
+int trusted_instruction(Code **code_head, int *usage, int *IC, const char *line, int *error, FILE *file) {
+    char label[MAX_LINE_LENGTH], name[MAX_LINE_LENGTH], source[MAX_LINE_LENGTH], destination[MAX_LINE_LENGTH];
+    int id, source_method = IMMEDIATE, destination_method = IMMEDIATE;
+    size_t length;
+
+    if (!enabled || (length = copy_word(line, SPACE, name)) == 0)
+        return 0;
+    label[0] = NULL_TERMINATOR;
+    if (name[length - 1] == COLON) {
+        name[length - 1] = NULL_TERMINATOR;
+        if (!trusted_label(name) || line[length] != SPACE)
+            return 0;
+        strcpy(label, name);
+        line += length + 1;
+        if ((length = copy_word(line, SPACE, name)) == 0)
+            return 0;
+    }
+    if ((id = get_instruct_id(name)) == -1 ||
+        !read_operands(line + length, id, source, &source_method, destination, &destination_method))
+        return 0;
+
+    if (label[0] != NULL_TERMINATOR && add_symbol(label, *IC, CODE) == NO_SYMBOL) {
+        /* Indicates memory allocation failed */
+        if (file != NULL)
+            fclose(file);
+        free_labels();
+        exit(1); /* Exiting program */
+    }
+    switch (INSTRUCTIONS[id].operands_num) {
+        case 0:
+            add_instruction_code(code_head, usage, IC, FIRST_WORDS[id][IMMEDIATE][IMMEDIATE], error);
+            report_instruction(id);
+            break;
+        case 1:
+            handle_one_operand(code_head, usage, IC, file, destination_method, destination, id, error);
+            break;
+        default:
+            handle_two_operands(code_head, usage, IC, file, source, destination, id, error, source_method,
+                                destination_method);
+    }
+    return 1;
+}
@@ -0,0 +1,38 @@
+#ifndef TRUSTED_H
+#define TRUSTED_H
+
+#include <stdio.h>
+#include "code_list.h"
+
+/**
+ * Enables the fast path of the first pass for instruction lines in canonical form.
+ * @param enabled 1 to enable the fast path, 0 to disable it.
+ */
+void set_trusted(int enabled);
+
+
+/**
+ * Checks if the fast path is enabled and a label definition is known to pass valid_name:
+ * it is made of letters and digits, is not a reserved word and is not an extern label.
+ * @param label The label without the colon.
+ * @return 1 if the label is valid, 0 if valid_name must check it.
+ */
+int trusted_label(const char *label);
+
+
+/**
+ * Encodes an instruction line if the fast path is enabled and the line is in canonical
+ * form ("name", "name op" or "name op, op" after an optional "LABEL: ") with a label and
+ * operands the validating path accepts. Any other line is left untouched for the
+ * validating path.
+ * @param code_head Pointer to the head of the code list.
+ * @param usage Pointer to the memory usage counter.
+ * @param IC Pointer to the instruction counter.
+ * @param line The trimmed line.
+ * @param error Pointer to the error flag.
+ * @param file The file being scanned, closed if memory allocation fails.
+ * @return 1 if the line was encoded, 0 if it must go through the validating path.
+ */
+int trusted_instruction(Code **code_head, int *usage, int *IC, const char *line, int *error, FILE *file);
+
+#endif
@@ -15,6 +15,14 @@
 #include "util.h"
 #include "symbols_list.h"
 #include "const.h"
+#include "stats.h"
+#include "alloc.h"
+#include "hash_table.h"
+#include "object_file.h"
+#include "source_map.h"
+
+/* Whether the .ext file lists the uses of every extern label together */
+static int group_externs = 0;
 
 void delete_file(char *filename) {
     if (remove(filename) != 0)
@@ -27,7 +35,7 @@ char *add_extension(char *name, char *extension) {
     size_t name_len = strlen(name);
     size_t extension_len = strlen(extension);
 
-    new_name = (char *) malloc(name_len + extension_len + 1);
+    new_name = (char *) tracked_malloc(name_len + extension_len + 1, MEM_STRINGS);
     if (new_name == NULL) {
         printf("Error: Memory allocation failed");
         free_labels();
@@ -74,118 +82,59 @@ int contains_whitespace(char *str) {
     return 0; /* Indicates no whitespace character found */
 }
 
-int *get_numbers(char *file_name, int line_num, FILE *file, char *line, int *num_count) {
-    int *result;
-    char buffer[BUFFER_SIZE];
-    int numbers[MAX_DATA_NUM];
-    int temp_count = 0, i = 0, last_was_comma = 0, num, j;
-    size_t length = strlen(line);
-
-    while (i < length && isspace(line[i])) /* Skipping leading whitespace */
-        i++;
-
-    if (!isdigit(line[i]) && line[i] != MINUS && line[i] != PLUS) {
-        /* Checking for an invalid character */
-        if (line[i] == COMMA) {
-            print_error("Instruction \".data\" has an illegal comma following the instruction label", file_name,
-                        line_num);
-            return NULL;
-        }
-        print_error("Instruction \".data\" has illegal characters, only integers allowed", file_name, line_num);
-        return NULL;
-    }
-    while (i < length) {
-        while (i < length && isspace(line[i])) /* Skipping whitespace characters */
-            i++;
-        if (i >= length)
-            break;
-        /* Checking for a number with an optional sign */
-        if (isdigit(line[i]) || ((line[i] == MINUS || line[i] == PLUS) && isdigit(line[i + 1]))) {
-            last_was_comma = 0;
-            j = 0;
-
-            if (line[i] == MINUS || line[i] == PLUS) /* Handling optional sign */
-                buffer[j++] = line[i++];
-            while (i < length && isdigit(line[i])) /* Getting the number */
-                buffer[j++] = line[i++];
-
-            /* Checking for an invalid character after the number */
-            if (i < length && !isspace(line[i]) && line[i] != COMMA && line[i] != MINUS && line[i] != PLUS) {
-                print_error("Instruction \".data\" has illegal characters, only integers allowed", file_name, line_num);
-                return NULL;
-            }
-            buffer[j] = NULL_TERMINATOR;
-            num = atoi(buffer);
-
-            /* Checking if the number is in range */
-            if (num < MIN_24BIT || num > MAX_24BIT) {
-                print_error("Instruction \".data\" has a number that is out of range", file_name, line_num);
-                return NULL;
-            }
-            /* Adding the number to the array */
-            numbers[temp_count] = num;
-            temp_count++;
-
-            while (i < length && isspace(line[i])) /* Skipping whitespace characters after the number */
-                i++;
-
-            if (i < length && line[i] == COMMA) {
-                /* Checking for a comma after the number */
-                last_was_comma = 1;
-                i++;
-            } else if (i < length && line[i] != COMMA) {
-                print_error("Instruction \".data\" has a missing comma", file_name, line_num);
-                return NULL;
-            }
-        } else {
-            print_error("Instruction \".data\" has illegal characters, only integers allowed", file_name, line_num);
-            return NULL;
-        }
-        /* Checking for multiple consecutive commas */
-        if (last_was_comma) {
-            while (i < length && isspace(line[i]))
-                i++;
-
-            if (i < length && line[i] == COMMA) {
-                print_error("Instruction \".data\" has multiple consecutive commas", file_name, line_num);
-                return NULL;
-            }
-        }
-    }
-    if (last_was_comma) {
-        print_error("Instruction \".data\" expects an integer after the last comma", file_name, line_num);
-        return NULL;
+int parse_integer(const char *str, const char **end, long min, long max, long *value) {
+    const char *p = str;
+    unsigned long magnitude = 0, limit;
+    int negative = 0, digit, overflow = 0;
+
+    if (*p == MINUS || *p == PLUS)
+        negative = *p++ == MINUS;
+    if (!isdigit((unsigned char) *p)) {
+        *end = str;
+        return NUMBER_INVALID;
     }
-    result = (int *) malloc(temp_count * sizeof(int));
-    if (result == NULL) {
-        /* Indicates memory allocation failed (all other allocations were freed inside function) */
-        fclose(file);
-        exit(1); /* Exiting program */
+    /* The magnitude of min is computed without overflowing a long */
+    limit = negative ? (unsigned long) -(min + 1) + 1 : (unsigned long) max;
+    for (; isdigit((unsigned char) *p); p++) {
+        digit = *p - '0';
+        if (magnitude > (limit - digit) / DECIMAL_BASE)
+            overflow = 1; /* The rest of the digits are still skipped */
+        else
+            magnitude = magnitude * DECIMAL_BASE + digit;
     }
-    memcpy(result, numbers, temp_count * sizeof(int));
-    *num_count = temp_count;
-
-    return result;
+    *end = p;
+    if (overflow)
+        return NUMBER_OUT_OF_RANGE;
+    *value = negative ? (magnitude == 0 ? 0 : -(long) (magnitude - 1) - 1) : (long) magnitude;
+    return NUMBER_OK;
 }
 
-char *get_first_word(char *str) {
-    char *first_word;
-    /* Finding the length of the first word */
-    int length = 0;
-    while (str[length] != NULL_TERMINATOR && !isspace(str[length])) {
+size_t copy_first_word(const char *str, char *word) {
+    size_t length = 0;
+
+    /* The word goes into the caller's buffer, so reading a line allocates nothing */
+    while (str[length] != NULL_TERMINATOR && !isspace((unsigned char) str[length]) && length < MAX_LINE_LENGTH - 1) {
+        word[length] = str[length];
         length++;
     }
-    /* Allocating memory for the first word */
-    first_word = (char *) malloc((length + 1) * sizeof(char));
-    if (first_word == NULL) {
-        printf("Error: Memory allocation failed");
-        return NULL; /* Indicates memory allocation failed */
-    }
+    word[length] = NULL_TERMINATOR;
+    return length;
+}
 
-    strncpy(first_word, str, length); /* Copying the first word to the allocated memory */
-    first_word[length] = NULL_TERMINATOR; /* Null-terminating the string */
+int read_text_line(const char **text, char *line) {
+    size_t length = 0;
 
-    return first_word;
+    if (**text == NULL_TERMINATOR)
+        return 0;
+    /* Like fgets, a line longer than the buffer is read in parts */
+    while ((*text)[length] != NULL_TERMINATOR && length < MAX_LINE_LENGTH - 1) {
+        line[length] = (*text)[length];
+        if ((*text)[length++] == '\n')
+            break;
+    }
+    line[length] = NULL_TERMINATOR;
+    *text += length;
+    return 1;
 }
 
 /* Checks if word appears alone in string */
@@ -215,20 +164,22 @@ void create_ob_file(char *file_ob_name, Code *code_head, Data *data_head, const
     fprintf(file_ob, "%7d %d\n", (*IC) - IC_INITIAL, *DC);
     /* Writing machine code into file */
     for (; i < *IC; i++) {
-        fprintf(file_ob, "%07d %06x\n", i, code_head->value);
+        fprintf(file_ob, "%07d %0*x\n", i, WORD_DIGITS, code_head->value);
         code_head = code_head->next;
     }
     for (; j < *DC + *IC; j++) {
-        fprintf(file_ob, "%07d %06x\n", j, data_head->value);
+        fprintf(file_ob, "%07d %0*x\n", j, WORD_DIGITS, data_head->value);
         data_head = data_head->next;
     }
 
+    stats_add(COUNT_BYTES_OUT, ftell(file_ob));
     fclose(file_ob);
 }
 
 void create_ent_file(char *file_ent_name) {
     FILE *file_ent = fopen(file_ent_name, "w");
-    Symbol *current;
+    const Symbol_Table *table = get_symbol_table();
+    int i;
 
     if (file_ent == NULL) {
         /* Failed to open file for writing */
@@ -238,19 +189,33 @@ void create_ent_file(char *file_ent_name) {
         exit(1); /* Exiting program */
     }
 
-    current = get_label_head();
-    while (current != NULL) {
-        if (current->type == ENTRY) {
-            fprintf(file_ent, "%s %07d\n", current->label, current->address);
+    for (i = 0; i < table->count; i++) {
+        if (table->types[i] == ENTRY) {
+            fprintf(file_ent, "%s %07d\n", table->names + table->name_offsets[i], table->addresses[i]);
         }
-        current = current->next;
     }
+    stats_add(COUNT_BYTES_OUT, ftell(file_ent));
     fclose(file_ent);
 }
 
+void set_extern_grouping(int enabled) {
+    group_externs = enabled;
+}
+
+/* Orders extern uses by label, then by address */
+static int compare_references(const void *first, const void *second) {
+    const Extern_Reference *a = first, *b = second;
+
+    if (a->symbol != b->symbol)
+        return a->symbol < b->symbol ? -1 : 1;
+    return a->address < b->address ? -1 : a->address > b->address;
+}
+
 void create_ext_file(char *file_ext_name) {
     FILE *file_ext = fopen(file_ext_name, "w");
-    Symbol *current;
+    const Extern_Reference *references;
+    Extern_Reference *sorted = NULL;
+    int i, count;
 
     if (file_ext == NULL) {
         /* Failed to open file for writing */
@@ -260,16 +225,192 @@ void create_ext_file(char *file_ext_name) {
         exit(1); /* Exiting program */
     }
 
-    current = get_label_head();
-    while (current != NULL) {
-        if (current->type == EXTERN && current->address != 0) {
-            fprintf(file_ext, "%s %07d\n", current->label, current->address);
-        }
-        current = current->next;
+    references = get_extern_references(&count);
+    if (group_externs && count > 1)
+        sorted = tracked_malloc(count * sizeof(Extern_Reference), MEM_TEMP);
+    if (sorted != NULL) {
+        /* Grouping the uses by extern label, in the order the labels were declared */
+        memcpy(sorted, references, count * sizeof(Extern_Reference));
+        qsort(sorted, count, sizeof(Extern_Reference), compare_references);
+        references = sorted;
     }
+    for (i = 0; i < count; i++)
+        fprintf(file_ext, "%s %07d\n", symbol_name(references[i].symbol), references[i].address);
+    tracked_free(sorted);
+    stats_add(COUNT_BYTES_OUT, ftell(file_ext));
     fclose(file_ext);
 }
 
+/* Writes a 32-bit little-endian field, returns the position after it */
+static unsigned char *put_field(unsigned char *p, unsigned long value) {
+    p[0] = (unsigned char) (value & 0xff);
+    p[1] = (unsigned char) ((value >> 8) & 0xff);
+    p[2] = (unsigned char) ((value >> 16) & 0xff);
+    p[3] = (unsigned char) ((value >> 24) & 0xff);
+    return p + SYMBOL_FILE_FIELD;
+}
+
+/* Gets the symbol file type of a label, 0 if the label is not exported */
+static int exported_type(int type, int address, int ICF) {
+    switch (type) {
+        case CODE:
+            return SYMBOL_CODE;
+        case DATA:
+            return SYMBOL_DATA;
+        case EXTERN:
+            return SYMBOL_EXTERN;
+        case ENTRY:
+            /* An entry keeps the address of the code or data label it was declared for */
+            return SYMBOL_ENTRY + (address < ICF ? SYMBOL_CODE : SYMBOL_DATA);
+        default:
+            return 0;
+    }
+}
+
+int create_sym_file(char *file_sym_name, const int *IC) {
+    const Symbol_Table *table = get_symbol_table();
+    const Extern_Reference *references;
+    unsigned char *buffer, *p, *buckets, *symbols;
+    int *exported;
+    int i, count = 0, references_count, status = 0;
+    unsigned long buckets_count = 1, names_size = 0, size, bucket, mask;
+    FILE *file_sym;
+
+    references = get_extern_references(&references_count);
+    exported = tracked_malloc((table->count + 1) * sizeof(int), MEM_TEMP);
+    if (exported == NULL) {
+        printf("Error: Memory allocation failed\n");
+        return 1;
+    }
+    /* Numbering the exported labels */
+    for (i = 0; i < table->count; i++) {
+        exported[i] = exported_type(table->types[i], table->addresses[i], *IC) ? count++ : -1;
+        if (exported[i] >= 0)
+            names_size += strlen(symbol_name(i)) + 1;
+    }
+    while (buckets_count < 2 * (unsigned long) count)
+        buckets_count *= 2; /* At most half full */
+    size = SYMBOL_FILE_HEADER + buckets_count * SYMBOL_FILE_FIELD + count * SYMBOL_FILE_RECORD +
+           references_count * SYMBOL_FILE_REFERENCE + names_size + 1;
+    buffer = tracked_malloc(size, MEM_TEMP);
+    if (buffer == NULL) {
+        printf("Error: Memory allocation failed\n");
+        tracked_free(exported);
+        return 1;
+    }
+    memset(buffer, 0, size);
+
+    memcpy(buffer, SYMBOL_FILE_MAGIC, SYMBOL_FILE_FIELD);
+    p = put_field(buffer + SYMBOL_FILE_FIELD, (unsigned long) count);
+    p = put_field(p, buckets_count);
+    p = put_field(p, (unsigned long) references_count);
+    p = put_field(p, names_size + 1);
+    buckets = p;
+    symbols = buckets + buckets_count * SYMBOL_FILE_FIELD;
+    p = symbols + count * SYMBOL_FILE_RECORD;
+    for (i = 0; i < references_count; i++) {
+        p = put_field(p, (unsigned long) exported[references[i].symbol]);
+        p = put_field(p, (unsigned long) references[i].address);
+    }
+    /* The names follow the records, the pool ends with an empty name */
+    names_size = 0;
+    mask = buckets_count - 1;
+    for (i = 0; i < table->count; i++) {
+        if (exported[i] < 0)
+            continue;
+        put_field(put_field(put_field(symbols + exported[i] * SYMBOL_FILE_RECORD, names_size),
+                            (unsigned long) table->addresses[i]),
+                  (unsigned long) exported_type(table->types[i], table->addresses[i], *IC));
+        strcpy((char *) p + names_size, symbol_name(i));
+        names_size += strlen(symbol_name(i)) + 1;
+        for (bucket = hash_string(symbol_name(i)) & mask; buckets[bucket * SYMBOL_FILE_FIELD] != 0 ||
+             buckets[bucket * SYMBOL_FILE_FIELD + 1] != 0 || buckets[bucket * SYMBOL_FILE_FIELD + 2] != 0 ||
+             buckets[bucket * SYMBOL_FILE_FIELD + 3] != 0; bucket = (bucket + 1) & mask);
+        put_field(buckets + bucket * SYMBOL_FILE_FIELD, (unsigned long) exported[i] + 1);
+    }
+
+    file_sym = fopen(file_sym_name, "wb");
+    if (file_sym == NULL || fwrite(buffer, 1, size, file_sym) != size) {
+        printf("Error: Failed to write %s\n", file_sym_name);
+        status = 1;
+    }
+    if (file_sym != NULL) {
+        stats_add(COUNT_BYTES_OUT, (long) size);
+        fclose(file_sym);
+    }
+    tracked_free(buffer);
+    tracked_free(exported);
+    return status;
+}
+
+int create_dbg_file(char *file_dbg_name, const int *IC) {
+    Source_Origin origin;
+    unsigned char *buffer, *p;
+    unsigned long *name_offsets;
+    int i, count = 0, macros = source_macros_count(), status = 0;
+    unsigned long names_size = 0, size;
+    FILE *file_dbg;
+
+    while (get_source_origin(count, &origin))
+        count++;
+    name_offsets = tracked_malloc((macros + 1) * sizeof(unsigned long), MEM_TEMP);
+    if (name_offsets == NULL) {
+        printf("Error: Memory allocation failed\n");
+        return 1;
+    }
+    for (i = 0; i < macros; i++) {
+        name_offsets[i] = names_size;
+        names_size += strlen(source_macro_name(i)) + 1;
+    }
+    size = DEBUG_FILE_HEADER + count * DEBUG_FILE_RECORD + names_size + 1;
+    buffer = tracked_malloc(size, MEM_TEMP);
+    if (buffer == NULL) {
+        printf("Error: Memory allocation failed\n");
+        tracked_free(name_offsets);
+        return 1;
+    }
+    memset(buffer, 0, size);
+
+    memcpy(buffer, DEBUG_FILE_MAGIC, SYMBOL_FILE_FIELD);
+    p = put_field(buffer + SYMBOL_FILE_FIELD, (unsigned long) *IC);
+    p = put_field(p, (unsigned long) count);
+    p = put_field(p, names_size + 1);
+    for (i = 0; i < count; i++) {
+        get_source_origin(i, &origin);
+        p = put_field(p, (unsigned long) origin.address);
+        p = put_field(p, (unsigned long) origin.line);
+        p = put_field(p, (unsigned long) origin.macro_line);
+        p = put_field(p, origin.macro != NO_MACRO ? name_offsets[origin.macro] + 1 : 0);
+    }
+    /* The names follow the records, the pool ends with an empty name */
+    for (i = 0; i < macros; i++)
+        strcpy((char *) p + name_offsets[i], source_macro_name(i));
+
+    file_dbg = fopen(file_dbg_name, "wb");
+    if (file_dbg == NULL || fwrite(buffer, 1, size, file_dbg) != size) {
+        printf("Error: Failed to write %s\n", file_dbg_name);
+        status = 1;
+    }
+    if (file_dbg != NULL) {
+        stats_add(COUNT_BYTES_OUT, (long) size);
+        fclose(file_dbg);
+    }
+    tracked_free(buffer);
+    tracked_free(name_offsets);
+    return status;
+}
+
+void write_json_string(FILE *file, const char *str) {
+    fputc('"', file);
+    for (; *str; str++) {
+        if (*str == '"' || *str == '\\')
+            fputc('\\', file);
+        if ((unsigned char) *str >= ' ')
+            fputc(*str, file); /* Control characters are dropped */
+    }
+    fputc('"', file);
+}
+
 /* Prints error with filename and line number */
 void print_error(char *msg, char *file, int line) {
     printf("Error in %s line %d: %s\n", file, line, msg);
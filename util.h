@@ -40,25 +40,40 @@ char *trim_whitespace(char *str);
 int contains_whitespace(char *str);
 
 
+/* Results of parse_integer */
+#define NUMBER_OK 0
+#define NUMBER_INVALID 1
+#define NUMBER_OUT_OF_RANGE 2
+
+/**
+ * Parses a decimal integer with an optional sign, checking its range while the digits are read,
+ * so a number of any length cannot overflow.
+ * @param str The start of the number.
+ * @param end Set to the first character after the digits (to str if there are none).
+ * @param min The smallest allowed value.
+ * @param max The largest allowed value, min must be -(max + 1).
+ * @param value The parsed value, set only on success.
+ * @return NUMBER_OK, NUMBER_INVALID if there are no digits, or NUMBER_OUT_OF_RANGE.
+ */
+int parse_integer(const char *str, const char **end, long min, long max, long *value);
+
+
 /**
- * Parses the numbers from the given line and returns them as an array.
- * @param file_name The name of the file being processed.
- * @param line_num The line number in the file.
- * @param file The file pointer associated with the line.
- * @param line Pointer to the structure representing the current line of code being processed.
- * @param line The current position in the line.
- * @param num_count Pointer to an integer to store the count of numbers found.
- * @return Pointer to an array of integers containing the parsed numbers.
+ * Copies the first word of a string into a buffer.
+ * @param str The string to copy the first word from.
+ * @param word Buffer of MAX_LINE_LENGTH characters, receives the word.
+ * @return The length of the word.
  */
-int *get_numbers(char *file_name, int line_num, FILE *file, char *line, int *num_count);
+size_t copy_first_word(const char *str, char *word);
 
 
 /**
- * Gets the first word from a string.
- * @param str The string to extract the first word from.
- * @return Pointer to the first word, or NULL if memory allocation failed.
+ * Reads the next line of a text in memory, the way fgets reads the next line of a file.
+ * @param text Pointer to the rest of the text, moved past the line.
+ * @param line Buffer of MAX_LINE_LENGTH characters, receives the line.
+ * @return 1 if a line was read, 0 at the end of the text.
  */
-char *get_first_word(char *str);
+int read_text_line(const char **text, char *line);
 
 
 /**
@@ -89,12 +104,51 @@ void create_ent_file(char *file_ent_name);
 
 
 /**
- * Creates an external file (.ext) with external labels.
+ * Creates an external file (.ext) with a line for every use of an external label.
  * @param file_ext_name The name of the external file to create.
  */
 void create_ext_file(char *file_ext_name);
 
 
+/**
+ * Selects the order of the .ext file lines.
+ * @param enabled 1 to list the uses of every external label together, 0 to list all the
+ *                uses in address order.
+ */
+void set_extern_grouping(int enabled);
+
+
+/**
+ * Creates the binary symbol file (.sym) of the code and data, entry and extern labels.
+ * The format is described in object_file.h; the file has a hashed index, so a reader
+ * can look up a label without scanning the table.
+ * @param file_sym_name The name of the symbol file.
+ * @param IC Pointer to the final instruction counter, where the data labels start.
+ * @return 0 on success, 1 if memory allocation or writing failed.
+ */
+int create_sym_file(char *file_sym_name, const int *IC);
+
+
+/**
+ * Creates the binary debug file (.dbg) that maps every instruction of the code to its
+ * line in the .as file and the macro it was expanded from. The format is described in
+ * object_file.h; the records are sorted by address, so a reader finds an address with
+ * a binary search.
+ * @param file_dbg_name The name of the debug file.
+ * @param IC Pointer to the final instruction counter, the end of the code.
+ * @return 0 on success, 1 if memory allocation or writing failed.
+ */
+int create_dbg_file(char *file_dbg_name, const int *IC);
+
+
+/**
+ * Writes a string as a JSON string literal, escaping quotes and backslashes.
+ * @param file The file to write to.
+ * @param str The string to write.
+ */
+void write_json_string(FILE *file, const char *str);
+
+
 /**
  * Prints an error message with file label and line number
  * @param error_msg Message to print
@@ -0,0 +1,20 @@
+.entry MAIN
+.entry DONE
+.extern EXT
+MAIN: mov r1, r1
+LOOP: inc r2
+ dec r2
+ inc r3
+MID: dec r3
+ cmp r1, #1
+ cmp r2, X
+ bne &LOOP
+ bne LOOP
+SKIP: mov r4, r4
+ jmp &SKIP
+ jsr EXT
+ jmp MID
+DONE: prn X
+ stop
+X: .data 5
+.entry X
@@ -0,0 +1,18 @@
+.entry API
+MAIN: jsr &F
+ bne &L
+ prn N1
+ stop
+DEAD: prn N2
+ inc r1
+ rts
+F: inc r2
+ rts
+L: dec r3
+ stop
+API: prn N3
+ rts
+N1: .data 1
+N2: .data 2, 3
+N3: .data 4
+UNUSED: .string "ab"
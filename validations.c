@@ -14,12 +14,14 @@
 #include "util.h"
 #include "symbols_list.h"
 #include "machine_code.h"
+#include "hash_table.h"
 #include "const.h"
+#include "report.h"
+#include "alloc.h"
 
 /* Function to check if a name is valid */
 int valid_name(char *name, int line_num, char *file_name, Type type) {
     int i = 0;
-    Symbol *symbol;
     /* Checking if the name is empty */
     if (*name == NULL_TERMINATOR) {
         print_error_type("Invalid declaration, no name was defined", file_name, line_num, TYPES[type]);
@@ -52,53 +54,40 @@ int valid_name(char *name, int line_num, char *file_name, Type type) {
     if (is_reserved_word(file_name, name, line_num, type)) {
         return 0; /* Indicates  name is not valid */
     }
-    if (type == LABEL) {
-        symbol = is_symbol_name(name);
-        if (symbol != NULL) {
-            if (symbol->type == EXTERN) {
-                print_error_type(
-                    "Invalid label declaration, local label name cannot be the same as an external label name",
-                    file_name, line_num, TYPES[type]);
-                return 0; /* Indicates name label is not valid */
-            }
-            if (symbol->type == LABEL) {
-                print_error("Invalid label declaration, this label name is already in use", file_name, line_num);
-                return 0; /* Indicates name label is not valid */
-            }
-        }
+    /* A local label and an extern label of the same name cannot both be in the table, so only the externs are searched */
+    if (type == LABEL && is_extern_name(name)) {
+        print_error_type("Invalid label declaration, local label name cannot be the same as an external label name",
+                         file_name, line_num, TYPES[type]);
+        return 0; /* Indicates name label is not valid */
     }
     return 1; /* Indicates  name is valid */
 }
 
 /* Function to check if a string is a valid instruction */
 int get_instruct_id(const char *str) {
-    int i = 0;
+    int i;
 
     if (str == NULL) /* Indicates string is not instruction */
         return -1;
 
-    /* Comparing the string with each of the system instruction */
-    for (; i < INSTRUCTIONS_COUNT; i++) {
-        if (strcmp(str, INSTRUCTIONS[i].instruction) == 0) {
-            return i; /* Returning the index of the matching instruction */
-        }
-    }
+    /* Only the instruction in the slot of the hash can match */
+    i = INSTRUCTION_SLOTS[hash_string(str) % INSTRUCTION_SLOTS_COUNT];
+    if (i >= 0 && strcmp(str, INSTRUCTIONS[i].instruction) == 0)
+        return i; /* Returning the index of the matching instruction */
     return -1; /* Indicates string is not an instruction */
 }
 
 /* Function to check if a string is a valid register */
 int get_regis(const char *str) {
-    int i = 0;
+    int i;
 
     if (str == NULL) /* Indicates string is not a register */
         return -1;
 
-    /* Comparing the string with each of the system registers */
-    for (; i < REGISTERS_COUNT; i++) {
-        if (strcmp(str, REGISTERS[i]) == 0) {
-            return i; /* Returning the index of the matching register */
-        }
-    }
+    /* Only the register in the slot of the hash can match */
+    i = REGISTER_SLOTS[hash_string(str) % REGISTER_SLOTS_COUNT];
+    if (i >= 0 && strcmp(str, REGISTERS[i]) == 0)
+        return i; /* Returning the index of the matching register */
     return -1; /* Indicates string is not a register */
 }
 
@@ -120,8 +109,9 @@ int get_prompt(const char *str) {
 
 /* Function to check if a string is a valid addressing method */
 int get_addressing_method(char *operand, char *file_name, int line_num) {
-    char *endline;
+    const char *endline;
     long val;
+    int status;
 
     if (operand[0] == HASH) {
         operand++;
@@ -131,15 +121,15 @@ int get_addressing_method(char *operand, char *file_name, int line_num) {
                         file_name, line_num);
             return -1; /* Indicates failure */
         }
-        val = strtol(operand, &endline,DECIMAL_BASE);
+        status = parse_integer(operand, &endline, MIN_VALUE, MAX_VALUE, &val);
         /* Checking if the conversion was successful */
-        if (*endline != NULL_TERMINATOR || endline == operand) {
+        if (status == NUMBER_INVALID || *endline != NULL_TERMINATOR) {
             print_error("This operand is invalid for an 'IMMEDIATE' method type, only integers allowed", file_name,
                         line_num);
             return -1; /* Indicates failure */
         }
         /* Checking if the number is in range */
-        if (val < MIN_21BIT || val > MAX_21BIT) {
+        if (status == NUMBER_OUT_OF_RANGE) {
             print_error("This operand is out of range for an 'IMMEDIATE' method type", file_name, line_num);
             return -1; /* Indicates failure */
         }
@@ -186,14 +176,14 @@ int is_reserved_word(char *file_name, const char *str, int line_num, Type type)
 /* Function to check if a line is a "data prompt" line */
 int is_data_prompt(Data **data_head, int *usage, int *DC, int line_num, char *file_name, FILE *file, char *line,
                    char *current_word, int *error, char *label) {
-    Symbol *symbol;
+    int symbol;
     if (strcmp(label, "") != 0) {
         symbol = add_symbol(label, *DC, DATA);
-        if (!symbol) {
+        if (symbol == NO_SYMBOL) {
             /* Indicates memory allocation failed */
-            free(current_word);
-            fclose(file);
-            free(file_name);
+            if (file != NULL)
+                fclose(file);
+            tracked_free(file_name);
             free_labels();
             exit(1); /* Exiting program */
         }
@@ -210,7 +200,7 @@ int is_data_prompt(Data **data_head, int *usage, int *DC, int line_num, char *fi
 /* Function to check if a line is an "instruction" line */
 int is_instruction(Code **code_head, int *usage, int *IC, char *line, int line_num, FILE *file, char *file_name,
                    char *current_word, int *error, char *label) {
-    Symbol *symbol;
+    int symbol;
     size_t curr_word_len = strlen(current_word);
     /* Checking for a potential instruction */
     int instruct_id = get_instruct_id(current_word);
@@ -220,11 +210,11 @@ int is_instruction(Code **code_head, int *usage, int *IC, char *line, int line_n
         line += curr_word_len; /* Skipping the first word */
         if (strcmp(label, "") != 0) {
             symbol = add_symbol(label, *IC, CODE);
-            if (symbol == NULL) {
+            if (symbol == NO_SYMBOL) {
                 /* Indicates memory allocation failed */
-                free(current_word);
-                fclose(file);
-                free(file_name);
+                if (file != NULL)
+                    fclose(file);
+                tracked_free(file_name);
                 free_labels();
                 exit(1); /* Exiting program */
             }
@@ -242,54 +232,20 @@ int is_instruction(Code **code_head, int *usage, int *IC, char *line, int line_n
 
 /* Function to check if an instruction is valid */
 int is_method_legal(char *file_name, int line_num, int method, int instruct_id, int operands_num) {
-    /* Getting the legal methods for the current instruction */
     if (operands_num == 1) {
         /* Indicates operand is of type "destination" */
-        switch (INSTRUCTIONS[instruct_id].destination_methods) {
-            case METHODS_1_2:
-                if (method != DIRECT && method != RELATIVE) {
-                    print_error("This instruction uses an illegal method for a destination operand", file_name,
-                                line_num);
-                    return 0; /* Indicates method is illegal */
-                }
-                return 1; /* Indicates method is legal */
-            case METHODS_1_3:
-                if (method != DIRECT && method != DIRECT_REGISTER) {
-                    print_error("This instruction uses an illegal method for a destination operand", file_name,
-                                line_num);
-                    return 0; /* Indicates method is illegal */
-                }
-                return 1;
-            case METHODS_0_1_3:
-                if (method == RELATIVE) {
-                    print_error("This instruction uses an illegal method for a destination operand", file_name,
-                                line_num);
-                    return 0; /* Indicates method is illegal */
-                }
-                return 1;
-            default: /* Indicates method is illegal */
-                print_error("This instruction uses an illegal method for a destination operand", file_name, line_num);
-                return 0;
+        if (!(LEGAL_METHODS[instruct_id] >> method & 1)) {
+            print_error("This instruction uses an illegal method for a destination operand", file_name, line_num);
+            return 0; /* Indicates method is illegal */
         }
+        return 1; /* Indicates method is legal */
     }
     /* If this line was reached then operand is of type "source" */
-    switch (INSTRUCTIONS[instruct_id].source_methods) {
-        case METHOD_1:
-            if (method != DIRECT) {
-                print_error("This instruction uses an illegal method for a source operand", file_name, line_num);
-                return 0; /* Indicates method is illegal */
-            }
-            return 1;
-        case METHODS_0_1_3:
-            if (method == RELATIVE) {
-                print_error("This instruction uses an illegal method for a destination operand", file_name, line_num);
-                return 0; /* Indicates method is illegal */
-            }
-            return 1;
-        default: /* Indicates method is illegal */
-            print_error("This instruction uses an illegal method for a source operand", file_name, line_num);
-            return 0;
+    if (!(LEGAL_METHODS[instruct_id] >> (SOURCE_METHODS_POS + method) & 1)) {
+        print_error("This instruction uses an illegal method for a source operand", file_name, line_num);
+        return 0; /* Indicates method is illegal */
     }
+    return 1; /* Indicates method is legal */
 }
 
 /* Function to check if a line is a "data" line */
@@ -362,13 +318,14 @@ int is_string(Data **data_head, int *usage, int *DC, int line_num, char *file_na
     }
     add_data_code(data_head, DC, 0); /* Adding the null-terminator */
     *usage += 1; /* Incrementing usage count */
+    report_string_words((long) line_len + 1);
     return 1;
 }
 
 /* Function to check if a line is an "extern" line */
 int is_extern(int line_num, char *file_name, FILE *file, char *line, int *error, char *current_word) {
-    Symbol *symbol;
-    Symbol *temp_symbol;
+    int symbol;
+    int temp_symbol;
 
     if (get_prompt(current_word) != 3) {
         return 0; /* Indicates line is not "extern prompt" line, continue scanning */
@@ -393,8 +350,8 @@ int is_extern(int line_num, char *file_name, FILE *file, char *line, int *error,
     }
 
     temp_symbol = is_symbol_name(line);
-    if (temp_symbol) {
-        if (temp_symbol->type != EXTERN) {
+    if (temp_symbol != NO_SYMBOL) {
+        if (get_symbol_table()->types[temp_symbol] != EXTERN) {
             print_error("Instruction \".extern\" label cannot be the same as a local label", file_name, line_num);
             *error = 1;
             return 0; /* Indicates label label is not valid */
@@ -405,26 +362,30 @@ int is_extern(int line_num, char *file_name, FILE *file, char *line, int *error,
     }
 
     symbol = add_symbol(line, 0, EXTERN);
-    if (symbol == NULL) {
+    if (symbol == NO_SYMBOL) {
         /* Indicates memory allocation failed */
-        free(current_word);
-        fclose(file);
-        free(file_name);
+        if (file != NULL)
+            fclose(file);
+        tracked_free(file_name);
         free_labels();
         exit(1); /* Exiting program */
     }
     return 1;
 }
 
+/* Finds the end of an operand: the first whitespace, comma or the end of the line */
+static char *operand_end(char *operand) {
+    while (*operand != NULL_TERMINATOR && *operand != COMMA && !isspace((unsigned char) *operand))
+        operand++;
+    return operand;
+}
+
 /* Function to check if an instruction is valid */
 int valid_instruction(Code **code_head, int *usage, int *IC, int instruct_id, int *error, char *file_name, int line_num,
                       FILE *file, char *line) {
-    char *src_operand, *dest_operand, *comma_pos;
+    char *src_operand, *src_end, *dest_operand;
     int operands_num = INSTRUCTIONS[instruct_id].operands_num, src_method, dest_method;
-    size_t length;
-    unsigned int word = 0;
-    word |= (INSTRUCTIONS[instruct_id].opcode << OPCODE_POS) | (INSTRUCTIONS[instruct_id].funct << FUNCS_POS) |
-            BIT_ABSOLUTE_FLAG;
+    unsigned int word = FIRST_WORDS[instruct_id][IMMEDIATE][IMMEDIATE];
 
     /* Analyzing operands */
     switch (operands_num) {
@@ -435,6 +396,7 @@ int valid_instruction(Code **code_head, int *usage, int *IC, int instruct_id, in
                 return 0; /* Scanning line finished */
             }
             add_instruction_code(code_head, usage, IC, word, error); /* Adding machine code */
+            report_instruction(instruct_id);
             return 1; /* Scanning line finished */
         case 1:
             if (line[0] == NULL_TERMINATOR) {
@@ -452,7 +414,7 @@ int valid_instruction(Code **code_head, int *usage, int *IC, int instruct_id, in
                 *error = 1;
                 return 0; /* Scanning line finished */
             }
-            if (contains_whitespace(line) || strchr(line,COMMA) != NULL) {
+            if (*operand_end(line) != NULL_TERMINATOR) {
                 /* Checking for extraneous text */
                 print_error("This instruction has extraneous text, only one operand is required", file_name, line_num);
                 *error = 1;
@@ -487,113 +449,56 @@ int valid_instruction(Code **code_head, int *usage, int *IC, int instruct_id, in
                 *error = 1;
                 return 0; /* Scanning line finished */
             }
-            src_operand = get_first_word(line);
-            if (src_operand == NULL) {
-                /* Indicates memory allocation failed (all the other allocations were freed inside function) */
-                fclose(file);
-                free(file_name);
-                free_labels();
-                exit(1); /* Exiting program */
+            /* The operands are found in place, a slice ends at whitespace, a comma or the end of the line */
+            src_operand = line;
+            src_end = operand_end(src_operand);
+            line = src_end;
+            while (*line && isspace(*line)) /* Skipping whitespace after the first operand */
+                line++;
+            if (line[0] == NULL_TERMINATOR || (*line == COMMA && line[1] == NULL_TERMINATOR)) {
+                /* Checking if there is a missing operand */
+                print_error("This instruction has a missing operand", file_name, line_num);
+                *error = 1;
+                return 0; /* Scanning line finished */
             }
-            length = strlen(src_operand);
-
-            comma_pos = strchr(src_operand,COMMA);
-            if (comma_pos != NULL) {
-                /* If a comma was found, splitting the string into two operands */
-                if (comma_pos - src_operand == strlen(src_operand) - 1 && line[length] == NULL_TERMINATOR) {
-                    print_error("This instruction has a missing operand", file_name, line_num);
-                    *error = 1;
-                    free(src_operand);
-                    return 0; /* Scanning line finished */
-                }
-                *comma_pos = NULL_TERMINATOR;
-                length = comma_pos - src_operand;
-                dest_operand = &line[length + 1]; /* Setting a pointer to the second operand */
-
-                while (*dest_operand && isspace(*dest_operand)) /* Skipping leading whitespace */
-                    dest_operand++;
-
-                if (dest_operand[0] == COMMA) {
-                    /* Checking if there are consecutive commas */
-                    print_error("This instruction has multiple consecutive commas", file_name, line_num);
-                    *error = 1;
-                    free(src_operand);
-                    return 0; /* Scanning line finished */
-                }
-                if (contains_whitespace(dest_operand) || strchr(dest_operand,COMMA) != NULL) {
-                    /* Checking for extraneous text */
-                    print_error("This instruction has extraneous text, only two operands are required", file_name,
-                                line_num);
-                    *error = 1;
-                    free(src_operand);
-                    return 0; /* Scanning line finished */
-                }
-            } else {
-                /* No comma was found in the first string */
-                line = &line[length];
-                while (*line && isspace(*line)) /* Skipping leading whitespace */
-                    line++;
-                if (line[0] == NULL_TERMINATOR || (*line == COMMA && line[1] == NULL_TERMINATOR)) {
-                    /* Checking if there is a missing operand */
-                    print_error("This instruction has a missing operand", file_name, line_num);
-                    *error = 1;
-                    free(src_operand);
-                    return 0; /* Scanning line finished */
-                }
-                if (line[0] != COMMA) {
-                    print_error("This instruction has a missing comma", file_name, line_num);
-                    *error = 1;
-                    free(src_operand);
-                    return 0; /* Scanning line finished */
-                }
+            if (line[0] != COMMA) {
+                print_error("This instruction has a missing comma", file_name, line_num);
+                *error = 1;
+                return 0; /* Scanning line finished */
+            }
+            line++;
+            while (*line && isspace(*line)) /* Skipping leading whitespace */
                 line++;
-                while (*line && isspace(*line)) /* Skipping leading whitespace */
-                    line++;
-                dest_operand = get_first_word(line);
-                if (dest_operand == NULL) {
-                    /* Indicates memory allocation failed (all the other allocations were freed inside function) */
-                    fclose(file);
-                    free(file_name);
-                    free_labels();
-                    free(src_operand);
-                    exit(1); /* Exiting program */
-                }
-                if (dest_operand[0] == COMMA) {
-                    print_error("This instruction has multiple consecutive commas", file_name, line_num);
-                    *error = 1;
-                    free(src_operand);
-                    free(dest_operand);
-                    return 0; /* Scanning line finished */
-                }
-                length = strlen(dest_operand);
-                if (strchr(dest_operand,COMMA) != NULL || line[length] != NULL_TERMINATOR) {
-                    /* Checking for extraneous text */
-                    print_error("This instruction has extraneous text, only two operands are required", file_name,
-                                line_num);
-                    *error = 1;
-                    free(src_operand);
-                    free(dest_operand);
-                    return 0; /* Scanning line finished */
-                }
+            dest_operand = line;
+            if (dest_operand[0] == COMMA) {
+                /* Checking if there are consecutive commas */
+                print_error("This instruction has multiple consecutive commas", file_name, line_num);
+                *error = 1;
+                return 0; /* Scanning line finished */
             }
+            if (*operand_end(dest_operand) != NULL_TERMINATOR) {
+                /* Checking for extraneous text */
+                print_error("This instruction has extraneous text, only two operands are required", file_name,
+                            line_num);
+                *error = 1;
+                return 0; /* Scanning line finished */
+            }
+            *src_end = NULL_TERMINATOR; /* The line is not checked again once its operands are found */
             src_method = get_addressing_method(src_operand, file_name, line_num);
             dest_method = get_addressing_method(dest_operand, file_name, line_num);
             if (src_method == -1 || dest_method == -1) {
-                free(src_operand);
                 *error = 1;
                 return 0; /* Scanning line finished */
             }
-            if (!is_method_legal(line, line_num, src_method, instruct_id, operands_num) ||
+            if (!is_method_legal(file_name, line_num, src_method, instruct_id, operands_num) ||
                 /* Checking if the addressing method is legal */
-                !is_method_legal(line, line_num, dest_method, instruct_id, operands_num - 1)) {
+                !is_method_legal(file_name, line_num, dest_method, instruct_id, operands_num - 1)) {
                 /* operands_num-1 to signal that operand is of type "destination" */
-                free(src_operand);
                 *error = 1;
                 return 0; /* Scanning line finished */
             }
             handle_two_operands(code_head, usage, IC, file, src_operand, dest_operand, instruct_id, error, src_method,
                                 dest_method);
-            free(src_operand);
             return 1;
         default: /* Indicates method is illegal */
             print_error("This instruction has an illegal number of operands", file_name, line_num);
@@ -602,35 +507,97 @@ int valid_instruction(Code **code_head, int *usage, int *IC, int instruct_id, in
     }
 }
 
+/* Adds a data word if the memory is not full, returns 0 if the line should not continue */
+static int add_data_word(Data **data_head, int *usage, int *DC, long value, int *error) {
+    if (*usage == CAPACITY) {
+        /* Checking if memory limit was reached */
+        printf("Error: Memory capacity exceeded! Assembler machine-coding is suspended, however line scanning continues");
+        *error = 1;
+        (*usage)++; /* Incrementing usage count so the next iteration will not print another error message */
+        return 0;
+    }
+    if (*usage > CAPACITY)
+        return 0; /* Checking if memory limit was exceeded */
+    add_data_code(data_head, DC, (int) value); /* Adding machine code */
+    (*usage)++; /* Incrementing usage count */
+    return 1;
+}
+
 /* Function to check if a line is a "data" line */
 int analyze_numbers(Data **data_head, int *usage, int *DC, int line_num, char *file_name, FILE *file, char *line,
                     int *error) {
-    int num_count = 0, i = 0;
-    int *num_array = get_numbers(file_name, line_num, file, line, &num_count);
-    if (num_array == NULL) {
+    const char *p = line, *end;
+    long value;
+    long count = 0;
+    int status;
+
+    /* The numbers are validated and added in one pass, so a line holds any count of them */
+    while (isspace((unsigned char) *p)) /* Skipping leading whitespace */
+        p++;
+    if (*p == COMMA) {
+        print_error("Instruction \".data\" has an illegal comma following the instruction label", file_name, line_num);
         *error = 1;
         return 0;
     }
-
-    /* Adding machine code to data array */
-    for (; i < num_count; i++) {
-        if (*usage == CAPACITY) {
-            /* Checking if memory limit was reached */
-            printf(
-                "Error: Memory capacity exceeded! Assembler machine-coding is suspended, however line scanning continues");
+    for (;;) {
+        status = parse_integer(p, &end, MIN_WORD, MAX_WORD, &value);
+        if (status == NUMBER_INVALID ||
+            (*end != NULL_TERMINATOR && !isspace((unsigned char) *end) && *end != COMMA && *end != MINUS &&
+             *end != PLUS)) {
+            print_error("Instruction \".data\" has illegal characters, only integers allowed", file_name, line_num);
             *error = 1;
-            (*usage)++; /* Incrementing usage count so the next iteration will not print another error message */
-            free(num_array);
-            return 0; /* Scanning line finished */
+            return 0;
         }
-        if (*usage > CAPACITY) {
-            /* Checking if memory limit was exceeded */
-            free(num_array);
+        if (status == NUMBER_OUT_OF_RANGE) {
+            print_error("Instruction \".data\" has a number that is out of range", file_name, line_num);
+            *error = 1;
+            return 0;
+        }
+        if (!add_data_word(data_head, usage, DC, value, error))
             return 0; /* Scanning line finished */
+        count++;
+
+        for (p = end; isspace((unsigned char) *p); p++) {
+        }
+        if (*p == NULL_TERMINATOR)
+            break;
+        if (*p != COMMA) {
+            print_error("Instruction \".data\" has a missing comma", file_name, line_num);
+            *error = 1;
+            return 0;
+        }
+        for (p++; isspace((unsigned char) *p); p++) {
+        }
+        if (*p == COMMA) {
+            print_error("Instruction \".data\" has multiple consecutive commas", file_name, line_num);
+            *error = 1;
+            return 0;
+        }
+        if (*p == NULL_TERMINATOR) {
+            print_error("Instruction \".data\" expects an integer after the last comma", file_name, line_num);
+            *error = 1;
+            return 0;
         }
-        add_data_code(data_head, DC, num_array[i]); /* Adding machine code */
-        (*usage)++; /* Incrementing usage count */
     }
-    free(num_array);
+    report_data_words(count);
     return 1;
 }
+
+FILE *open_entry_lines(char *file_name) {
+    char *file_am_name = add_extension(file_name, ".am");
+    FILE *file = fopen(file_am_name, "r");
+
+    if (file == NULL)
+        printf("Error: can't open %s\n", file_am_name);
+    tracked_free(file_am_name);
+    return file;
+}
+
+int next_entry_name(FILE *file, char *name) {
+    char line[MAX_LINE_LENGTH], prompt[MAX_LINE_LENGTH];
+
+    while (fgets(line, MAX_LINE_LENGTH, file))
+        if (sscanf(line, "%s %s", prompt, name) == TWO && get_prompt(prompt) == ENTRY_PROMPT_INDEX)
+            return 1;
+    return 0;
+}
@@ -185,4 +185,21 @@ int analyze_numbers(Data **data_head, int *usage, int *DC, int line_num, char *f
                     int *error);
 
 
+/**
+ * Opens the .am file of a source to read the names of its ".entry" lines.
+ * @param file_name The file name without extension.
+ * @return The open file, NULL if it could not be opened.
+ */
+FILE *open_entry_lines(char *file_name);
+
+
+/**
+ * Reads the name of the next ".entry" line of a file opened by open_entry_lines.
+ * @param file The open .am file.
+ * @param name Buffer of MAX_LINE_LENGTH characters for the name.
+ * @return 1 if a name was read, 0 at the end of the file.
+ */
+int next_entry_name(FILE *file, char *name);
+
+
 #endif